@@ -0,0 +1,70 @@
+#pragma once
+/**
+* FILE: align_cache.hpp
+* Created: Oct 18, 2026 Sun
+* @copyright 2016-20 Clarity Genomics BVBA
+*/
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+// forward
+struct Runopts;
+struct Index;
+class Refstats;
+
+/**
+ * Alignments of the reads on the index parts kept on disk across the runs (option '--align_cache DIR').
+ * Looked up before the reads are aligned (see DedupCache), so the reads aligned by an earlier run
+ * on the same index part with the same alignment options are not searched again.
+ *
+ * The keys are prefixed with the hash of the index part fingerprint (see Index::fingerprint), of the options
+ * the alignment depends on, and of the minimal SW score of the index (see Refstats::minimal_score), which
+ * depends on the total length of the reads.
+ *
+ * The entries are spread on their key hash over NUM_SHARDS files 'DIR/shard_<n>.dat', each a log of records:
+ *
+ *   key length: uint32_t | value length: uint32_t | check: uint64_t hash of key and value | key | value
+ *
+ * The records are appended under an exclusive lock of the file (flock), so the processes on the host can share
+ * the directory. Each process keeps the offsets of the records it has seen, and reads the records appended
+ * by the others when a key is not found. A record torn by a crash is cut off by the next append. A file growing over its share of the size limit is rewritten with
+ * its most recently added records up to half of its share, and renamed over the old one. The other processes
+ * find the new file on their next look-up.
+ */
+class AlignmentCache
+{
+public:
+	static const uint32_t NUM_SHARDS = 64;
+	static const uint32_t VERSION = 2; // format of the keys and the values. Changing it invalidates the caches.
+
+	AlignmentCache(Runopts & opts);
+	~AlignmentCache();
+
+	bool is_enabled() const { return !dir.empty(); }
+	void set_part(Runopts & opts, Index & index, Refstats & refstats);
+	bool find(const std::string & key, std::string & val);
+	void insert(const std::string & key, const std::string & val);
+
+private:
+	struct Shard
+	{
+		std::mutex lock;
+		int fd = -1; // opened for reading and appending
+		uint64_t ino = 0; // inode of 'fd' i.e. changes when the file is rewritten
+		uint64_t scanned = 0; // size of the file part whose records are in 'offsets'
+		std::unordered_map<uint64_t, uint64_t> offsets; // key hash -> record offset
+	};
+
+	std::string shard_file(uint32_t shard_num);
+	bool refresh(Shard & shard, uint32_t shard_num);
+	bool read_record(Shard & shard, uint64_t offset, const std::string & key, std::string & val);
+	void compact(Shard & shard, uint32_t shard_num, uint64_t size);
+
+	std::string dir;
+	uint64_t shard_size; // size limit of a shard file
+	std::string part_key; // key prefix on the current index part
+	std::unique_ptr<Shard[]> shards;
+}; // ~class AlignmentCache
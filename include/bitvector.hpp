@@ -67,6 +67,42 @@ extern int thisread;
 void init_win_f ( char*, UCHAR*, UCHAR*, int numbvs );
 void init_win_r ( char*, UCHAR*, UCHAR*, int numbvs );
 
+/*
+ * The body of init_win_f (DIR = 1) and init_win_r (DIR = -1). With NUMBVS > 0 the number of bitvectors
+ * is known at compile time and the loop can be unrolled. With NUMBVS = 0 it is given by 'numbvs'.
+ */
+template<int NUMBVS, int DIR>
+inline void init_win(char* ptr, UCHAR* bittable_000, UCHAR* bittable_010, int numbvs = NUMBVS)
+{
+	if (NUMBVS > 0) numbvs = NUMBVS;
+
+	/// set manually the bitvectors at position i = 0
+	for (int bitn = 2; bitn >= 0; bitn--)
+	{
+		*(bittable_000 + *ptr) |= (1 << bitn);
+		ptr += DIR;
+	}
+
+	/// set the bitvectors for positions i > 0 (mask 15 keeps the bitvectors of length 4)
+	UCHAR *setbit = bittable_010;
+	UCHAR *win_ptr1 = bittable_000;
+	UCHAR *win_ptr2 = bittable_010;
+
+	for (int i = 1; i <= numbvs; i++)
+	{
+		*win_ptr2++ = (UCHAR)((*win_ptr1++ << 1) & 15);
+		/// if i%4 == 0
+		if (!(i & 3))
+		{
+			/// set the LSB of candidate nt bitvector to 1
+			*(setbit + *ptr) |= 1;
+			ptr += DIR;
+			/// reset the setbit pointer to subsequent bitvector
+			setbit = win_ptr2;
+		}
+	}
+} // ~init_win
+
 
 /*
  *
@@ -109,14 +109,22 @@ const char DELIM = ':';
 #endif
 
 
-/*! @brief Maximum length of input reads
-	(not limited to this length algorithmically)
+/*! @brief Default length of the reads above which the long read mode is used
+	(see Runopts::long_read)
 */
-#define MAX_READ_LEN 30000
+#define LONG_READ_LEN 30000
 
 #define LOCKQEUEU // use Locking queue for storing the Reads
 #define STAMP  "[" << __func__ << ":" << __LINE__ << "] "
 #define STAMPL "[" << __FILE__ << ":" << __func__ ":" << __LINE__ << "] "
 
+// request the cache line of ADDR ahead of its use
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define PREFETCH(ADDR) _mm_prefetch(reinterpret_cast<const char*>(ADDR), _MM_HINT_T0)
+#else
+#define PREFETCH(ADDR) __builtin_prefetch(ADDR)
+#endif
+
 #endif
 
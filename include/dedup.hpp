@@ -0,0 +1,86 @@
+#pragma once
+/**
+* FILE: dedup.hpp
+* Created: Oct 18, 2026 Sun
+* @copyright 2016-20 Clarity Genomics BVBA
+*/
+#include <cstdint>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+
+#include "readstats.hpp" // ReadstatsDelta
+#include "align_cache.hpp"
+
+// forward
+class Read;
+struct Runopts;
+struct Index;
+class Refstats;
+
+/* alignment of a read on the current index part, copied to its duplicates (see DedupCache) */
+struct DedupEntry
+{
+	std::string key; // see DedupCache::key
+	std::string result; // alignment state of the read after the index part (see Read::toString)
+	ReadstatsDelta stats; // Readstats counts of the alignment
+	bool is_valid = true; // Read::isValid after the alignment e.g. false if the read is too short to be searched
+
+	DedupEntry() {}
+	DedupEntry(std::string key, Read & read);
+	DedupEntry(std::string key, const std::string & bstr); // from the binary string stored in the AlignmentCache
+	std::string toString() const; // binary string of the result and the counts
+	void apply(Read & read, Readstats & readstats) const;
+}; // ~struct DedupEntry
+
+/**
+ * Alignments of the distinct reads on the current index part (see Runopts::dedup_reads).
+ *
+ * The reads are keyed on their sequence and their alignment state before the part (see Read::toString).
+ * The reads sharing the key get the same alignment on the part, so only the first one is aligned,
+ * and the others take its alignment and its Readstats counts.
+ *
+ * The entries are spread on their key hash over NUM_SHARDS shards, each with its own lock and a list of
+ * entries in the order of use. 'max_entries' is split over the shards, the remainder one entry per shard
+ * i.e. the shard limits add up to 'max_entries'. The least recently used entry is dropped when the shard
+ * is full. Cleared after each index part.
+ *
+ * With Runopts::align_cache the entries not found in memory are looked up on disk, and the new entries
+ * are stored there as well (see AlignmentCache) i.e. are found by the later runs.
+ */
+class DedupCache
+{
+public:
+	static const uint32_t NUM_SHARDS = 64;
+
+	DedupCache(Runopts & opts);
+
+	bool is_enabled() const { return max_entries > 0 || store.is_enabled(); }
+	static std::string key(Read & read);
+	void set_part(Runopts & opts, Index & index, Refstats & refstats);
+	bool find(const std::string & key, DedupEntry & entry);
+	void insert(DedupEntry && entry);
+	void clear();
+
+	std::atomic<uint64_t> num_reads; // reads looked up
+	std::atomic<uint64_t> num_duplicates; // reads that took the alignment of a duplicate
+	std::atomic<uint64_t> num_stored; // of which found in the AlignmentCache
+
+private:
+	struct Shard
+	{
+		std::mutex lock;
+		std::list<DedupEntry> entries; // most recently used first
+		std::unordered_map<size_t, std::list<DedupEntry>::iterator> map; // key hash -> entry
+		uint32_t max_entries = 0;
+	};
+
+	void insert_memory(DedupEntry && entry);
+
+	uint32_t max_entries; // 0 - only the AlignmentCache is used
+	std::unique_ptr<Shard[]> shards;
+	AlignmentCache store;
+}; // ~class DedupCache
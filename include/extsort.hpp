@@ -0,0 +1,183 @@
+#pragma once
+/**
+* FILE: extsort.hpp
+* Created: Oct 18, 2026 Sun
+* @copyright 2016-20 Clarity Genomics BVBA
+*/
+#include <string>
+#include <vector>
+#include <queue>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <unistd.h> // getpid
+
+#include "common.hpp"
+
+/**
+ * External merge sort of fixed size records (POD with 'operator<') in a bounded amount of memory.
+ *
+ * The records are collected in a memory buffer of at most 'max_mem' bytes. A full buffer is sorted and written
+ * into a temporary run file. 'sort' merges the runs (in several passes if there are more than MAX_FANIN runs),
+ * after which the records are read in the sorted order using 'next'.
+ * If all the records fit into the buffer, no files are written.
+ */
+template <typename T>
+class ExtSorter
+{
+public:
+	ExtSorter(const std::filesystem::path &dir, const std::string &name, size_t max_mem)
+		: dir(dir), name(name), max_recs(std::max<size_t>(max_mem / sizeof(T), 1024)), num_recs(0), buf_pos(0), run_num(0) {}
+
+	~ExtSorter()
+	{
+		close_runs();
+		for (auto const& run : runs)
+			std::filesystem::remove(run);
+	}
+
+	void push(const T &rec)
+	{
+		if (buf.size() == max_recs)
+			spill();
+		buf.push_back(rec);
+		++num_recs;
+	}
+
+	/* finish the input and prepare for reading in the sorted order */
+	void sort()
+	{
+		if (runs.empty())
+		{
+			std::sort(buf.begin(), buf.end());
+			return;
+		}
+
+		if (!buf.empty())
+			spill();
+		std::vector<T>().swap(buf);
+
+		// reduce the number of runs to MAX_FANIN
+		while (runs.size() > MAX_FANIN)
+		{
+			std::vector<std::filesystem::path> merged;
+			for (size_t i = 0; i < runs.size(); i += MAX_FANIN)
+			{
+				size_t last = std::min(i + MAX_FANIN, runs.size());
+				if (last - i == 1)
+				{
+					merged.push_back(runs[i]);
+					continue;
+				}
+				auto run = new_run();
+				std::ofstream os(run, std::ios::binary);
+				open_runs(i, last);
+				T rec;
+				while (next_merged(rec))
+					os.write(reinterpret_cast<const char*>(&rec), sizeof(T));
+				close_runs();
+				for (size_t j = i; j < last; ++j)
+					std::filesystem::remove(runs[j]);
+				merged.push_back(run);
+			}
+			runs.swap(merged);
+		}
+
+		open_runs(0, runs.size());
+	} // ~sort
+
+	/* next record in the sorted order. Returns false when all records have been read. */
+	bool next(T &rec)
+	{
+		if (runs.empty())
+		{
+			if (buf_pos == buf.size())
+				return false;
+			rec = buf[buf_pos++];
+			return true;
+		}
+		return next_merged(rec);
+	}
+
+	/* total number of records pushed */
+	uint64_t size() { return num_recs; }
+
+private:
+	/* sort the buffer and write it into a new run file */
+	void spill()
+	{
+		std::sort(buf.begin(), buf.end());
+		auto run = new_run();
+		std::ofstream os(run, std::ios::binary);
+		if (!os.is_open())
+		{
+			std::stringstream ss;
+			ss << STAMP << "Failed to open file: " << run << " for writing. Error: " << strerror(errno);
+			ERR(ss.str());
+			exit(EXIT_FAILURE);
+		}
+		os.write(reinterpret_cast<const char*>(buf.data()), sizeof(T) * buf.size());
+		os.close();
+		runs.push_back(run);
+		buf.clear();
+	}
+
+	std::filesystem::path new_run()
+	{
+		std::stringstream ss;
+		ss << name << "_" << getpid() << "_" << run_num++ << ".run";
+		return dir / ss.str();
+	}
+
+	void open_runs(size_t first, size_t last)
+	{
+		run_is.clear();
+		for (size_t i = first; i < last; ++i)
+		{
+			run_is.emplace_back(runs[i], std::ios::binary);
+			T rec;
+			if (run_is.back().read(reinterpret_cast<char*>(&rec), sizeof(T)))
+				heads.push(std::make_pair(rec, run_is.size() - 1));
+		}
+	}
+
+	void close_runs()
+	{
+		heads = decltype(heads)();
+		run_is.clear();
+	}
+
+	bool next_merged(T &rec)
+	{
+		if (heads.empty())
+			return false;
+		rec = heads.top().first;
+		size_t idx = heads.top().second;
+		heads.pop();
+		T nrec;
+		if (run_is[idx].read(reinterpret_cast<char*>(&nrec), sizeof(T)))
+			heads.push(std::make_pair(nrec, idx));
+		return true;
+	}
+
+	struct head_greater
+	{
+		bool operator()(const std::pair<T, size_t> &a, const std::pair<T, size_t> &b) const { return b.first < a.first; }
+	};
+
+	static const size_t MAX_FANIN = 64; // max number of runs merged at once
+
+	std::filesystem::path dir; // directory for the run files
+	std::string name; // run files name prefix
+	size_t max_recs; // max number of records in the memory buffer
+	uint64_t num_recs;
+	std::vector<T> buf;
+	size_t buf_pos; // next record to read when all records fit into the buffer
+	size_t run_num;
+	std::vector<std::filesystem::path> runs;
+	std::vector<std::ifstream> run_is;
+	std::priority_queue<std::pair<T, size_t>, std::vector<std::pair<T, size_t>>, head_greater> heads;
+}; // ~class ExtSorter
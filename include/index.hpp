@@ -5,25 +5,205 @@
 */
 
 #include <vector>
+#include <string>
 #include <cstdint>
+#include <iterator>
+#include <atomic>
+
+#include "indexdb.hpp" // seq_pos
+#include "minimizer.hpp"
 
 // forward
 struct Runopts;
-struct kmer;
-struct kmer_origin;
 class Refstats;
 
+/**
+ * Trie node element of a loaded index (8 bytes i.e. a trie node of 4 elements is half a cache line).
+ * Same as the 'NodeElement' of the index builder, but the child trie node or the bucket is addressed by its offset
+ * from the root node of the trie, so the tries can be used wherever they are loaded or mapped.
+ *
+ * The trie nodes of a mini burst trie are laid out in the breadth-first order starting with the root, followed by
+ * the buckets. Each trie starts at a TRIE_ALIGN boundary i.e. no trie node crosses a cache line.
+ */
+struct TrieNode
+{
+	uint32_t offset; // offset (bytes) of the child trie node or the bucket from the root node
+	uint32_t size : 30; // size (bytes) of the bucket
+	uint32_t flag : 2; // 0 :: empty, 1 :: trie node, 2 :: bucket
+
+	TrieNode* trie(TrieNode* root) { return reinterpret_cast<TrieNode*>(reinterpret_cast<char*>(root) + offset); }
+	unsigned char* bucket(TrieNode* root) { return reinterpret_cast<unsigned char*>(root) + offset; }
+};
+
+const uint32_t TRIE_ALIGN = 4 * sizeof(TrieNode); // alignment of the tries in the tries block
+const uint32_t NO_TRIE = UINT32_MAX; // the L/2-mer has no mini burst trie
+
+// L/2-mer look-up table entry of a loaded index
+struct kmer_entry
+{
+	uint32_t trie_F; // offset of the forward mini burst trie in the tries block in TRIE_ALIGN units or NO_TRIE
+	uint32_t trie_R; // offset of the reverse mini burst trie in the tries block in TRIE_ALIGN units or NO_TRIE
+	uint32_t count; // count of L/2-mers
+};
+
+/**
+ * Header of the relocatable index part file '<index>.img_<part>.dat'
+ *
+ * The file is an image of a loaded index part, which is memory mapped and used in place.
+ * All the sections are 8 bytes aligned (the tries - TRIE_ALIGN), and only hold offsets i.e. no pointers:
+ *
+ *   header | lookup table: kmer_entry[1 << lnwin] | tries | positions: uint64_t[number_elements + 1] | pool: seq_pos[]
+ *
+ * The positions are stored in CSR layout: the positions of the (L+1)-mer 'id' are the pool entries
+ * [positions[id], positions[id + 1]).
+ *
+ * If the index was built with '--packed_pos' (flag IMAGE_PACKED_POSITIONS), the pool is a bit stream, and
+ * [positions[id], positions[id + 1]) is the range of bits holding the positions of 'id' sorted on (seq, pos):
+ *
+ *   5 bits: ws - 1 | 5 bits: wp - 1 | num x (ws bits: seq - previous seq | wp bits: pos)
+ *
+ * The bits are stored starting with the least significant bit of each byte. The pool is followed by 8 zero bytes,
+ * so the decoder (see PositionsIter) can always read 8 bytes.
+ *
+ * The image is created from the '.kmer', '.bursttrie' and '.pos' files of the part (see Index::convert), and uses
+ * the host byte order and type sizes i.e. is not portable between architectures.
+ */
+struct IndexImageHeader
+{
+	char magic[8]; // IMAGE_MAGIC
+	uint32_t version; // IMAGE_VERSION
+	uint32_t lnwin; // seed length
+	uint32_t number_elements; // number of unique (L+1)-mers i.e. entries in the positions section
+	uint32_t flags; // IMAGE_PACKED_POSITIONS
+	uint64_t lookup_off; // offset of the look-up table from the beginning of the image
+	uint64_t tries_off;
+	uint64_t positions_off;
+	uint64_t pool_off;
+	uint64_t size; // image size
+};
+
+const char IMAGE_MAGIC[8] = { 'S', 'M', 'R', 'I', 'D', 'X', 'I', 'M' };
+const uint32_t IMAGE_VERSION = 3;
+const uint32_t IMAGE_PACKED_POSITIONS = 1; // the positions pool is bit-packed
+const uint32_t PACKED_HEADER_BITS = 10; // bits of the widths at the start of each packed positions list
+
+/**
+ * Header of a POSIX shared memory segment hosting the image of an index part (see Index::host)
+ *
+ *   header | padding to SHM_IMAGE_OFF | image
+ *
+ * The magic is set last i.e. the segment can be used once it is set.
+ */
+struct ShmIndexHeader
+{
+	char magic[8]; // SHM_MAGIC
+	uint64_t image_size; // size of the image file
+	int64_t image_time; // last write time of the image file i.e. the segment is stale if the image was re-created
+};
+
+const char SHM_MAGIC[8] = { 'S', 'M', 'R', 'S', 'H', 'M', 'I', 'X' };
+const size_t SHM_IMAGE_OFF = 4096; // offset of the image in the segment (page aligned)
+
+/**
+ * Forward iterator over the positions of an (L+1)-mer. The positions are either read from the pool as is,
+ * or decoded from the bit-packed pool (see IndexImageHeader).
+ */
+class PositionsIter
+{
+public:
+	using iterator_category = std::input_iterator_tag;
+	using value_type = seq_pos;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const seq_pos*;
+	using reference = const seq_pos&;
+
+	PositionsIter() {}
+	PositionsIter(const seq_pos* raw, uint64_t num) : raw(raw), left(num) { if (left) cur = *raw; }
+	PositionsIter(const unsigned char* packed, uint64_t bit, uint64_t num) : packed(packed), bit(bit), left(num)
+	{
+		if (left)
+		{
+			ws = read(5) + 1;
+			wp = read(5) + 1;
+			decode();
+		}
+	}
+
+	reference operator*() const { return cur; }
+	pointer operator->() const { return &cur; }
+	PositionsIter& operator++()
+	{
+		if (--left)
+		{
+			if (packed) decode();
+			else cur = *++raw;
+		}
+		return *this;
+	}
+	PositionsIter operator++(int) { PositionsIter tmp = *this; ++*this; return tmp; }
+	// only iterators of the same (L+1)-mer are compared
+	bool operator==(const PositionsIter & other) const { return left == other.left; }
+	bool operator!=(const PositionsIter & other) const { return left != other.left; }
+
+	/* read 'width' (<= 32) bits of the packed pool */
+	static uint32_t read_bits(const unsigned char* packed, uint64_t bit, uint32_t width)
+	{
+		const unsigned char* p = packed + (bit >> 3);
+		uint64_t word = 0;
+		for (int i = 7; i >= 0; --i)
+			word = (word << 8) | p[i];
+		return (uint32_t)((word >> (bit & 7)) & ((1ULL << width) - 1));
+	}
+
+private:
+	uint32_t read(uint32_t width)
+	{
+		uint32_t val = read_bits(packed, bit, width);
+		bit += width;
+		return val;
+	}
+	void decode()
+	{
+		cur.seq += read(ws);
+		cur.pos = read(wp);
+	}
+
+	seq_pos cur = { 0, 0 };
+	const seq_pos* raw = nullptr;
+	const unsigned char* packed = nullptr;
+	uint64_t bit = 0;
+	uint64_t left = 0; // number of positions left including the current
+	uint32_t ws = 0; // width of the seq deltas
+	uint32_t wp = 0; // width of the pos
+}; // ~class PositionsIter
+
 /**
  * 1. Each reference file can be indexed into multiple index parts depending on the file size.
  *    Each index file name follows a pattern <Name_Part> e.g. index1_0, index1_1 etc.
+ * 2. A loaded index part is an image (see IndexImageHeader) mapped from the '.img' file of the part.
+ *    Parts that have no '.img' file are converted on the first load.
+ * 3. With '--huge_pages' the image is read into an anonymous mapping backed by huge pages instead (see map_huge).
+ * 4. If the part is hosted in shared memory by a 'sortmerna --index_host' process, the shared segment is attached
+ *    instead of mapping the image file (see Index::host).
  */
 struct Index {
 	uint16_t index_num = 0; // currrently loaded index number (DB file) Set in Main thread
 	uint32_t part = 0; // currently loaded index part
 	uint32_t number_elements = 0; /* number of positions in (L+1)-mer positions table */
 
-	std::vector<kmer> lookup_tbl; /**< reference to L/2-mer look up table */
-	std::vector<kmer_origin> positions_tbl; /**< reference to (L+1)-mer positions table */
+	uint32_t lookup_size = 0; /**< number of L/2-mers in the look-up table i.e. 1 << L */
+	kmer_entry* lookup_tbl = nullptr; /**< L/2-mer look up table */
+	char* tries = nullptr; /**< mini burst tries of all L/2-mers */
+	uint64_t* positions_tbl = nullptr; /**< (L+1)-mer positions table: offsets of the positions in the pool (CSR) */
+	seq_pos* positions_pool = nullptr; /**< positions of all (L+1)-mers */
+	unsigned char* packed_pool = nullptr; /**< bit-packed positions of all (L+1)-mers. Used instead of 'positions_pool' */
+	MinimizerIndex minimizers; /**< minimizers of the part. Only loaded for the minimizer seed engine (see OPT_SEED_ENGINE) */
+
+	// seed hits of the loaded part and the ones masked (see Refstats::max_occur). Added up by the processor threads.
+	std::atomic<uint64_t> seed_hits{ 0 };
+	std::atomic<uint64_t> seed_positions{ 0 };
+	std::atomic<uint64_t> masked_hits{ 0 };
+	std::atomic<uint64_t> masked_positions{ 0 };
 
 	// Index stats
 	//long _match = 0;    /* Smith-Waterman score for a match */
@@ -32,8 +212,49 @@ struct Index {
 	//long _gap_extension = 0; /* Smith-Waterman score for gap extension */
 
 	Index(Runopts & opts);
-	~Index() {}
+	~Index() { clear(); }
 
 	void load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats & refstats);
+	void load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, uint32_t lnwin);
 	void clear();
+
+	TrieNode* trie_F(uint32_t kmer) { return lookup_tbl[kmer].trie_F == NO_TRIE ? nullptr : reinterpret_cast<TrieNode*>(tries + (uint64_t)lookup_tbl[kmer].trie_F * TRIE_ALIGN); }
+	TrieNode* trie_R(uint32_t kmer) { return lookup_tbl[kmer].trie_R == NO_TRIE ? nullptr : reinterpret_cast<TrieNode*>(tries + (uint64_t)lookup_tbl[kmer].trie_R * TRIE_ALIGN); }
+	PositionsIter positions(uint32_t id)
+	{
+		if (packed_pool == nullptr)
+			return PositionsIter(positions_pool + positions_tbl[id], positions_tbl[id + 1] - positions_tbl[id]);
+		return PositionsIter(packed_pool, positions_tbl[id], num_positions(id));
+	}
+	PositionsIter positions_end(uint32_t) { return PositionsIter(); } // the end of the positions of any id
+	uint32_t num_positions(uint32_t id)
+	{
+		uint64_t len = positions_tbl[id + 1] - positions_tbl[id];
+		if (packed_pool == nullptr || len == 0)
+			return (uint32_t)len;
+		uint32_t widths = PositionsIter::read_bits(packed_pool, positions_tbl[id], PACKED_HEADER_BITS);
+		return (uint32_t)((len - PACKED_HEADER_BITS) / ((widths & 31) + (widths >> 5) + 2));
+	}
+
+	const IndexImageHeader* header() { return reinterpret_cast<IndexImageHeader*>(image); } // header of the loaded image
+	static std::string image_file(Runopts & opts, uint32_t idx_num, uint32_t idx_part);
+	static bool convert(Runopts & opts, uint32_t idx_num, uint32_t idx_part, uint32_t lnwin);
+	static std::string shm_name(Runopts & opts, uint32_t idx_num, uint32_t idx_part);
+	static std::string fingerprint(Runopts & opts, uint32_t idx_num, uint32_t idx_part);
+	static void host(Runopts & opts);
+
+private:
+	char* image = nullptr; // the loaded image
+	size_t image_size = 0;
+	size_t map_size = 0; // size of the mapping i.e. the image size rounded up to the page size
+	size_t map_off = 0; // offset of the image in the mapping
+	bool is_mapped = false; // the image is memory mapped, otherwise it is held in 'image_buf'
+	int shm_fd = -1; // attached shared memory segment. Holds a shared lock on the segment while attached.
+	std::vector<char> image_buf;
+
+	static bool is_image_current(const std::string & imgfile);
+	static void load_legacy(Runopts & opts, uint32_t idx_num, uint32_t idx_part, uint32_t lnwin, std::vector<char> & img);
+	static void pack_positions(std::vector<uint64_t> & positions, std::vector<seq_pos> & pool, std::vector<unsigned char> & packed);
+	bool attach(Runopts & opts, uint32_t idx_num, uint32_t idx_part, uint64_t image_size, uint32_t lnwin);
+	void set_image(char* img, size_t size, const std::string & name, uint32_t lnwin);
 }; // ~struct Index
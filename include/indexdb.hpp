@@ -33,9 +33,13 @@
  */
 
  #include <sys/types.h>
+#include <memory>
+#include <map>
+#include <fstream>
 #include "ssw.h"
 #include "common.hpp"
 #include "options.hpp"
+#include "extsort.hpp"
 
 
 /*! @brief The size of an entry in a burst trie bucket 
@@ -101,3 +105,110 @@ struct index_parts_stats {
     unsigned long int seq_part_size; // number of bytes of reference sequences to read
     uint32_t numseq_part; // the number of sequences in this part
 };
+
+// records of the external memory index build (see ExtPartBuilder)
+// 'win' is the number of the 19-mer window counting from the start of the index part i.e. the order of the reference file
+
+// 19-mer occurrence. Sorted on the 18-mer prefix, then on the window.
+struct ext_occ
+{
+	uint64_t kmer; // encoded 19-mer
+	uint64_t win;
+	seq_pos pos;
+	bool operator<(const ext_occ &o) const { return (kmer >> 2) < (o.kmer >> 2) || ((kmer >> 2) == (o.kmer >> 2) && win < o.win); }
+};
+
+// unique 19-mer. Sorted on the first occurrence of its 18-mer prefix (i.e. the 18-mer id), then on own first occurrence.
+struct ext_kmer
+{
+	uint64_t win18; // first occurrence of the 18-mer prefix
+	uint64_t win; // first occurrence of the 19-mer
+	uint64_t kmer;
+	bool operator<(const ext_kmer &o) const { return win18 < o.win18 || (win18 == o.win18 && win < o.win); }
+};
+
+// burst trie entry. Sorted on the L/2-mer of the trie, then in the order of the insertion.
+struct ext_entry
+{
+	uint64_t kmer;
+	uint64_t win;
+	uint32_t key; // L/2-mer
+	uint32_t id; // 18-mer id
+	bool operator<(const ext_entry &o) const { return key < o.key || (key == o.key && win < o.win); }
+};
+
+// 18-mer position. Sorted on the 18-mer id, then on the window.
+struct ext_pos
+{
+	uint64_t win18;
+	uint64_t win;
+	seq_pos pos;
+	bool operator<(const ext_pos &o) const { return win18 < o.win18 || (win18 == o.win18 && win < o.win); }
+};
+
+/**
+ * Offset table of the '.bursttrie' and '.pos' files of an index part, stored in '<index>.offsets_<part>.dat'
+ *
+ * Holds the file offset of every STRIDE-th L/2-mer tries and (L+1)-mer positions, so the files can be split into
+ * ranges, which are deserialized concurrently (see Index::load_legacy). The last entry of each table is the file size.
+ *
+ *   uint32_t STRIDE | uint32_t n | uint64_t tries[n] | uint32_t m | uint64_t pos[m]
+ */
+struct PartOffsets
+{
+	static const uint32_t STRIDE = 4096;
+
+	std::vector<uint64_t> tries; // '.bursttrie' offsets of the L/2-mers 0, STRIDE, 2*STRIDE, ..
+	std::vector<uint64_t> pos; // '.pos' offsets of the (L+1)-mers 0, STRIDE, 2*STRIDE, ..
+
+	void write(const std::string &file);
+	bool read(const std::string &file); // false if the file does not exist or is not valid
+};
+
+/**
+ * Histogram of the numbers of positions of the (L+1)-mers of all parts of an index, used to mask the most frequent
+ * (L+1)-mers in the seed search (option 'mask_frac'). Stored at the end of the '.stats' file together with the
+ * masking threshold, so the threshold can be recomputed when sequences are appended to the index:
+ *
+ *   uint32_t max_occur | uint32_t n | n x (uint32_t number of positions | uint64_t number of (L+1)-mers)
+ */
+struct OccurHist
+{
+	std::map<uint32_t, uint64_t> counts; // number of positions -> number of (L+1)-mers
+
+	void add(uint32_t num_pos) { ++counts[num_pos]; }
+	uint32_t threshold(double frac); // the (L+1)-mers with more positions are masked. 0 - none are masked.
+	void write(std::ofstream &os, uint32_t max_occur);
+	bool read(std::ifstream &is, uint32_t &max_occur); // false if not present i.e. index built before the option
+};
+
+/**
+ * Builds an index part in a bounded amount of memory (option 'max_ram').
+ *
+ * The sequences are passed one at a time to 'add_seq', which counts the L/2-mers and pushes all the 19-mer
+ * occurrences into an external sorter. 'write' produces the part files with a few more external sorts, holding
+ * only the burst tries of a single L/2-mer in memory. The files are identical to the ones of the in-memory build.
+ *
+ * Besides 'max_ram' the memory used is the L/2-mer count table i.e. 4 * 2^L bytes.
+ */
+class ExtPartBuilder
+{
+public:
+	ExtPartBuilder(Runopts &opts);
+
+	void add_seq(std::vector<unsigned char> &seq);
+
+	/* write the part files and fill their offset table. Returns the number of unique 18-mers */
+	uint32_t write(const std::string &kmer_file, const std::string &btrie_file, const std::string &pos_file, PartOffsets &offsets, OccurHist &hist);
+
+	uint32_t num_seqs() { return num_seq; }
+
+private:
+	Runopts &opts;
+	size_t sorter_mem; // memory for each sorter. At most 3 sorters hold their buffers at the same time.
+	std::vector<uint32_t> counts; // L/2-mer counts
+	std::vector<bool> incremented_by_forward; // L/2-mers counted by the forward window
+	std::unique_ptr<ExtSorter<ext_occ>> occs;
+	uint64_t num_win; // number of 19-mer windows added
+	uint32_t num_seq; // number of sequences added
+}; // ~class ExtPartBuilder
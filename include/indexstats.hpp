@@ -0,0 +1,83 @@
+#pragma once
+/**
+* FILE: indexstats.hpp
+* Created: Oct 18, 2026 Sun
+* @copyright 2016-20 Clarity Genomics BVBA
+*/
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <utility> // std::pair
+
+// forward
+struct Runopts;
+struct Index;
+struct TrieNode;
+
+/**
+ * Histogram of the values binned by their log2 i.e. the bin 'k' counts the values in [2^k, 2^(k+1)).
+ * The zeros are counted in the bin 0.
+ */
+struct Log2Hist
+{
+	std::vector<uint64_t> bins;
+	uint64_t num = 0; // number of values
+	uint64_t sum = 0; // sum of the values
+	uint64_t max = 0;
+
+	void add(uint64_t val, uint64_t times = 1);
+};
+
+/**
+ * Statistics of a loaded index part (see Runopts::is_index_stats): the distributions of the L/2-mer counts,
+ * the depths and sizes of the mini burst trie buckets, the lengths of the (L+1)-mer positions lists,
+ * the most frequent seeds, and the sizes of the image sections.
+ */
+struct IndexPartStats
+{
+	static const uint32_t NUM_TOP = 20; // number of the most frequent seeds reported
+
+	// look-up table
+	uint64_t kmers_used = 0; // L/2-mers with count > 0
+	uint64_t kmers_trie_F = 0; // L/2-mers with a forward mini burst trie
+	uint64_t kmers_trie_R = 0;
+	Log2Hist kmer_count; // 'count' of the used L/2-mers
+
+	// mini burst tries
+	uint64_t num_tries = 0;
+	uint64_t trie_nodes = 0;
+	uint64_t buckets = 0;
+	uint64_t bucket_entries = 0;
+	std::map<uint32_t, uint64_t> bucket_depth; // number of trie nodes on the path to the bucket -> number of buckets
+	std::map<uint32_t, uint64_t> entry_depth; // number of trie nodes on the path to the bucket -> number of entries
+	Log2Hist bucket_size; // entries per bucket
+
+	// positions
+	Log2Hist positions; // positions per (L+1)-mer
+	std::vector<std::pair<double, uint32_t>> quantiles; // quantile, positions per (L+1)-mer
+	std::vector<std::pair<uint32_t, std::pair<uint64_t, uint64_t>>> over; // threshold, (L+1)-mers and positions over it
+	std::vector<std::pair<std::string, uint32_t>> top; // the most frequent seeds and their positions
+
+	// bytes per image section (see IndexImageHeader)
+	uint64_t bytes_image = 0;
+	uint64_t bytes_header = 0;
+	uint64_t bytes_lookup = 0;
+	uint64_t bytes_tries = 0;
+	uint64_t bytes_trie_nodes = 0;
+	uint64_t bytes_buckets = 0;
+	uint64_t bytes_positions = 0;
+	uint64_t bytes_pool = 0;
+
+	void collect(Index & index, uint32_t lnwin);
+
+private:
+	void walk(TrieNode* node, TrieNode* root, uint32_t depth, std::string & path, bool is_forward);
+
+	uint32_t lnwin = 0;
+	uint32_t partialwin = 0;
+	std::unordered_map<uint32_t, std::string> seeds; // ids of the most frequent (L+1)-mers -> seed
+}; // ~struct IndexPartStats
+
+void index_stats(Runopts & opts, Index & index); // write the statistics of all the index parts (see OPT_INDEX_STATS)
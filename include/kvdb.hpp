@@ -4,19 +4,36 @@
  * Created: Nov 06, 2017 Mon
  */
 
+#include <vector>
+
 #include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/options.h"
 
+/**
+ * Key-value database for storing the alignment results.
+ *
+ * Each run stores its records in a dedicated Column Family named using the run fingerprint
+ * (see Runopts::run_fingerprint) so that the runs sharing the same KVDB directory do not 
+ * see each other's records, and a run can be removed in constant time by dropping its Column Family.
+ * Empty run name selects the RocksDB default Column Family.
+ */
 class KeyValueDatabase {
 public:
-	KeyValueDatabase(std::string const &kvdbPath);
-	~KeyValueDatabase() { delete kvdb; }
+	KeyValueDatabase(std::string const &kvdbPath, std::string const &run = "");
+	~KeyValueDatabase();
 
 	void put(std::string key, std::string val);
 	std::string get(std::string key);
 	int clear(std::string dbPath);
+	int drop(std::string const &run);
+	std::vector<std::string> list_runs();
 private:
+	int open_run(std::string const &run);
+
 	rocksdb::DB* kvdb;
 	rocksdb::Options options;
+	std::string run_name; // name of the Column Family used by this run
+	rocksdb::ColumnFamilyHandle* run_cf; // handle of the Column Family used by this run
+	std::vector<rocksdb::ColumnFamilyHandle*> cf_handles; // handles of all Column Families opened in DB
 };
@@ -0,0 +1,117 @@
+#pragma once
+/**
+* FILE: minimizer.hpp
+* Created: Oct 18, 2026 Sun
+* @copyright 2016-20 Clarity Genomics BVBA
+*/
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility> // std::pair
+
+const uint32_t MAX_MINIMIZER_W = 64; // max number of k-mers in a minimizer window (see Runopts::minimizer_w)
+
+/* murmur3 64-bit finalizer i.e. a random order of the k-mer codes */
+inline uint64_t kmer_hash(uint64_t code)
+{
+	code ^= code >> 33;
+	code *= 0xff51afd7ed558ccdULL;
+	code ^= code >> 33;
+	code *= 0xc4ceb9fe1a85ec53ULL;
+	code ^= code >> 33;
+	return code;
+}
+
+/**
+ * (w,k)-minimizers of a sequence in 03 encoding i.e. the k-mers with the smallest hash (see kmer_hash) in each window
+ * of 'w' consecutive k-mers. Ties are resolved to the leftmost k-mer. The minimizers are not canonical: a reference
+ * and a read on the same strand select the same k-mers where they match over a window of w + k - 1 nucleotides.
+ *
+ * 'fn(pos, code)' is called for each minimizer once in the increasing position order. 'code' is the 2-bit encoding
+ * of the k-mer, first nucleotide in the most significant bits. Sequences of less than 'w' k-mers have a single
+ * minimizer. Ambiguous nucleotides (4 in 04 encoding) are taken as 'A'.
+ *
+ * @param k  k-mer length <= 32
+ * @param w  number of k-mers in a window <= MAX_MINIMIZER_W
+ */
+template <typename T, typename F>
+void for_each_minimizer(const T* seq, uint32_t len, uint32_t k, uint32_t w, F fn)
+{
+	if (len < k || w == 0) return;
+	uint64_t mask = k < 32 ? (1ULL << (2 * k)) - 1 : ~0ULL;
+	uint64_t codes[MAX_MINIMIZER_W]; // the k-mers of the current window in a ring buffer
+	uint64_t hashes[MAX_MINIMIZER_W];
+	uint64_t code = 0;
+	uint64_t min_hash = ~0ULL;
+	uint32_t min_pos = 0;
+	uint32_t last_pos = UINT32_MAX; // last reported minimizer
+	for (uint32_t i = 0; i < len; ++i)
+	{
+		code = ((code << 2) | ((uint64_t)seq[i] & 3)) & mask;
+		if (i + 1 < k) continue;
+		uint32_t pos = i + 1 - k;
+		uint32_t slot = pos % w;
+		codes[slot] = code;
+		hashes[slot] = kmer_hash(code);
+
+		if (pos > 0 && pos - min_pos >= w)
+		{
+			// the minimum left the window - rescan
+			min_hash = ~0ULL;
+			for (uint32_t p = pos + 1 - w; p <= pos; ++p)
+			{
+				if (hashes[p % w] < min_hash)
+				{
+					min_hash = hashes[p % w];
+					min_pos = p;
+				}
+			}
+		}
+		else if (pos == 0 || hashes[slot] < min_hash)
+		{
+			min_hash = hashes[slot];
+			min_pos = pos;
+		}
+
+		if (pos + 1 >= w && min_pos != last_pos)
+		{
+			fn(min_pos, codes[min_pos % w]);
+			last_pos = min_pos;
+		}
+	}
+	if (len - k + 1 < w)
+		fn(min_pos, codes[min_pos % w]);
+} // ~for_each_minimizer
+
+/**
+ * Minimizer index of a reference index part: the (w,k)-minimizers of the reference sequences with k = L,
+ * each with the ids of the (L+1)-mers it starts on the reference i.e. the hits index the same positions table
+ * as the burst trie hits (see Index::positions). The tries give the (L+1)-mers of the same L-mer prefix the same id
+ * (see search_burst_trie), but the index does not depend on it: a code has a range of ids in the same layout
+ * as the positions table i.e. ids[id_starts[c]] .. ids[id_starts[c + 1] - 1]
+ *
+ * Built along the burst tries (see build_index) into the file '<index>.mini_<part>.dat':
+ *
+ *   k: uint32_t | w: uint32_t | number of codes: uint64_t | number of ids: uint64_t
+ *   | codes: uint64_t[] sorted | id_starts: uint32_t[number of codes + 1] | ids: uint32_t[]
+ *
+ * The look-up is a binary search in the range of the codes sharing the top DIR_BITS bits (see 'dir').
+ */
+struct MinimizerIndex
+{
+	static const uint32_t DIR_BITS = 16;
+
+	uint32_t k = 0; // minimizer length i.e. the seed length L. 0 - not loaded
+	uint32_t w = 0; // number of consecutive k-mers of a minimizer window
+	std::vector<uint64_t> codes; // sorted 2-bit codes of the minimizers
+	std::vector<uint32_t> id_starts; // first id of each code in 'ids'
+	std::vector<uint32_t> ids; // (L+1)-mer ids of the codes
+	std::vector<uint32_t> dir; // dir[b] - first code with the top DIR_BITS bits >= b
+
+	bool is_loaded() const { return k > 0; }
+	std::pair<const uint32_t*, const uint32_t*> find(uint64_t code) const; // ids of the minimizer. Empty if not found.
+	bool load(const std::string & file, uint32_t lnwin);
+	void clear();
+	static std::string file_name(const std::string & idxpfx, uint32_t idx_part);
+	static void write(const std::string & file, uint32_t k, uint32_t w, std::vector<std::pair<uint64_t, uint32_t>> & entries);
+}; // ~struct MinimizerIndex
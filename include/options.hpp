@@ -73,7 +73,23 @@ OPT_THREP = "threp",
 OPT_DBG_PUT_DB = "dbg_put_db",
 OPT_TMPDIR = "tmpdir",
 OPT_INTERVAL = "interval",
-OPT_MAX_POS = "max_pos";
+OPT_MAX_POS = "max_pos",
+OPT_MAX_RAM = "max_ram",
+OPT_INDEX_APPEND = "index_append",
+OPT_PACKED_POS = "packed_pos",
+OPT_MASK_FRAC = "mask_frac",
+OPT_DEDUP = "dedup",
+OPT_HUGE_PAGES = "huge_pages",
+OPT_INDEX_HOST = "index_host",
+OPT_INDEX_STATS = "index_stats",
+OPT_SEED_BATCH = "seed_batch",
+OPT_REORDER = "reorder",
+OPT_SEED_ENGINE = "seed_engine",
+OPT_MINIMIZER_W = "minimizer_w",
+OPT_LONG_READ = "long_read",
+OPT_DEDUP_READS = "dedup_reads",
+OPT_ALIGN_CACHE = "align_cache",
+OPT_ALIGN_CACHE_SIZE = "align_cache_size";
 
 // help strings
 const std::string \
@@ -291,7 +307,92 @@ help_L =
 	"Indexing: seed length.                                  18\n",
 help_max_pos = 
 	"Indexing: maximum (integer) number of positions to store  1000\n"
-	"                                            for each unique L-mer. If 0 all positions are stored.\n"
+	"                                            for each unique L-mer. If 0 all positions are stored.\n",
+help_max_ram = 
+	"Indexing: the amount of memory (in Mbytes) the index    0\n"
+	"                                            builder may use. When set, the index is built using\n"
+	"                                            temporary files in the index directory. If 0 the\n"
+	"                                            index is built in memory.\n",
+help_index_append = 
+	"Indexing: add the sequences appended to the reference   False\n"
+	"                                            file since the index was built as new index parts.\n"
+	"                                            The existing index parts are kept as is.\n",
+help_packed_pos = 
+	"Indexing: store the (L+1)-mer positions bit-packed in   False\n"
+	"                                            the loaded index. More reference sequences fit into\n"
+	"                                            an index part i.e. fewer parts are built for '-m'.\n",
+help_mask_frac = 
+	"Indexing: fraction of the most frequent (L+1)-mers     0\n"
+	"                                            masked in the seed search, which bounds the number\n"
+	"                                            of candidate positions of repetitive seeds. The\n"
+	"                                            threshold is stored in the index. 0 - no masking.\n",
+help_dedup = 
+	"Indexing: index a single representative of identical   False\n"
+	"                                            reference sequences. With the value 'contained' the\n"
+	"                                            sequences found within a longer sequence are not\n"
+	"                                            indexed either. The alignments are reported for all\n"
+	"                                            sequences (blast tabular, sam). Holds the reference\n"
+	"                                            sequences in memory while indexing i.e. they must\n"
+	"                                            fit into '--max_ram' if set.\n",
+help_huge_pages = 
+	"Back the loaded index with huge pages: hugetlbfs pages False\n"
+	"                                            if reserved, otherwise transparent huge pages.\n"
+	"                                            The index is read into memory instead of being\n"
+	"                                            mapped from its image file.\n",
+help_index_host = 
+	"Host the index in shared memory for the sortmerna      0\n"
+	"                                            processes running on this node, which attach it\n"
+	"                                            instead of loading own copies. Runs until terminated,\n"
+	"                                            or until the index is not used for the given number\n"
+	"                                            of seconds (if > 0).\n",
+help_index_stats = 
+	"Write the statistics of the index as JSON and exit:    idx/index_stats.json\n"
+	"                                            distributions of the look-up table counts, mini burst\n"
+	"                                            trie depths, bucket sizes, positions list lengths, the\n"
+	"                                            most frequent seeds and the bytes per index structure.\n",
+help_seed_batch = 
+	"Number of reads whose seed look-ups are prefetched      8\n"
+	"                                            together: the look-up table entries and the mini\n"
+	"                                            burst tries of all their seeds are requested from\n"
+	"                                            memory before the reads are searched. 0 - no prefetch.\n",
+help_reorder = 
+	"Search the reads in batches of INT reads sorted by      0\n"
+	"                                            their minimizer, so the reads likely sharing index\n"
+	"                                            tries and reference regions are searched one after\n"
+	"                                            another. The results are kept in the reads order.\n"
+	"                                            0 - search in the reads file order.\n",
+help_seed_engine = 
+	"Seed search engine of each index in the order of the   trie\n"
+	"                                            '--ref' files, comma separated: 'trie' - the seed\n"
+	"                                            windows are searched with up to one error in the\n"
+	"                                            mini burst tries, 'minimizer' - only the exact hits\n"
+	"                                            of the read minimizers are used, which is faster on\n"
+	"                                            long reads but less sensitive. The last value is\n"
+	"                                            used for the remaining indices.\n",
+help_minimizer_w = 
+	"Indexing: number of consecutive L-mers of a minimizer   10\n"
+	"                                            window (see '--seed_engine'), up to 64.\n"
+	"                                            0 - the minimizers are not indexed.\n",
+help_long_read = 
+	"Reads longer than INT nt are searched in the long read 30000\n"
+	"                                            mode: the seeds are searched in chunks of INT nt and\n"
+	"                                            chained over the whole read, and only the region of\n"
+	"                                            the read spanned by the chain is aligned.\n"
+	"                                            0 - all the reads are searched as short reads.\n",
+help_dedup_reads = 
+	"Align only the first of the reads having the same      0\n"
+	"                                            sequence, and copy its alignment to the others.\n"
+	"                                            INT - max number of distinct sequences remembered\n"
+	"                                            per index part, at least 64, the least recently\n"
+	"                                            seen are dropped. 0 - all the reads are aligned.\n",
+help_align_cache = 
+	"Directory keeping the alignments of the reads across\n"
+	"                                            the runs. The reads aligned by an earlier run on the\n"
+	"                                            same index with the same alignment options are not\n"
+	"                                            searched again. Can be shared by the runs on a host.\n",
+help_align_cache_size = 
+	"Size limit of the alignment cache in MB. The oldest    1024\n"
+	"                                            alignments are dropped.\n"
 ;
 
 const std::string WORKDIR_DEF_SFX = "sortmerna/run";
@@ -392,6 +493,7 @@ public:
 	std::filesystem::path aligned_pfx; // aligned reads output file prefix [dir/][pfx]
 	std::filesystem::path other_pfx; // non-aligned reads output file prefix [dir/][pfx]
 	std::string cmdline;
+	std::string run_fingerprint; // name of the KVDB Column Family holding this run's records. Hash of the reads, references, and alignment options.
 
 	int num_read_thread = 1; // number of threads reading the Reads file.
 	int num_write_thread = 1; // number of threads writing to Key-value database
@@ -402,6 +504,13 @@ public:
 	int num_proc_thread_rep = 1; // number of report processor threads
 
 	int queue_size_max = 100; // max number of Reads in the Read and Write queues. 10 works OK.
+	uint32_t seed_batch = 8; // OPT_SEED_BATCH number of reads whose seed look-ups are prefetched together. 0 - no prefetch.
+	uint32_t reorder = 0; // OPT_REORDER number of reads sorted on their minimizer before searching. 0 - file order.
+	std::vector<bool> is_minimizer_seeds; // OPT_SEED_ENGINE per index: search the minimizer index instead of the burst tries
+	uint32_t long_read = LONG_READ_LEN; // OPT_LONG_READ reads longer than this are searched in chunks of this length. 0 - no long read mode.
+	uint32_t dedup_reads = 0; // OPT_DEDUP_READS max number of distinct read sequences whose alignment is kept for the duplicates. 0 - no dedup.
+	std::string align_cache; // OPT_ALIGN_CACHE directory of the alignment cache shared by the runs. Empty - no cache.
+	uint32_t align_cache_size = 1024; // OPT_ALIGN_CACHE_SIZE size limit of the alignment cache in MB
 
 	int32_t num_alignments = -1; // [3] help_num_alignments
 	int32_t min_lis = -1; // OPT_MIN_LIS search all alignments having the first N longest LIS
@@ -426,8 +535,21 @@ public:
 	uint32_t seed_win_len = 18; // OPT_L seed length
 	uint32_t interval = 1; // size of k-mer window shift. Default 1 is the min possible to generate max number of k-mers.
 	uint32_t max_pos = 10000;
+	double max_ram = 0; // OPT_MAX_RAM max memory (MB) for building the index. 0 - build in memory.
+	bool is_index_append = false; // OPT_INDEX_APPEND index the sequences appended to the reference files
+	bool is_packed_pos = false; // OPT_PACKED_POS bit-pack the positions of the loaded index
+	double mask_frac = 0; // OPT_MASK_FRAC fraction of the most frequent (L+1)-mers masked in the seed search
+	bool is_dedup = false; // OPT_DEDUP index a single representative of identical reference sequences
+	bool is_dedup_contained = false; // OPT_DEDUP 'contained' do not index the sequences contained in longer ones
+	uint32_t minimizer_w = 10; // OPT_MINIMIZER_W L-mers per minimizer window. 0 - no minimizer index.
 	// ~ END indexing options
 
+	bool is_huge_pages = false; // OPT_HUGE_PAGES back the loaded index with huge pages
+	bool is_index_host = false; // OPT_INDEX_HOST host the index in shared memory
+	uint32_t index_host_idle = 0; // OPT_INDEX_HOST evict the hosted index after this number of idle seconds. 0 - never.
+	bool is_index_stats = false; // OPT_INDEX_STATS write the index statistics and exit
+	std::filesystem::path index_stats_file; // OPT_INDEX_STATS output file. Default: idxdir/index_stats.json
+
 	std::vector<std::string> blastops; // [1]
 	std::vector<std::string> readfiles; // '--reads'
 	std::vector<std::pair<std::string, std::string>> indexfiles; // '-ref' pairs 'Ref_file:Idx_file_pfx'
@@ -449,6 +571,7 @@ private:
 	void validate();
 	void validate_idxdir(); // called from validate
 	void validate_kvdbdir(); // called from validate
+	void set_run_fingerprint(); // called from validate
 	void validate_aligned_pfx();
 	void validate_other_pfx();
 	void opt_sort();
@@ -488,6 +611,17 @@ private:
 	void opt_task(const std::string &val);
 	void opt_cmd(const std::string &val);
 	void opt_threads(const std::string &val);
+	void opt_huge_pages(const std::string &val);
+	void opt_index_host(const std::string &val);
+	void opt_index_stats(const std::string &val);
+	void opt_seed_batch(const std::string &val);
+	void opt_reorder(const std::string &val);
+	void opt_seed_engine(const std::string &val);
+	void opt_minimizer_w(const std::string &val);
+	void opt_long_read(const std::string &val);
+	void opt_dedup_reads(const std::string &val);
+	void opt_align_cache(const std::string &val);
+	void opt_align_cache_size(const std::string &val);
 	void opt_thpp(const std::string &val); // post-proc threads --thpp 1:1
 	void opt_threp(const std::string &val); // report threads --threp 1:1 
 	void opt_a(const std::string &val);
@@ -501,12 +635,17 @@ private:
 	void opt_kvdb(const std::string& path);
 	void opt_idx(const std::string& path);
 
-	// ref tmpdir interval m L max_pos v h  // indexing options
+	// ref tmpdir interval m L max_pos max_ram index_append packed_pos mask_frac dedup v h  // indexing options
 	void opt_tmpdir(const std::string &val);
 	void opt_interval(const std::string &val);
 	void opt_m(const std::string &val);
 	void opt_L(const std::string &val);
 	void opt_max_pos(const std::string &val);
+	void opt_max_ram(const std::string &val);
+	void opt_index_append(const std::string &val);
+	void opt_packed_pos(const std::string &val);
+	void opt_mask_frac(const std::string &val);
+	void opt_dedup(const std::string &val);
 
 	void opt_default(const std::string &opt);
 	void opt_dbg_put_db(const std::string &opt);
@@ -532,7 +671,7 @@ private:
 	std::multimap<std::string, std::string> mopt;
 
 	// OPTIONS Map - specifies all possible options
-	const std::array<opt_6_tuple, 48> options = {
+	const std::array<opt_6_tuple, 64> options = {
 		std::make_tuple(OPT_REF,            "PATH",        COMMON,      true,  help_ref, &Runopts::opt_ref),
 		std::make_tuple(OPT_READS,          "PATH",        COMMON,      true,  help_reads, &Runopts::opt_reads),
 		std::make_tuple(OPT_WORKDIR,        "PATH",        COMMON,      false, help_workdir, &Runopts::opt_workdir),
@@ -571,11 +710,27 @@ private:
 		std::make_tuple(OPT_PID,            "BOOL",        ADVANCED,    false, help_pid, &Runopts::opt_pid),
 		std::make_tuple(OPT_A,              "INT",         ADVANCED,    false, help_a, &Runopts::opt_a),
 		std::make_tuple(OPT_THREADS,        "INT",         ADVANCED,    false, help_threads, &Runopts::opt_threads),
+		std::make_tuple(OPT_HUGE_PAGES,     "BOOL",        ADVANCED,    false, help_huge_pages, &Runopts::opt_huge_pages),
+		std::make_tuple(OPT_INDEX_HOST,     "INT",         ADVANCED,    false, help_index_host, &Runopts::opt_index_host),
+		std::make_tuple(OPT_INDEX_STATS,    "STRING",      ADVANCED,    false, help_index_stats, &Runopts::opt_index_stats),
+		std::make_tuple(OPT_SEED_BATCH,     "INT",         ADVANCED,    false, help_seed_batch, &Runopts::opt_seed_batch),
+		std::make_tuple(OPT_REORDER,        "INT",         ADVANCED,    false, help_reorder, &Runopts::opt_reorder),
+		std::make_tuple(OPT_SEED_ENGINE,    "STRING",      ADVANCED,    false, help_seed_engine, &Runopts::opt_seed_engine),
+		std::make_tuple(OPT_LONG_READ,      "INT",         ADVANCED,    false, help_long_read, &Runopts::opt_long_read),
+		std::make_tuple(OPT_DEDUP_READS,    "INT",         ADVANCED,    false, help_dedup_reads, &Runopts::opt_dedup_reads),
+		std::make_tuple(OPT_ALIGN_CACHE,    "PATH",        ADVANCED,    false, help_align_cache, &Runopts::opt_align_cache),
+		std::make_tuple(OPT_ALIGN_CACHE_SIZE, "INT",       ADVANCED,    false, help_align_cache_size, &Runopts::opt_align_cache_size),
 		std::make_tuple(OPT_L,              "DOUBLE",      INDEXING,    false, help_L, &Runopts::opt_L),
 		std::make_tuple(OPT_M,              "DOUBLE",      INDEXING,    false, help_m, &Runopts::opt_m),
 		std::make_tuple(OPT_V,              "BOOL",        INDEXING,    false, help_v, &Runopts::opt_v),
 		std::make_tuple(OPT_INTERVAL,       "INT",         INDEXING,    false, help_interval, &Runopts::opt_interval),
 		std::make_tuple(OPT_MAX_POS,        "INT",         INDEXING,    false, help_max_pos, &Runopts::opt_max_pos),
+		std::make_tuple(OPT_MAX_RAM,        "DOUBLE",      INDEXING,    false, help_max_ram, &Runopts::opt_max_ram),
+		std::make_tuple(OPT_INDEX_APPEND,   "BOOL",        INDEXING,    false, help_index_append, &Runopts::opt_index_append),
+		std::make_tuple(OPT_PACKED_POS,     "BOOL",        INDEXING,    false, help_packed_pos, &Runopts::opt_packed_pos),
+		std::make_tuple(OPT_MASK_FRAC,      "DOUBLE",      INDEXING,    false, help_mask_frac, &Runopts::opt_mask_frac),
+		std::make_tuple(OPT_DEDUP,          "STRING",      INDEXING,    false, help_dedup, &Runopts::opt_dedup),
+		std::make_tuple(OPT_MINIMIZER_W,    "INT",         INDEXING,    false, help_minimizer_w, &Runopts::opt_minimizer_w),
 		std::make_tuple(OPT_H,              "BOOL",        HELP,        false, help_h, &Runopts::opt_h),
 		std::make_tuple(OPT_VERSION,        "BOOL",        HELP,        false, help_version, &Runopts::opt_version),
 		std::make_tuple(OPT_DBG_PUT_DB,     "BOOL",        DEVELOPER,   false, help_dbg_put_db, &Runopts::opt_dbg_put_db),
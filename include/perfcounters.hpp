@@ -0,0 +1,35 @@
+#pragma once
+/**
+* FILE: perfcounters.hpp
+* Created: Oct 18, 2026 Sun
+* @copyright 2016-20 Clarity Genomics BVBA
+*/
+#include <cstdint>
+#include <string>
+
+/**
+ * Process wide counts of the data TLB misses and the page faults, used to report the memory behaviour of the
+ * alignment against an index part (see Runopts::is_huge_pages).
+ *
+ * The dTLB load misses are counted using 'perf_event_open' (Linux only). The counter is inherited by the threads
+ * created after it was opened i.e. the object has to be created before the thread pool.
+ * If the counter cannot be opened (kernel.perf_event_paranoid, no PMU access in a VM, other OS)
+ * only the page faults are reported.
+ */
+class PerfCounters
+{
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	void start(); // start counting i.e. take the current values as the base
+	std::string to_string(); // counts since 'start'
+
+private:
+	uint64_t read_dtlb();
+
+	int dtlb_fd = -1; // perf event file descriptor of the dTLB load misses counter
+	uint64_t dtlb_start = 0;
+	long minflt_start = 0; // page faults served without I/O
+	long majflt_start = 0; // page faults that required I/O
+}; // ~class PerfCounters
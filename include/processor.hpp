@@ -18,6 +18,7 @@ class References;
 class Output;
 struct Readstats;
 class Refstats;
+class DedupCache;
 
 /* 
  * performs alignment
@@ -34,9 +35,11 @@ public:
 		Output & output, 
 		Readstats & readstats, 
 		Refstats & refstats,
+		DedupCache & dedup,
 		//std::function<void(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read)> callback
 		void(*callback)(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read, bool isLastStrand)
 	) :
+		callback(callback),
 		id(id),
 		readQueue(readQueue),
 		writeQueue(writeQueue),
@@ -46,7 +49,7 @@ public:
 		output(output),
 		readstats(readstats),
 		refstats(refstats),
-		callback(callback) 
+		dedup(dedup)
 	{}
 
 	void operator()() { run(); }
@@ -66,6 +69,7 @@ protected:
 	Output & output; 
 	Readstats & readstats; 
 	Refstats & refstats;
+	DedupCache & dedup;
 }; // ~class Processor
 
 /* performs post-alignment tasks like calculating statistics */
@@ -81,14 +85,14 @@ public:
 		Refstats & refstats,
 		void(*callback)(Read & read, Readstats & readstats, Refstats & refstats, References & refs, Runopts & opts)
 	) :
+		callback(callback),
 		id(id),
 		readQueue(readQueue),
 		writeQueue(writeQueue),
 		opts(opts),
 		refs(refs),
 		readstats(readstats),
-		refstats(refstats),
-		callback(callback)
+		refstats(refstats)
 	{}
 
 	void operator()() { run(); }
@@ -120,13 +124,13 @@ public:
 		Refstats & refstats,
 		void(*callback)(std::vector<Read> & reads, Runopts & opts, References & refs, Refstats & refstats, Output & output)
 	) :
+		callback(callback),
 		id(id),
 		readQueue(readQueue),
 		opts(opts),
 		refs(refs),
-		output(output),
 		refstats(refstats),
-		callback(callback)
+		output(output)
 	{}
 
 	void operator()() { run(); }
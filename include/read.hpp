@@ -14,6 +14,7 @@
 #include "traverse_bursttrie.hpp" // id_win
 #include "ssw.hpp" // s_align2
 #include "options.hpp"
+#include "readstats.hpp" // ReadstatsDelta
 
 class References; // forward
 
@@ -65,6 +66,9 @@ public:
 	// calculated
 	std::string isequence; // sequence in Integer alphabet: [A,C,G,T] -> [0,1,2,3]
 	bool reversed; // indicates the read is reverse-complement i.e. 'revIntStr' was applied
+	std::string isequence_rc; // 'isequence' of the other strand. Cached by 'revIntStr', which then just swaps the two
+	std::vector<uint32_t> kmer_keys[2]; // look-up keys of the forward [0] and the reverse-complement [1] strands (see kmerKeys)
+	uint32_t kmer_keys_len = 0; // L/2-mer length of 'kmer_keys', 0 if not computed
 	std::vector<int> ambiguous_nt; // positions of ambiguous nucleotides in the sequence (as defined in nt_table/load_index.cpp)
 
 	// store in database ------------>
@@ -86,11 +90,15 @@ public:
 	std::vector<int8_t> scoring_matrix; // initScoringMatrix   orig: int8_t* scoring_matrix
 	// <---- END store in database
 
+	ReadstatsDelta stats_delta; // Readstats counts of the read on the current index part. Not stored.
+
 public:
 	Read();
 	Read(std::string id, std::string header, std::string sequence, std::string quality, Format format);
 	Read(const Read & that); // copy constructor
 	Read & operator=(const Read & that); // copy assignment
+	Read(Read && that) = default; // move constructor
+	Read & operator=(Read && that) = default; // move assignment
 	~Read();
 
 public:
@@ -103,6 +111,7 @@ public:
 	void unmarshallJson(KeyValueDatabase & kvdb);
 	std::string toString();
 	bool load_db(KeyValueDatabase & kvdb);
+	void fromString(const std::string & bstr);
 	void seqToIntStr();
 	void revIntStr();
 	std::string get04alphaSeq();
@@ -110,4 +119,7 @@ public:
 	void calcMismatchGapId(References &refs, int alignIdx, uint32_t &mismatches, uint32_t &gaps, uint32_t &id);
 	std::string getSeqId();
 	uint32_t hashKmer(uint32_t pos, uint32_t len);
+	void hashKmers(uint32_t len);
+	const std::vector<uint32_t> & kmerKeys(uint32_t len);
+	uint64_t minimizer(uint32_t k);
 }; // ~class Read
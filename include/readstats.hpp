@@ -70,3 +70,19 @@ struct Readstats
 	void printOtuMap(std::string otumapfile);
 	void set_is_total_reads_mapped_cov();
 }; // ~struct Readstats
+
+/*
+ * Counts added to the Readstats by the alignment of a single read on the current index part (see compute_lis_alignment).
+ * Added again for each duplicate of the read, which takes the read's alignment instead of being aligned
+ * (see Runopts::dedup_reads).
+ */
+struct ReadstatsDelta
+{
+	uint32_t total_reads_aligned = 0;
+	uint32_t total_reads_mapped_cov = 0;
+	std::vector<int32_t> reads_matched_per_db; // empty if none changed
+
+	void add_matched(uint16_t index_num, int32_t count);
+	void apply(Readstats & readstats) const;
+	void clear();
+}; // ~struct ReadstatsDelta
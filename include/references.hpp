@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <utility>
 
 #include "common.hpp" // Format, FASTA_HEADER_START, FASTQ_HEADER_START
 
@@ -44,6 +46,15 @@ public:
 
 	std::vector<BaseRecord> buffer; // Container for references TODO: change name?
 
+	// reference sequence, which is not indexed, but represented by another sequence (index option 'dedup')
+	struct Member
+	{
+		std::string id;
+		uint32_t offset; // the member is [offset, offset + len) of the representative
+		uint32_t len;
+	};
+	std::map<std::string, std::vector<Member>> members; // representative id -> members. see References::load_members
+
 	References(): num(0), part(0) {}
 	~References() {}
 
@@ -52,11 +63,16 @@ public:
 	std::string convertChar(int idx); // convert numerical form to char string
 	int findref(std::string id);
 	void clear();
+	// the ids and offsets the alignment [begin, end] on the reference 'ref' is reported for
+	std::vector<std::pair<std::string, uint32_t>> report_ids(uint32_t ref, uint32_t begin, uint32_t end);
 
 public:
 	uint16_t num; // number of the reference file currently loaded
 	uint16_t part; // part of the reference file currently loaded
 
 private:
+	void load_members(uint32_t idx_num, Runopts & opts);
+
 	bool load_for_search;
+	int members_num = -1; // number of the reference file the members are loaded for
 }; // ~class References
@@ -27,6 +27,7 @@ public:
 	std::vector<std::pair<double, double>> gumbel; // Gumbel parameters Lambda and K. see Refstats::load
 	std::vector<uint64_t> numbvs; /* number of bitvectors at depth > 0 in [w_1] reverse or [w_2] forward */
 	std::vector<uint64_t> numseq;  /* total number of reference sequences in one complete reference database */
+	std::vector<uint32_t> max_occur; /* (L+1)-mers with more positions are masked in the seed search. 0 - no masking. see OccurHist */
 
 public:
 	Refstats(Runopts & opts, Readstats & readstats);
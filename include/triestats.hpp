@@ -1,40 +0,0 @@
-/*
- * SortMeRNA - next-generation reads filter for metatranscriptomic or total RNA
- * Copyright (C) 2014 Bonsai Bioinformatics Research Group
- *
- * This file is part of SortMeRNA.
- *
- * SortMeRNA is free software: you can redistribute it and/or modify
- * it under the terms of the GNU Lesser General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * (at your option) any later version.
- *
- * SortMeRNA is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU Lesser General Public License for more details.
- *
- * You should have received a copy of the GNU Lesser General Public License
- * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
- *
- * file: triestats.hpp
- * contact: jenya.kopylov@gmail.com, laurent.noe@lifl.fr, helene.touzet@lifl.fr
- *
- */
-
-#ifndef triestats_h
-#define triestats_h
-
-#include "common.hpp"
-#include "bursttrie.hpp"
-#include <fstream>
-
-using namespace std;
-
-extern int total_num_trie_nodes;
-extern size_t size_of_all_buckets;
-extern int total_num_buckets;
-
-void traverse_trie( NodeElement* root, int depth);
-
-#endif
@@ -0,0 +1,314 @@
+/**
+ * FILE: align_cache.cpp
+ * Created: Oct 18, 2026 Sun
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h> // flock
+#endif
+
+#include "align_cache.hpp"
+#include "options.hpp"
+#include "index.hpp"
+#include "refstats.hpp"
+#include "common.hpp"
+#include "build_version.h"
+
+// forward
+std::string string_hash(const std::string &val); // util.cpp
+uint64_t fnv1a(const char* data, size_t len, uint64_t hash = 14695981039346656037ULL); // util.cpp
+
+struct cache_record_header
+{
+	uint32_t key_len;
+	uint32_t val_len;
+	uint64_t check; // hash of the key and the value i.e. detects the records torn by a crash
+};
+
+static uint64_t record_check(const char* key, uint32_t key_len, const char* val, uint32_t val_len)
+{
+	return fnv1a(val, val_len, fnv1a(key, key_len));
+}
+
+AlignmentCache::AlignmentCache(Runopts & opts)
+	: shard_size(0)
+{
+	if (opts.align_cache.empty())
+		return;
+
+	std::stringstream ss;
+#if defined(_WIN32)
+	ss << STAMP << "Option '" << OPT_ALIGN_CACHE << "' is not supported on Windows";
+	ERR(ss.str());
+	exit(EXIT_FAILURE);
+#else
+	std::error_code ec;
+	std::filesystem::create_directories(opts.align_cache, ec);
+	if (ec)
+	{
+		ss << STAMP << "Failed to create the alignment cache directory [" << opts.align_cache << "]: " << ec.message();
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	dir = opts.align_cache;
+	shard_size = (uint64_t)opts.align_cache_size * 1024 * 1024 / NUM_SHARDS;
+	shards.reset(new Shard[NUM_SHARDS]);
+
+	ss << STAMP << "Using the alignment cache [" << dir << "] of " << opts.align_cache_size << " MB" << std::endl;
+	std::cout << ss.str();
+#endif
+} // ~AlignmentCache::AlignmentCache
+
+AlignmentCache::~AlignmentCache()
+{
+#if !defined(_WIN32)
+	for (uint32_t i = 0; shards && i < NUM_SHARDS; ++i)
+	{
+		if (shards[i].fd != -1)
+			::close(shards[i].fd);
+	}
+#endif
+}
+
+/**
+ * the key prefix of the index part just loaded: the alignment of a read on the part depends on the part,
+ * on the alignment options, and on the minimal SW score
+ */
+void AlignmentCache::set_part(Runopts & opts, Index & index, Refstats & refstats)
+{
+	if (!is_enabled())
+		return;
+
+	auto idx = index.index_num;
+	std::stringstream ss;
+	ss << VERSION << ";" << sortmerna_build_git_sha << ";" << Index::fingerprint(opts, idx, index.part) << ";"
+		<< idx << ";" << index.part << ";" << index.minimizers.is_loaded() << ";"
+		<< refstats.minimal_score[idx] << ";" << refstats.max_occur[idx] << ";"
+		<< opts.is_forward << opts.is_reverse << opts.is_full_search << opts.is_as_percent << opts.is_de_novo_otu << ";"
+		<< opts.skiplengths[idx][0] << "," << opts.skiplengths[idx][1] << "," << opts.skiplengths[idx][2] << ";"
+		<< opts.num_alignments << ";" << opts.num_best_hits << ";" << opts.min_lis << ";" << opts.seed_hits << ";"
+		<< opts.edges << ";" << opts.match << ";" << opts.mismatch << ";" << opts.gap_open << ";" << opts.gap_extension << ";"
+		<< opts.score_N << ";" << opts.minoccur << ";" << opts.long_read << ";" << opts.min_id << ";" << opts.min_cov;
+	part_key = string_hash(ss.str()) + ";";
+} // ~AlignmentCache::set_part
+
+std::string AlignmentCache::shard_file(uint32_t shard_num)
+{
+	return (std::filesystem::path(dir) / ("shard_" + std::to_string(shard_num) + ".dat")).string();
+}
+
+/**
+ * open the shard file if not yet open, or if it was rewritten by another process, and add the offsets
+ * of the records appended since the last call. Stops at the first incomplete or corrupted record, which
+ * is cut off by the next 'insert'.
+ *
+ * @return false if the file cannot be opened
+ */
+bool AlignmentCache::refresh(Shard & shard, uint32_t shard_num)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	auto file = shard_file(shard_num);
+	struct stat st;
+	if (shard.fd == -1 || ::stat(file.data(), &st) == -1 || (uint64_t)st.st_ino != shard.ino)
+	{
+		if (shard.fd != -1)
+			::close(shard.fd);
+		shard.offsets.clear();
+		shard.scanned = 0;
+		shard.fd = ::open(file.data(), O_RDWR | O_CREAT | O_APPEND, 0664);
+		if (shard.fd == -1 || fstat(shard.fd, &st) == -1)
+			return false;
+		shard.ino = st.st_ino;
+	}
+	else if (fstat(shard.fd, &st) == -1)
+		return false;
+
+	if ((uint64_t)st.st_size <= shard.scanned)
+		return true;
+
+	std::vector<char> buf(st.st_size - shard.scanned);
+	ssize_t len = pread(shard.fd, buf.data(), buf.size(), shard.scanned);
+	size_t pos = 0;
+	cache_record_header hdr;
+	while (len > 0 && pos + sizeof(hdr) <= (size_t)len)
+	{
+		std::memcpy(&hdr, buf.data() + pos, sizeof(hdr));
+		size_t rec_len = sizeof(hdr) + hdr.key_len + hdr.val_len;
+		if (pos + rec_len > (size_t)len)
+			break; // being appended by another process
+		const char* key = buf.data() + pos + sizeof(hdr);
+		if (record_check(key, hdr.key_len, key + hdr.key_len, hdr.val_len) != hdr.check)
+			break;
+		shard.offsets[fnv1a(key, hdr.key_len)] = shard.scanned + pos;
+		pos += rec_len;
+	}
+	shard.scanned += pos;
+	return true;
+#endif
+} // ~AlignmentCache::refresh
+
+bool AlignmentCache::read_record(Shard & shard, uint64_t offset, const std::string & key, std::string & val)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	cache_record_header hdr;
+	if (pread(shard.fd, &hdr, sizeof(hdr), offset) != sizeof(hdr) || hdr.key_len != key.size())
+		return false;
+	std::string rec(hdr.key_len + hdr.val_len, 0);
+	if (pread(shard.fd, &rec[0], rec.size(), offset + sizeof(hdr)) != (ssize_t)rec.size()
+		|| rec.compare(0, hdr.key_len, key) != 0
+		|| record_check(rec.data(), hdr.key_len, rec.data() + hdr.key_len, hdr.val_len) != hdr.check)
+		return false;
+	val = rec.substr(hdr.key_len);
+	return true;
+#endif
+} // ~AlignmentCache::read_record
+
+/**
+ * @return false if the key of the current index part is not cached
+ */
+bool AlignmentCache::find(const std::string & key, std::string & val)
+{
+	std::string part_key_str = part_key + key;
+	uint64_t hash = fnv1a(part_key_str.data(), part_key_str.size());
+	uint32_t shard_num = hash % NUM_SHARDS;
+	Shard & shard = shards[shard_num];
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	auto it = shard.offsets.find(hash);
+	if (it == shard.offsets.end())
+	{
+		// may have been added by another process
+		if (!refresh(shard, shard_num))
+			return false;
+		it = shard.offsets.find(hash);
+		if (it == shard.offsets.end())
+			return false;
+	}
+	return read_record(shard, it->second, part_key_str, val);
+} // ~AlignmentCache::find
+
+void AlignmentCache::insert(const std::string & key, const std::string & val)
+{
+#if !defined(_WIN32)
+	std::string part_key_str = part_key + key;
+	uint64_t hash = fnv1a(part_key_str.data(), part_key_str.size());
+	uint32_t shard_num = hash % NUM_SHARDS;
+	Shard & shard = shards[shard_num];
+
+	cache_record_header hdr;
+	hdr.key_len = (uint32_t)part_key_str.size();
+	hdr.val_len = (uint32_t)val.size();
+	hdr.check = record_check(part_key_str.data(), hdr.key_len, val.data(), hdr.val_len);
+	std::string rec(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+	rec += part_key_str;
+	rec += val;
+
+	std::lock_guard<std::mutex> lock(shard.lock);
+	// the file may be rewritten by another process while waiting for the lock
+	for (int attempt = 0; ; ++attempt)
+	{
+		if (!refresh(shard, shard_num) || flock(shard.fd, LOCK_EX) == -1)
+			return;
+		struct stat st;
+		if (::stat(shard_file(shard_num).data(), &st) == 0 && (uint64_t)st.st_ino == shard.ino)
+			break;
+		flock(shard.fd, LOCK_UN);
+		if (attempt == 2)
+			return;
+	}
+
+	// cut off a record torn by a crash, or the records appended after it would never be found.
+	// No other process is appending while the lock is held.
+	struct stat st;
+	if (!refresh(shard, shard_num) || fstat(shard.fd, &st) == -1
+		|| ((uint64_t)st.st_size > shard.scanned && ftruncate(shard.fd, shard.scanned) == -1))
+	{
+		flock(shard.fd, LOCK_UN);
+		return;
+	}
+
+	off_t offset = lseek(shard.fd, 0, SEEK_END);
+	if (offset != -1 && write(shard.fd, rec.data(), rec.size()) == (ssize_t)rec.size())
+	{
+		shard.offsets[hash] = offset;
+		if (offset + rec.size() > shard_size)
+			compact(shard, shard_num, offset + rec.size()); // releases the lock
+	}
+	flock(shard.fd, LOCK_UN);
+#endif
+} // ~AlignmentCache::insert
+
+/**
+ * rewrite the shard file with its most recent records up to half of the size limit. Called holding the lock
+ * of the file, which is released when the file is closed after the new file took its name.
+ */
+void AlignmentCache::compact(Shard & shard, uint32_t shard_num, uint64_t size)
+{
+#if !defined(_WIN32)
+	std::vector<char> buf(size);
+	ssize_t len = pread(shard.fd, buf.data(), buf.size(), 0);
+
+	// offset, length of the valid records
+	std::vector<std::pair<size_t, size_t>> recs;
+	cache_record_header hdr;
+	for (size_t pos = 0; len > 0 && pos + sizeof(hdr) <= (size_t)len;)
+	{
+		std::memcpy(&hdr, buf.data() + pos, sizeof(hdr));
+		size_t rec_len = sizeof(hdr) + hdr.key_len + hdr.val_len;
+		const char* key = buf.data() + pos + sizeof(hdr);
+		if (pos + rec_len > (size_t)len || record_check(key, hdr.key_len, key + hdr.key_len, hdr.val_len) != hdr.check)
+			break;
+		recs.emplace_back(pos, rec_len);
+		pos += rec_len;
+	}
+
+	// the newest record of each key, newest first
+	std::vector<std::pair<size_t, size_t>> kept;
+	std::unordered_set<uint64_t> kept_keys;
+	uint64_t kept_size = 0;
+	for (auto rec = recs.rbegin(); rec != recs.rend() && kept_size + rec->second <= shard_size / 2; ++rec)
+	{
+		std::memcpy(&hdr, buf.data() + rec->first, sizeof(hdr));
+		if (kept_keys.insert(fnv1a(buf.data() + rec->first + sizeof(hdr), hdr.key_len)).second)
+		{
+			kept.push_back(*rec);
+			kept_size += rec->second;
+		}
+	}
+
+	auto file = shard_file(shard_num);
+	auto tmpfile = file + "." + std::to_string(getpid());
+	int fd = ::open(tmpfile.data(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+	if (fd == -1)
+		return;
+	bool is_written = true;
+	for (auto rec = kept.rbegin(); rec != kept.rend() && is_written; ++rec)
+		is_written = write(fd, buf.data() + rec->first, rec->second) == (ssize_t)rec->second;
+	::close(fd);
+	if (!is_written || rename(tmpfile.data(), file.data()) == -1)
+	{
+		unlink(tmpfile.data());
+		return;
+	}
+
+	::close(shard.fd);
+	shard.fd = -1;
+	refresh(shard, shard_num);
+#endif
+} // ~AlignmentCache::compact
@@ -44,6 +44,9 @@
 #define ASCENDING <
 #define DESCENDING >
 
+// nucleotides added on each side of the LIS of a long read before the SW alignment (see Runopts::long_read)
+const uint32_t LONG_READ_BAND = 100;
+
 
 // forward
 s_align2 copyAlignment(s_align* pAlign);
@@ -126,11 +129,10 @@ void compute_lis_alignment
 	//    For every reference, compute the number of kmer hits belonging to it
 	for (auto hit : read.id_win_hits)
 	{
-		seq_pos* positions_tbl_ptr = index.positions_tbl[hit.id].arr;
 		// loop all positions of id
-		for (uint32_t j = 0; j < index.positions_tbl[hit.id].size; j++)
+		for (auto pos = index.positions(hit.id), end = index.positions_end(hit.id); pos != end; ++pos)
 		{
-			uint32_t seq = positions_tbl_ptr++->seq;
+			uint32_t seq = pos->seq;
 			if ((map_it = kmer_count_map.find(seq)) != kmer_count_map.end())
 				map_it->second++; // sequence already in the map, increment its frequency value
 			else
@@ -203,16 +205,13 @@ void compute_lis_alignment
 		//
 		for ( auto hit: read.id_win_hits )
 		{
-			uint32_t num_hits = index.positions_tbl[hit.id].size;
-			seq_pos* positions_tbl_ptr = index.positions_tbl[hit.id].arr;
 			// loop through every position of id
-			for (uint32_t j = 0; j < num_hits; j++)
+			for (auto pos = index.positions(hit.id), end = index.positions_end(hit.id); pos != end; ++pos)
 			{
-				if (positions_tbl_ptr->seq == max_ref)
+				if (pos->seq == max_ref)
 				{
-					hits_per_ref.push_back(uint32pair(positions_tbl_ptr->pos, hit.win));
+					hits_per_ref.push_back(uint32pair(pos->pos, hit.win));
 				}
-				positions_tbl_ptr++;
 			}
 		}
 
@@ -288,18 +287,40 @@ void compute_lis_alignment
 						std::size_t align_ref_start = 0;
 						std::size_t align_que_start = 0;
 						std::size_t align_length = 0;
+						std::size_t que_length = 0; // length of the aligned part of the read
 						auto reflen = refs.buffer[max_ref].sequence.length();
 						uint32_t edges = 0;
 						if (opts.is_as_percent)
 							edges = (((double)opts.edges / 100.0)*read.sequence.length());
 						else
 							edges = opts.edges;
+						// long read: only the part of the read spanned by the LIS, extended by LONG_READ_BAND on each side,
+						// is aligned against the part of the reference spanned by the LIS extended by as much
+						//        ref |------------------------------------------|
+						//            que |-------------------------------------------...|
+						//                LIS |-----|     |-----|  |-----|
+						//             band |-|                           |-|
+						bool is_long_read = opts.long_read > 0 && read.sequence.length() > opts.long_read;
+						if (is_long_read)
+						{
+							auto const& first = match_chain[lis_arr[0]];
+							auto const& last = match_chain[lis_arr.back()];
+							std::size_t que_end = std::min<std::size_t>(read.sequence.length(), last.second + refstats.lnwin[index.index_num] + LONG_READ_BAND);
+							std::size_t ref_end = std::min<std::size_t>(reflen, last.first + (que_end - last.second) + LONG_READ_BAND);
+							align_que_start = first.second > LONG_READ_BAND ? first.second - LONG_READ_BAND : 0;
+							align_ref_start = first.first > first.second - align_que_start + LONG_READ_BAND
+								? first.first - (first.second - align_que_start) - LONG_READ_BAND : 0;
+							align_length = ref_end - align_ref_start;
+							// the hits of a spurious LIS can be scattered over the read, while the reference region
+							// is bounded by the reference length. The read region is bounded by as much.
+							que_length = std::min<std::size_t>(que_end - align_que_start, align_length + 2 * LONG_READ_BAND);
+						}
 						// part of the read hangs off (or matches exactly) the beginning of the reference seq
 						//            ref |-----------------------------------|
 						// que |-------------------|
 						//             LIS |-----|
 						//
-						if (lcs_ref_start < lcs_que_start)
+						else if (lcs_ref_start < lcs_que_start)
 						{
 							align_ref_start = 0;
 							align_que_start = lcs_que_start - lcs_ref_start;
@@ -370,13 +391,16 @@ void compute_lis_alignment
 							}
 						}
 
+						if (!is_long_read)
+							que_length = align_length - head - tail;
+
 						// put read into 04 encoding before SSW
 						if (read.is03) 
 							read.flip34();
                        
 						// create profile for read
 						s_profile* profile = 0;
-						profile = ssw_init((int8_t*)(&read.isequence[0] + align_que_start), (align_length - head - tail), &read.scoring_matrix[0], 5, 2);
+						profile = ssw_init((int8_t*)(&read.isequence[0] + align_que_start), que_length, &read.scoring_matrix[0], 5, 2);
 
 						s_align* result = 0;
 
@@ -411,6 +435,8 @@ void compute_lis_alignment
 								read.is_hit = true;
 								++readstats.total_reads_aligned;
 								++readstats.reads_matched_per_db[index.index_num];
+								++read.stats_delta.total_reads_aligned;
+								read.stats_delta.add_matched(index.index_num, 1);
 							}
 
 							// add the offset calculated by the LCS (from the beginning of the sequence)
@@ -493,9 +519,11 @@ void compute_lis_alignment
 
 										// decrement number of reads mapped to database with lower score
 										--readstats.reads_matched_per_db[read.hits_align_info.alignv[smallest_score_index].index_num];
+										read.stats_delta.add_matched(read.hits_align_info.alignv[smallest_score_index].index_num, -1);
 
 										// increment number of reads mapped to database with higher score
 										++readstats.reads_matched_per_db[index.index_num];
+										read.stats_delta.add_matched(index.index_num, 1);
 
 										// replace an old smallest scored alignment with the new one
 										read.hits_align_info.alignv[smallest_score_index] = copyAlignment(result);
@@ -578,7 +606,10 @@ void compute_lis_alignment
 								if ( align_id_round >= opts.min_id && align_cov_round >= opts.min_cov && read_to_count)
 								{
 									if (!readstats.is_total_reads_mapped_cov)
+									{
 										++readstats.total_reads_mapped_cov; // also calculated in post-processor 'computeStats'
+										++read.stats_delta.total_reads_mapped_cov;
+									}
 									read_to_count = false;
 
 									// do not output read for de novo OTU clustering
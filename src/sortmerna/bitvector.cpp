@@ -54,33 +54,7 @@ init_win_f (
 	int numbvs)
 {
 	/// [w_1] forward
-
-	UCHAR *reset  = bittable_000;
-
-	/// set manually the bitvectors at position i = 0 of [w_1] reverse
-	for ( int bitn = 2; bitn >= 0; bitn-- )
-	{
-		*(reset+*ptrf++) |= (1<<bitn);
-	}
-
-	/// set the bitvectors for positions i > 0 of [w_2] forward
-	UCHAR *setbit = bittable_010;
-	UCHAR *win_ptr1 = bittable_000;
-	UCHAR *win_ptr2 = bittable_010;
-
-	for ( int i = 1; i <= numbvs; i++ )
-	{
-	 	*win_ptr2 = (*win_ptr1++)<<1;
-	  	*win_ptr2++ &= mask_4;
-	  	/// if i%4 == 0
-		if ( !(i&3) )
-	  	{
-			/// set the LSB of candidate nt bitvector to 1
-			*(setbit+*ptrf++) |= 1;
-			/// reset the setbit pointer to subsequent bitvector
-			setbit = win_ptr2;
-	  	}	
-	}
+	init_win<0, 1>(ptrf, bittable_000, bittable_010, numbvs);
 }//~init_win_f()
 
 
@@ -96,32 +70,7 @@ init_win_r (
 	int numbvs )
 {
  	/// [w_1] reverse
-
-	UCHAR *reset  = bittable_000;
-
-	/// set manually the bitvectors at position i = 0 of [w_1] reverse
-	for ( int bitn = 2; bitn >= 0; bitn-- )
-	{
-		*(reset+*ptrr--) |= (1<<bitn);
-	}
-
-	/// set the bitvectors for positions i > 0 of [w_2] forward (note: mask = 15 = 00001111; this is to keep the bitvectors of length 4)
-
-	UCHAR *setbit = bittable_010;
-	UCHAR *win_ptr1 = bittable_000;
-	UCHAR *win_ptr2 = bittable_010;
-
-	for ( int i = 1; i <= numbvs; i++ )
-	{
-	 	*win_ptr2 = (*win_ptr1++)<<1;
-	  	*win_ptr2++ &= mask_4;
-		if ( !(i&3) )
-	  	{
-			*(setbit+*ptrr--) |= 1;
-			setbit = win_ptr2;
-	  	}
-	}
-
+	init_win<0, -1>(ptrr, bittable_000, bittable_010, numbvs);
 }//~init_win_r()
 
 
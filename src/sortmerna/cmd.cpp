@@ -98,7 +98,7 @@ void CmdSession::cmdRead(Runopts & opts, std::string & cmd)
 	{
 		if (isdb)
 		{
-			KeyValueDatabase kvdb(opts.kvdbdir.string());
+			KeyValueDatabase kvdb(opts.kvdbdir.string(), opts.run_fingerprint);
 			read.clear();
 			read.init(opts); // TODO: pass the required reads file number i.e. 0 or 1 to generate a correct read.id
 			ss << read.matchesToJson() << std::endl;
@@ -140,7 +140,7 @@ void CmdSession::cmdIndex(Runopts & opts, std::string & cmd)
 		return;
 	}
 
-	KeyValueDatabase kvdb(opts.kvdbdir.string());
+	KeyValueDatabase kvdb(opts.kvdbdir.string(), opts.run_fingerprint);
 	Readstats readstats(opts, kvdb);
 	Refstats refstats(opts, readstats);
 	References refs;
@@ -157,9 +157,9 @@ void CmdSession::cmdIndex(Runopts & opts, std::string & cmd)
 	refs.load(std::stoi(idxval), std::stoi(partval), opts, refstats);
 	// find kmer prefix hash
 	uint32_t kmerhash = read.hashKmer(std::stoi(posval), 9);
-	if (kmerhash > index.lookup_tbl.size() - 1)
+	if (kmerhash > index.lookup_size - 1)
 	{
-		std::cout << "Hash: " << kmerhash << " is larger than Lookup table size: " << index.lookup_tbl.size() << std::endl;
+		std::cout << "Hash: " << kmerhash << " is larger than Lookup table size: " << index.lookup_size << std::endl;
 		return;
 	}
 	std::cout << "read.id: " << readid << " Kmer position: " << posval << " DB matches: " << index.lookup_tbl[kmerhash].count << std::endl;
@@ -182,7 +182,8 @@ void CmdSession::cmdIndex(Runopts & opts, std::string & cmd)
 
 	// search burst-trie
 	traversetrie_align(
-		index.lookup_tbl[kmerhash].trie_F,
+		index.trie_F(kmerhash),
+		index.trie_F(kmerhash),
 		0,
 		0,
 		&bitvec[0],
@@ -202,28 +203,27 @@ void CmdSession::cmdIndex(Runopts & opts, std::string & cmd)
 
 	for (auto it = id_hits.begin(); it != id_hits.end(); ++it)
 	{
-		// sort matches by Reference ID
-		std::sort(&index.positions_tbl[it->id].arr[0],
-			&index.positions_tbl[it->id].arr[index.positions_tbl[it->id].size - 1],
-			[](seq_pos a, seq_pos b) { return a.seq > b.seq; });
+		// sort matches by Reference ID. The index is read-only - sort a copy.
+		std::vector<seq_pos> arr(index.positions(it->id), index.positions_end(it->id));
+		std::sort(arr.begin(), arr.end(), [](seq_pos a, seq_pos b) { return a.seq > b.seq; });
 
-		std::cout << "kmer iD: " << it->id << " Num hits: " << index.positions_tbl[it->id].size << std::endl;
+		std::cout << "kmer iD: " << it->id << " Num hits: " << arr.size() << std::endl;
 
-		for ( uint32_t i = 0; i < index.positions_tbl[it->id].size; ++i)
+		for ( uint32_t i = 0; i < arr.size(); ++i)
 		{
 			// populate frequency map
-			auto map_it = seq_kmer_freq_map.find(index.positions_tbl[it->id].arr[i].seq);
+			auto map_it = seq_kmer_freq_map.find(arr[i].seq);
 			if (map_it != seq_kmer_freq_map.end())
 				map_it->second++; // increment the frequency
 			else
-				seq_kmer_freq_map[index.positions_tbl[it->id].arr[i].seq] = 1; // add seq to map with freq = 1
+				seq_kmer_freq_map[arr[i].seq] = 1; // add seq to map with freq = 1
 
-			if (index.positions_tbl[it->id].arr[i].seq == std::stoi(refid))
+			if (arr[i].seq == std::stoi(refid))
 				std::cout << "Found match in Ref: " << std::stoi(refid) 
-				<< " at Ref pos: " << index.positions_tbl[it->id].arr[i].pos 
+				<< " at Ref pos: " << arr[i].pos 
 				<< " hit number: " << i << std::endl;
 		}
-		//std::cout << "Max Reference number: " << index.positions_tbl[it->id].arr[0].seq << std::endl;
+		//std::cout << "Max Reference number: " << arr[0].seq << std::endl;
 	}
 
 	// copy frequency map pairs to vector
@@ -267,7 +267,7 @@ void CmdSession::cmd_max_ref_part(Runopts & opts, std::string & cmd)
 		return;
 	}
 
-	KeyValueDatabase kvdb(opts.kvdbdir.string());
+	KeyValueDatabase kvdb(opts.kvdbdir.string(), opts.run_fingerprint);
 	Readstats readstats(opts, kvdb);
 	Refstats refstats(opts, readstats);
 	References refs;
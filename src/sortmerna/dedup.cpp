@@ -0,0 +1,173 @@
+/**
+ * FILE: dedup.cpp
+ * Created: Oct 18, 2026 Sun
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <functional> // std::hash
+#include <algorithm>
+#include <cstring> // memcpy
+
+#include "dedup.hpp"
+#include "read.hpp"
+#include "options.hpp"
+
+DedupEntry::DedupEntry(std::string key, Read & read)
+	:
+	key(std::move(key)),
+	result(read.toString()),
+	stats(read.stats_delta),
+	is_valid(read.isValid)
+{}
+
+DedupEntry::DedupEntry(std::string key, const std::string & bstr)
+	:
+	key(std::move(key))
+{
+	uint32_t num_db = 0;
+	uint32_t valid = 0;
+	size_t offset = 0;
+	std::memcpy(&valid, bstr.data() + offset, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+	is_valid = valid != 0;
+	std::memcpy(&stats.total_reads_aligned, bstr.data() + offset, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+	std::memcpy(&stats.total_reads_mapped_cov, bstr.data() + offset, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+	std::memcpy(&num_db, bstr.data() + offset, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+	stats.reads_matched_per_db.resize(num_db);
+	std::memcpy(stats.reads_matched_per_db.data(), bstr.data() + offset, num_db * sizeof(int32_t));
+	offset += num_db * sizeof(int32_t);
+	result = bstr.substr(offset);
+} // ~DedupEntry::DedupEntry
+
+/* is_valid | total_reads_aligned | total_reads_mapped_cov | size of reads_matched_per_db | reads_matched_per_db | result */
+std::string DedupEntry::toString() const
+{
+	uint32_t num_db = (uint32_t)stats.reads_matched_per_db.size();
+	uint32_t valid = is_valid ? 1 : 0;
+	std::string buf;
+	buf.append(reinterpret_cast<const char*>(&valid), sizeof(uint32_t));
+	buf.append(reinterpret_cast<const char*>(&stats.total_reads_aligned), sizeof(uint32_t));
+	buf.append(reinterpret_cast<const char*>(&stats.total_reads_mapped_cov), sizeof(uint32_t));
+	buf.append(reinterpret_cast<const char*>(&num_db), sizeof(uint32_t));
+	buf.append(reinterpret_cast<const char*>(stats.reads_matched_per_db.data()), num_db * sizeof(int32_t));
+	buf += result;
+	return buf;
+} // ~DedupEntry::toString
+
+/* copy the alignment to a duplicate of the aligned read */
+void DedupEntry::apply(Read & read, Readstats & readstats) const
+{
+	if (result.size() > 0)
+		read.fromString(result); // otherwise not aligned, and the state is not stored
+	read.isValid = is_valid;
+	stats.apply(readstats);
+} // ~DedupEntry::apply
+
+DedupCache::DedupCache(Runopts & opts)
+	:
+	num_reads(0),
+	num_duplicates(0),
+	num_stored(0),
+	max_entries(opts.dedup_reads),
+	shards(new Shard[NUM_SHARDS]),
+	store(opts)
+{
+	for (uint32_t i = 0; i < NUM_SHARDS; ++i)
+		shards[i].max_entries = max_entries / NUM_SHARDS + (i < max_entries % NUM_SHARDS ? 1 : 0);
+}
+
+/* called after the index part is loaded */
+void DedupCache::set_part(Runopts & opts, Index & index, Refstats & refstats)
+{
+	store.set_part(opts, index, refstats);
+}
+
+/**
+ * The read sequence and the alignment state of the read. Reads without an alignment have an empty state
+ * (see Read::toString) i.e. are keyed on the sequence only.
+ */
+std::string DedupCache::key(Read & read)
+{
+	return read.sequence + '\n' + read.toString();
+}
+
+/**
+ * @return false if the key is not cached. Otherwise the entry is copied into 'entry' and becomes the most recently used.
+ */
+bool DedupCache::find(const std::string & key, DedupEntry & entry)
+{
+	++num_reads;
+	if (max_entries > 0)
+	{
+		size_t hash = std::hash<std::string>{}(key);
+		Shard & shard = shards[hash % NUM_SHARDS];
+		std::lock_guard<std::mutex> lock(shard.lock);
+		auto it = shard.map.find(hash);
+		if (it != shard.map.end() && it->second->key == key)
+		{
+			shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+			entry = *it->second;
+			++num_duplicates;
+			return true;
+		}
+	}
+
+	std::string bstr;
+	if (!store.is_enabled() || !store.find(key, bstr) || bstr.size() < 4 * sizeof(uint32_t))
+		return false;
+	entry = DedupEntry(key, bstr);
+	++num_duplicates;
+	++num_stored;
+	if (max_entries > 0)
+		insert_memory(DedupEntry(entry));
+	return true;
+} // ~DedupCache::find
+
+/* add the entry of a read just aligned */
+void DedupCache::insert(DedupEntry && entry)
+{
+	if (store.is_enabled())
+		store.insert(entry.key, entry.toString());
+	if (max_entries > 0)
+		insert_memory(std::move(entry));
+} // ~DedupCache::insert
+
+/**
+ * Add the entry as the most recently used. The same key may be added by several Processors aligning
+ * its reads at the same time - the last one is kept.
+ */
+void DedupCache::insert_memory(DedupEntry && entry)
+{
+	size_t hash = std::hash<std::string>{}(entry.key);
+	Shard & shard = shards[hash % NUM_SHARDS];
+	std::lock_guard<std::mutex> lock(shard.lock);
+	auto it = shard.map.find(hash);
+	if (it != shard.map.end())
+	{
+		*it->second = std::move(entry); // same key, or a hash collision
+		shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+		return;
+	}
+	shard.entries.push_front(std::move(entry));
+	shard.map.emplace(hash, shard.entries.begin());
+	if (shard.entries.size() > shard.max_entries)
+	{
+		shard.map.erase(std::hash<std::string>{}(shard.entries.back().key));
+		shard.entries.pop_back();
+	}
+} // ~DedupCache::insert_memory
+
+void DedupCache::clear()
+{
+	for (uint32_t i = 0; i < NUM_SHARDS; ++i)
+	{
+		std::lock_guard<std::mutex> lock(shards[i].lock);
+		shards[i].map.clear();
+		shards[i].entries.clear();
+	}
+	num_reads = 0;
+	num_duplicates = 0;
+	num_stored = 0;
+} // ~DedupCache::clear
@@ -45,12 +45,26 @@
 #include <array>
 #include <sstream>
 #include <filesystem>
+#include <cstring>
+#include <csignal>
+#include <atomic>
+#include <thread>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h> // flock
+#else
+#include <process.h> // getpid
+#endif
 
 #include "index.hpp"
 #include "indexdb.hpp"
 #include "paralleltraversal.hpp"
 #include "references.hpp"
 #include "refstats.hpp"
+#include "ThreadPool.hpp"
 
 // forward
 std::string string_hash(const std::string& val); // util.cpp
@@ -58,6 +72,7 @@ std::string string_hash(const std::string& val); // util.cpp
  /**
   * Initilize the index.
   * If index files do not exist or are empty build the index.
+  * If index files exist and 'index_append' is set, index the sequences appended to the reference files.
   */
 Index::Index(Runopts & opts)
 {
@@ -110,7 +125,12 @@ Index::Index(Runopts & opts)
 				}
 			}
 		}
-		if (count_indexed > 0)
+		if (count_indexed > 0 && opts.is_index_append)
+		{
+			std::cout << STAMP << "Found " << count_indexed << " non-empty index files. Appending the new reference sequences." << std::endl;
+			build_index(opts);
+		}
+		else if (count_indexed > 0)
 		{
 			opts.is_index_built = true;
 			std::cout << STAMP << "Found " << count_indexed << " non-empty index files. Skipping indexing." << std::endl;
@@ -123,251 +143,936 @@ Index::Index(Runopts & opts)
 	}
 } // ~Index::Index
 
-void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats & refstats)
+/**
+ * name of the relocatable image file of the index part
+ */
+std::string Index::image_file(Runopts & opts, uint32_t idx_num, uint32_t idx_part)
 {
-	// STEP 1: load the kmer 'count' variables (dbname.kmer.dat)
-	std::string idxfile = opts.indexfiles[idx_num].second + ".kmer_" + std::to_string(idx_part) + ".dat";
-	std::ifstream inkmer(idxfile, std::ios::in | std::ios::binary);
+	return opts.indexfiles[idx_num].second + ".img_" + std::to_string(idx_part) + ".dat";
+} // ~Index::image_file
 
-	if (!inkmer.good())
-	{
-		std::stringstream ss;
-		ss << STAMP << "The index " << idxfile << " does not exist.";
-		ERR(ss.str())
-		exit(EXIT_FAILURE);
-	}
-
-	uint32_t limit = 1 << refstats.lnwin[idx_num];
+/**
+ * fingerprint of the index part: the content of the index statistics, and the size and the modification time
+ * of the part files i.e. changes when the index is re-built (see AlignmentCache)
+ */
+std::string Index::fingerprint(Runopts & opts, uint32_t idx_num, uint32_t idx_part)
+{
+	std::stringstream ss;
+	auto const& idxpfx = opts.indexfiles[idx_num].second;
+	std::ifstream stats(idxpfx + ".stats", std::ios::in | std::ios::binary);
+	ss << string_hash(std::string(std::istreambuf_iterator<char>(stats), std::istreambuf_iterator<char>()));
 
-	for (uint32_t i = 0; i < limit && !inkmer.eof(); i++)
+	auto part_str = std::to_string(idx_part);
+	for (auto const& file : { image_file(opts, idx_num, idx_part), idxpfx + ".kmer_" + part_str + ".dat",
+		idxpfx + ".bursttrie_" + part_str + ".dat", idxpfx + ".pos_" + part_str + ".dat",
+		MinimizerIndex::file_name(idxpfx, idx_part) })
 	{
-		lookup_tbl.push_back(kmer());
-		inkmer.read(reinterpret_cast<char*>(&(lookup_tbl[i].count)), sizeof(uint32_t));
+		std::error_code ec;
+		auto size = std::filesystem::file_size(file, ec);
+		if (ec) continue;
+		ss << ";" << size << ";" << std::filesystem::last_write_time(file, ec).time_since_epoch().count();
 	}
-	inkmer.close();
+	return ss.str();
+} // ~Index::fingerprint
+
+static void truncated(const std::string &file)
+{
+	std::stringstream ss;
+	ss << STAMP << "The index " << file << " is truncated or corrupted. Build the index anew.";
+	ERR(ss.str());
+	exit(EXIT_FAILURE);
+} // ~truncated
 
-	// STEP 2: load the burst tries ( bursttrief.dat, bursttrier.dat )
-	std::string btriefile = opts.indexfiles[idx_num].second + ".bursttrie_" + std::to_string(idx_part) + ".dat";
-	std::ifstream btrie(btriefile, std::ios::in | std::ios::binary);
-	if (!btrie.good())
+/* read the bytes [from, to) of the file into the buffer */
+static void read_range(const std::string &file, uint64_t from, uint64_t to, std::vector<char> &buf)
+{
+	std::ifstream ifs(file, std::ios::in | std::ios::binary);
+	if (!ifs.good())
 	{
 		std::stringstream ss;
-		ss << STAMP << "The index " << btriefile << " does not exist.";
-		ERR(ss.str())
+		ss << STAMP << "The index " << file << " does not exist.";
+		ERR(ss.str());
 		exit(EXIT_FAILURE);
 	}
+	buf.resize(to - from);
+	ifs.seekg(from);
+	if (!ifs.read(buf.data(), buf.size()))
+		truncated(file);
+} // ~read_range
+
+/**
+ * deserialize the mini burst tries of the L/2-mers [first, last) from the '.bursttrie' file bytes 'buf'
+ *
+ * The tries are appended to the 'arena', and their offsets set in the look-up table are relative to the arena.
+ * The tries are stored in the file in the breadth-first order. Each trie is laid out as its trie nodes in the same
+ * order followed by its buckets (see TrieNode).
+ */
+static void load_tries(const std::vector<char> &buf, uint32_t first, uint32_t last, std::vector<kmer_entry> &lookup, 
+	std::vector<char> &arena, const std::string &btriefile)
+{
+	size_t bpos = 0; // read position in the file buffer
+	auto read_buf = [&](void* dst, size_t len) {
+		if (bpos + len > buf.size())
+			truncated(btriefile);
+		memcpy(dst, &buf[bpos], len);
+		bpos += len;
+	};
+
+	std::vector<TrieNode> nodes; // trie nodes of the current trie in the breadth-first order
+	std::vector<char> buckets; // buckets of the current trie
 
 	// loop through all 9-mers
-	for (uint32_t i = 0; i < limit && !btrie.eof(); i++)
+	for (uint32_t i = first; i < last; i++)
 	{
 		uint32_t sizeoftries[2] = { 0 };
-		char *dst = NULL; // ptr to block of memory for two mini-burst tries
 
 		// the size of both mini-burst tries
+		read_buf(sizeoftries, sizeof(sizeoftries));
+
+		// no tries
+		if (lookup[i].count == 0) continue;
+
+		// load 2 burst tries per 9-mer
 		for (int j = 0; j < 2; j++)
 		{
-			btrie.read(reinterpret_cast<char*>(&sizeoftries[j]), sizeof(uint32_t));
-		}
+			// mini-burst trie does not exist
+			if (sizeoftries[j] == 0) continue;
 
-		// allocate contiguous memory for both mini-burst tries if they exist
-		if (lookup_tbl[i].count != 0)
-		{
-			dst = new char[(sizeoftries[0] + sizeoftries[1])]();
-			if (dst == NULL)
+			nodes.clear();
+			buckets.clear();
+
+			// create a root trie node
+			nodes.resize(4, TrieNode());
+			// trie node elements given in the binary file are in the breadth-first order
+			// i.e. the elements are processed in the same order as they are stored
+			for (size_t node = 0; node < nodes.size(); ++node)
 			{
-				std::stringstream ss;
-				ss << STAMP << "Failed to allocate memory for mini-burst tries";
-				ERR(ss.str())
-				exit(EXIT_FAILURE);
+				char flag;
+				read_buf(&flag, sizeof(char));
+				nodes[node].flag = flag;
 			}
-			// load 2 burst tries per 9-mer
-			for (int j = 0; j < 2; j++)
+			for (size_t node = 0; node < nodes.size(); ++node)
 			{
-				// mini-burst trie exists
-				if (sizeoftries[j] != 0)
+				// what does the node element point to
+				switch (nodes[node].flag)
 				{
-					NodeElement newnode[4]; // create a root trie node
-					// copy the root trie node into the beginning of burst trie array
-					memcpy(dst, &newnode[0], sizeof(NodeElement) * 4);
-					memset(dst, 0, sizeof(NodeElement) * 4);
-					if (j == 0) lookup_tbl[i].trie_F = (NodeElement*)dst;
-					else lookup_tbl[i].trie_R = (NodeElement*)dst;
-					// queue to store the trie nodes as we create them
-					std::deque<NodeElement*> nodes;
-					nodes.push_back((NodeElement*)dst);
-					((NodeElement *&)dst) += 4;
-					// queue to store the flags of node elements given in the binary file
-					std::deque<char> flags;
-					// read the first trie node
-					for (int i = 0; i < 4; i++)
+				// empty
+				case 0:
+					break;
+				// trie node - read the flags of its elements
+				case 1:
+				{
+					nodes[node].offset = nodes.size() * sizeof(TrieNode);
+					for (int m = 0; m < 4; m++)
 					{
-						char tmp;
-						btrie.read(reinterpret_cast<char*>(&tmp), sizeof(char));
-						flags.push_back(tmp);
+						char flag;
+						read_buf(&flag, sizeof(char));
+						nodes.push_back(TrieNode());
+						nodes.back().flag = flag;
 					}
-					// build the mini-burst trie
-					while (!nodes.empty())
-					{
-						// ptr to traverse each trie node
-						NodeElement* node = nodes.front();
-						// trie node elements
-						for (int i = 0; i < 4; i++)
-						{
-							unsigned char flag = flags.front();
-							// what does the node element point to
-							switch (flag)
-							{
-								// set values to 0
-							case 0:
-							{
-								node->flag = 0;
-								node->size = 0;
-								node->nodetype.trie = NULL;
-							}
-							break;
-							// trie node
-							case 1:
-							{
-								// read the trie node
-								for (int i = 0; i < 4; i++)
-								{
-									char tmp;
-									btrie.read(reinterpret_cast<char*>(&tmp), sizeof(char));
-									flags.push_back(tmp);
-								}
-								node->flag = 1;
-								node->size = 0;
-								NodeElement newnode[4];
-								memcpy((NodeElement*)dst, &newnode[0], sizeof(NodeElement) * 4);
-								nodes.push_back((NodeElement*)dst);
-								node->nodetype.trie = (NodeElement*)dst;
-								((NodeElement *&)dst) += 4;
-							}
-							break;
-							// bucket
-							case 2:
-							{
-								uint32_t sizeofbucket = 0;
-								// read the bucket info
-								btrie.read(reinterpret_cast<char*>(&sizeofbucket), sizeof(uint32_t));
-
-								char* bucket = new char[sizeofbucket]();
-								if (bucket == NULL)
-								{
-									std::stringstream ss;
-									ss << STAMP << "Failed to allocate memory for allocate bucket";
-									fprintf(stderr, "\n  %sERROR%s:  (paralleltraversal.cpp)\n", RED, COLOFF);
-									exit(EXIT_FAILURE);
-								}
-								btrie.read(reinterpret_cast<char*>(bucket), sizeofbucket);
-								// copy the bucket into the burst trie array
-								memcpy((void*)dst, (void*)bucket, sizeofbucket);
-								delete[] bucket;
-								bucket = NULL;
-								// assign pointers from trie node to the bucket
-								node->flag = flag;
-								node->nodetype.bucket = dst;
-								node->size = sizeofbucket;
-								dst = ((char *)dst) + sizeofbucket;
-							}
-							break;
-							// ?
-							default:
-							{
-								fprintf(stderr, "\n  %sERROR%s: flag is set to %d (load_index)\n", RED, COLOFF, flag);
-								exit(EXIT_FAILURE);
-							}
-							break;
-							}
-							flags.pop_front();
-							node++;
-						}//~loop through 4 node elements in a trie node 
-						nodes.pop_front();
-					}//~while !nodes.empty()
-				}//~if mini-burst trie exists
-				else
+				}
+				break;
+				// bucket. The offset is set when the number of trie nodes is known.
+				case 2:
 				{
-					if (j == 0) lookup_tbl[i].trie_F = NULL;
-					else lookup_tbl[i].trie_R = NULL;
+					uint32_t sizeofbucket = 0;
+					// read the bucket info
+					read_buf(&sizeofbucket, sizeof(uint32_t));
+					nodes[node].offset = buckets.size();
+					nodes[node].size = sizeofbucket;
+					buckets.resize(buckets.size() + sizeofbucket);
+					read_buf(&buckets[nodes[node].offset], sizeofbucket);
 				}
-			}//~for both mini-burst tries
-		}//~if ( sizeoftries != 0 )
-		else
-		{
-			lookup_tbl[i].trie_F = NULL;
-			lookup_tbl[i].trie_R = NULL;
-		}
+				break;
+				// ?
+				default:
+				{
+					fprintf(stderr, "\n  %sERROR%s: flag is set to %d (load_index)\n", RED, COLOFF, (int)nodes[node].flag);
+					exit(EXIT_FAILURE);
+				}
+				break;
+				}
+			}
+
+			// the size of the trie in the builder layout
+			if (nodes.size() / 4 * 4 * sizeof(NodeElement) + buckets.size() != sizeoftries[j])
+				truncated(btriefile);
+
+			// the buckets follow the trie nodes
+			uint32_t nodes_size = nodes.size() * sizeof(TrieNode);
+			for (auto &node : nodes)
+				if (node.flag == 2) node.offset += nodes_size;
+
+			size_t root = arena.size();
+			if (j == 0) lookup[i].trie_F = root / TRIE_ALIGN;
+			else lookup[i].trie_R = root / TRIE_ALIGN;
+
+			size_t trie_size = (nodes_size + buckets.size() + TRIE_ALIGN - 1) / TRIE_ALIGN * TRIE_ALIGN;
+			arena.resize(root + trie_size, 0);
+			memcpy(&arena[root], nodes.data(), nodes_size);
+			memcpy(&arena[root + nodes_size], buckets.data(), buckets.size());
+		}//~for both mini-burst tries
 	}//~for all 9-mers in the look-up table
-	btrie.close();
 
-	// STEP 3: load the position reference tables (pos.dat)
-	std::string posfile = opts.indexfiles[idx_num].second + ".pos_" + std::to_string(idx_part) + ".dat";
-	std::ifstream inreff(posfile, std::ios::in | std::ios::binary);
+	if (bpos != buf.size())
+		truncated(btriefile);
+} // ~load_tries
+
+/**
+ * deserialize the positions of the (L+1)-mers [first, last) from the '.pos' file bytes 'buf' into the pool
+ * starting at 'pool_pos'
+ */
+static void load_positions(const std::vector<char> &buf, uint32_t first, uint32_t last, uint64_t pool_pos, 
+	std::vector<uint64_t> &positions, std::vector<seq_pos> &pool, const std::string &posfile)
+{
+	size_t bpos = 0;
+	for (uint32_t i = first; i < last; i++)
+	{
+		uint32_t size = 0;
+		if (bpos + sizeof(uint32_t) > buf.size())
+			truncated(posfile);
+		memcpy(&size, &buf[bpos], sizeof(uint32_t));
+		bpos += sizeof(uint32_t);
+		if (pool_pos + size > pool.size() || bpos + sizeof(seq_pos) * size > buf.size())
+			truncated(posfile);
+		memcpy(&pool[pool_pos], &buf[bpos], sizeof(seq_pos) * size);
+		bpos += sizeof(seq_pos) * size;
+		pool_pos += size;
+		positions[i + 1] = pool_pos;
+	}
+	if (bpos != buf.size())
+		truncated(posfile);
+} // ~load_positions
 
-	if (!inreff.good())
+/* seed length, number of parts and positions encoding of the index from its '.stats' file */
+void read_index_layout(const std::string & stats_file, uint32_t & lnwin, uint16_t & num_parts, bool & is_packed)
+{
+	std::ifstream stats(stats_file, std::ios::binary);
+	size_t filesize = 0;
+	uint32_t fasta_len = 0;
+	double background_freq[4];
+	uint64_t full_len = 0;
+	uint64_t numseq = 0;
+	uint32_t num_sq = 0;
+	stats.read(reinterpret_cast<char*>(&filesize), sizeof(size_t));
+	stats.read(reinterpret_cast<char*>(&fasta_len), sizeof(uint32_t));
+	stats.seekg(fasta_len, std::ios::cur);
+	stats.read(reinterpret_cast<char*>(background_freq), sizeof(background_freq));
+	stats.read(reinterpret_cast<char*>(&full_len), sizeof(uint64_t));
+	stats.read(reinterpret_cast<char*>(&lnwin), sizeof(uint32_t));
+	stats.read(reinterpret_cast<char*>(&numseq), sizeof(uint64_t));
+	stats.read(reinterpret_cast<char*>(&num_parts), sizeof(uint16_t));
+	stats.seekg(sizeof(index_parts_stats) * num_parts, std::ios::cur);
+	stats.read(reinterpret_cast<char*>(&num_sq), sizeof(uint32_t));
+	for (uint32_t i = 0; i < num_sq && stats; ++i)
+	{
+		uint32_t len_id = 0;
+		stats.read(reinterpret_cast<char*>(&len_id), sizeof(uint32_t));
+		stats.seekg(len_id + sizeof(uint32_t), std::ios::cur);
+	}
+	if (!stats)
 	{
-		fprintf(stderr, "\n  ERROR: The database name '%s' does not exist.\n\n", posfile.c_str());
+		std::stringstream ss;
+		ss << STAMP << "Cannot read the index file [" << stats_file << "]";
+		ERR(ss.str());
 		exit(EXIT_FAILURE);
 	}
 
-	uint32_t size = 0;
-	inreff.read(reinterpret_cast<char*>(&number_elements), sizeof(uint32_t));
-	positions_tbl.reserve(number_elements); // = new kmer_origin[number_elements]();
+	// the positions encoding follows the sequence headers, if the index was built with it (see build_index)
+	uint32_t packed_pos = 0;
+	is_packed = stats.read(reinterpret_cast<char*>(&packed_pos), sizeof(uint32_t)) && packed_pos != 0;
+} // ~read_index_layout
+
+/**
+ * bit-pack the positions of each (L+1)-mer (see IndexImageHeader). The positions of each (L+1)-mer are sorted
+ * on (seq, pos), and the 'positions' table is set to the bit offsets of the packed positions.
+ */
+void Index::pack_positions(std::vector<uint64_t> & positions, std::vector<seq_pos> & pool, std::vector<unsigned char> & packed)
+{
+	uint64_t bit = 0;
+	auto put = [&packed, &bit](uint32_t val, uint32_t width) {
+		while (width > 0)
+		{
+			uint32_t shift = bit & 7;
+			uint32_t num = std::min(8 - shift, width);
+			packed[bit >> 3] |= (unsigned char)((val & ((1u << num) - 1)) << shift);
+			val >>= num;
+			bit += num;
+			width -= num;
+		}
+	};
+	auto width = [](uint32_t val) {
+		uint32_t num = 1;
+		while (num < 32 && (val >> num) != 0) ++num;
+		return num;
+	};
+
+	// the packed pool is at most the size of the raw pool i.e. the widths are at most 32 bits
+	packed.assign(sizeof(seq_pos) * pool.size() + (PACKED_HEADER_BITS * (positions.size() - 1) + 7) / 8 + 8, 0);
+	uint64_t start = positions[0];
+	for (size_t id = 0; id + 1 < positions.size(); ++id)
+	{
+		auto first = pool.begin() + start;
+		auto last = pool.begin() + positions[id + 1];
+		start = positions[id + 1];
+		positions[id] = bit;
+		if (first == last)
+			continue;
+
+		std::sort(first, last, [](const seq_pos & a, const seq_pos & b) {
+			return a.seq < b.seq || (a.seq == b.seq && a.pos < b.pos);
+		});
+		uint32_t max_delta = 0;
+		uint32_t max_pos = 0;
+		for (auto it = first; it != last; ++it)
+		{
+			max_delta = std::max(max_delta, it->seq - (it == first ? 0 : (it - 1)->seq));
+			max_pos = std::max(max_pos, it->pos);
+		}
+		uint32_t ws = width(max_delta);
+		uint32_t wp = width(max_pos);
+		put(ws - 1, 5);
+		put(wp - 1, 5);
+		for (auto it = first; it != last; ++it)
+		{
+			put(it->seq - (it == first ? 0 : (it - 1)->seq), ws);
+			put(it->pos, wp);
+		}
+	}
+	positions.back() = bit;
+	packed.resize((bit + 7) / 8 + 8); // the decoder reads 8 bytes at a time
+} // ~Index::pack_positions
+
+/**
+ * read the legacy '.kmer', '.bursttrie' and '.pos' files of the index part into an image (see IndexImageHeader)
+ *
+ * If the part has an offset table (see PartOffsets), the tries and the positions are split into ranges of whole
+ * STRIDEs, which are read and deserialized concurrently. The tries of each range go into a separate arena,
+ * and the arenas are concatenated in the image. Otherwise the files are deserialized in a single range.
+ *
+ * The positions are bit-packed if the index was built with '--packed_pos'.
+ */
+void Index::load_legacy(Runopts & opts, uint32_t idx_num, uint32_t idx_part, uint32_t lnwin, std::vector<char> & img)
+{
+	uint32_t limit = 1 << lnwin;
+	std::string part_str = std::to_string(idx_part);
+	std::string idxfile = opts.indexfiles[idx_num].second + ".kmer_" + part_str + ".dat";
+	std::string btriefile = opts.indexfiles[idx_num].second + ".bursttrie_" + part_str + ".dat";
+	std::string posfile = opts.indexfiles[idx_num].second + ".pos_" + part_str + ".dat";
+	std::vector<char> buf;
+
+	// STEP 1: load the kmer 'count' variables (dbname.kmer.dat)
+	read_range(idxfile, 0, limit * sizeof(uint32_t), buf);
+	std::vector<kmer_entry> lookup(limit, kmer_entry{ NO_TRIE, NO_TRIE, 0 });
+	for (uint32_t i = 0; i < limit; i++)
+		memcpy(&lookup[i].count, &buf[i * sizeof(uint32_t)], sizeof(uint32_t));
+
+	// number of the (L+1)-mers and the size of the positions pool i.e. the file less the sizes
+	uint32_t num_elements = 0;
+	read_range(posfile, 0, sizeof(uint32_t), buf);
+	memcpy(&num_elements, buf.data(), sizeof(uint32_t));
+	uint64_t btrie_size = std::filesystem::file_size(btriefile);
+	uint64_t pos_size = std::filesystem::file_size(posfile);
+	if (pos_size < sizeof(uint32_t) * ((uint64_t)num_elements + 1))
+		truncated(posfile);
+	std::vector<uint64_t> positions(num_elements + 1, 0);
+	std::vector<seq_pos> pool((pos_size - sizeof(uint32_t) * ((uint64_t)num_elements + 1)) / sizeof(seq_pos));
+
+	// the ranges of STRIDEs deserialized concurrently
+	PartOffsets offsets;
+	const uint32_t STRIDE = PartOffsets::STRIDE;
+	uint32_t num_kmer_strides = (limit + STRIDE - 1) / STRIDE;
+	uint32_t num_pos_strides = (num_elements + STRIDE - 1) / STRIDE;
+	bool is_split = offsets.read(opts.indexfiles[idx_num].second + ".offsets_" + part_str + ".dat")
+		&& offsets.tries.size() == num_kmer_strides + 1 && offsets.tries.back() == btrie_size
+		&& offsets.pos.size() == num_pos_strides + 1 && offsets.pos.back() == pos_size;
+	if (!is_split)
+	{
+		// single range
+		offsets.tries = { 0, btrie_size };
+		offsets.pos = { sizeof(uint32_t), pos_size };
+		num_kmer_strides = 1;
+		num_pos_strides = 1;
+	}
+
+	uint32_t num_threads = opts.num_proc_thread > 0 ? opts.num_proc_thread : std::thread::hardware_concurrency();
+	num_threads = std::max<uint32_t>(1, std::min(num_threads, std::max(num_kmer_strides, num_pos_strides)));
+	// the strides [first, last) of the range 'r' out of 'n'
+	auto range = [num_threads](uint32_t num_strides, uint32_t r, uint32_t &first, uint32_t &last) {
+		first = (uint64_t)num_strides * r / num_threads;
+		last = (uint64_t)num_strides * (r + 1) / num_threads;
+	};
+	uint32_t kmer_stride = is_split ? STRIDE : limit;
+	uint32_t pos_stride = is_split ? STRIDE : num_elements;
 
-	if (positions_tbl.capacity() == 0)
+	// STEP 2: load the burst tries ( bursttrief.dat, bursttrier.dat ) and the position reference tables (pos.dat)
+	std::vector<std::vector<char>> arenas(num_threads);
 	{
-		fprintf(stderr, "  ERROR: could not allocate memory for positions_tbl (main(), paralleltraversal.cpp)\n");
+		ThreadPool tpool(num_threads);
+		for (uint32_t r = 0; r < num_threads; ++r)
+		{
+			tpool.addJob([&, r]() {
+				uint32_t first, last;
+				std::vector<char> rbuf;
+
+				range(num_kmer_strides, r, first, last);
+				if (first < last)
+				{
+					read_range(btriefile, offsets.tries[first], offsets.tries[last], rbuf);
+					load_tries(rbuf, first * kmer_stride, std::min<uint64_t>((uint64_t)last * kmer_stride, limit),
+						lookup, arenas[r], btriefile);
+				}
+
+				range(num_pos_strides, r, first, last);
+				if (first < last)
+				{
+					// the first pool entry of the range follows from its file offset
+					uint64_t first_id = (uint64_t)first * pos_stride;
+					uint64_t pool_pos = (offsets.pos[first] - sizeof(uint32_t) * (first_id + 1)) / sizeof(seq_pos);
+					read_range(posfile, offsets.pos[first], offsets.pos[last], rbuf);
+					load_positions(rbuf, first_id, std::min<uint64_t>((uint64_t)last * pos_stride, num_elements),
+						pool_pos, positions, pool, posfile);
+				}
+			});
+		}
+		tpool.waitAll();
+	}
+
+	// the arenas follow each other - shift the trie offsets of each range
+	uint64_t tries_size = 0;
+	for (uint32_t r = 0; r < num_threads; ++r)
+	{
+		uint32_t first, last;
+		range(num_kmer_strides, r, first, last);
+		uint32_t shift = tries_size / TRIE_ALIGN;
+		for (uint64_t i = (uint64_t)first * kmer_stride; i < std::min<uint64_t>((uint64_t)last * kmer_stride, limit); ++i)
+		{
+			if (lookup[i].trie_F != NO_TRIE) lookup[i].trie_F += shift;
+			if (lookup[i].trie_R != NO_TRIE) lookup[i].trie_R += shift;
+		}
+		tries_size += arenas[r].size();
+	}
+	if (positions.back() != pool.size())
+		truncated(posfile);
+
+	uint32_t stats_lnwin = 0;
+	uint16_t num_parts = 0;
+	bool is_packed = false;
+	read_index_layout(opts.indexfiles[idx_num].second + ".stats", stats_lnwin, num_parts, is_packed);
+	std::vector<unsigned char> packed;
+	if (is_packed)
+	{
+		pack_positions(positions, pool, packed);
+		std::vector<seq_pos>().swap(pool);
+	}
+
+	// STEP 3: assemble the image
+	IndexImageHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic));
+	hdr.version = IMAGE_VERSION;
+	hdr.lnwin = lnwin;
+	hdr.number_elements = num_elements;
+	hdr.flags = is_packed ? IMAGE_PACKED_POSITIONS : 0;
+	hdr.lookup_off = sizeof(IndexImageHeader);
+	hdr.tries_off = (hdr.lookup_off + sizeof(kmer_entry) * lookup.size() + TRIE_ALIGN - 1) / TRIE_ALIGN * TRIE_ALIGN;
+	hdr.positions_off = hdr.tries_off + tries_size;
+	hdr.pool_off = hdr.positions_off + sizeof(uint64_t) * positions.size();
+	hdr.size = hdr.pool_off + (is_packed ? packed.size() : sizeof(seq_pos) * pool.size());
+
+	img.resize(hdr.size);
+	memcpy(&img[0], &hdr, sizeof(hdr));
+	memcpy(&img[hdr.lookup_off], lookup.data(), sizeof(kmer_entry) * lookup.size());
+	uint64_t tries_pos = hdr.tries_off;
+	for (auto const& arena : arenas)
+	{
+		memcpy(&img[tries_pos], arena.data(), arena.size());
+		tries_pos += arena.size();
+	}
+	memcpy(&img[hdr.positions_off], positions.data(), sizeof(uint64_t) * positions.size());
+	if (is_packed)
+		memcpy(&img[hdr.pool_off], packed.data(), packed.size());
+	else
+		memcpy(&img[hdr.pool_off], pool.data(), sizeof(seq_pos) * pool.size());
+} // ~Index::load_legacy
+
+/**
+ * convert the legacy files of the index part into the relocatable image file
+ *
+ * The image is written into a temporary file, which is then renamed i.e. concurrent runs converting the same part
+ * do not see a partially written image.
+ *
+ * @return false if the image file could not be written
+ */
+bool Index::convert(Runopts & opts, uint32_t idx_num, uint32_t idx_part, uint32_t lnwin)
+{
+	std::vector<char> img;
+	load_legacy(opts, idx_num, idx_part, lnwin, img);
+
+	auto imgfile = image_file(opts, idx_num, idx_part);
+	auto tmpfile = imgfile + "." + std::to_string(getpid()) + ".tmp";
+	std::ofstream os(tmpfile, std::ios::binary);
+	os.write(img.data(), img.size());
+	os.close();
+	if (!os)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to write the index image [" << tmpfile << "]: " << strerror(errno);
+		WARN(ss.str());
+		std::error_code ec;
+		std::filesystem::remove(tmpfile, ec);
+		return false;
+	}
+	std::filesystem::rename(tmpfile, imgfile);
+	return true;
+} // ~Index::convert
+
+#if !defined(_WIN32)
+/**
+ * map an anonymous read-write region backed by huge pages, falling back to smaller pages:
+ *   1. hugetlbfs pages: 1 GB pages for regions of at least 1 GB, then 2 MB pages. The pages have to be reserved
+ *      e.g. 'echo 1024 > /proc/sys/vm/nr_hugepages'
+ *   2. transparent huge pages i.e. madvise(MADV_HUGEPAGE) on a 2 MB aligned region. Used when THP 'enabled' is
+ *      'always' or 'madvise' (/sys/kernel/mm/transparent_hugepage/enabled)
+ *   3. regular pages
+ *
+ * @param size    in: number of bytes required. out: size of the mapping
+ * @param backing out: the pages used
+ * @return the mapped region or MAP_FAILED
+ */
+static void* map_huge(size_t & size, std::string & backing)
+{
+	const size_t HUGE_2MB = 1ULL << 21;
+	const size_t HUGE_1GB = 1ULL << 30;
+	void* addr = MAP_FAILED;
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+	if (size >= HUGE_1GB)
+	{
+		size_t len = (size + HUGE_1GB - 1) & ~(HUGE_1GB - 1);
+		addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (30 << MAP_HUGE_SHIFT), -1, 0);
+		if (addr != MAP_FAILED)
+		{
+			size = len;
+			backing = "hugetlbfs 1 GB pages";
+			return addr;
+		}
+	}
+
+	size_t len = (size + HUGE_2MB - 1) & ~(HUGE_2MB - 1);
+	addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+	if (addr != MAP_FAILED)
+	{
+		size = len;
+		backing = "hugetlbfs 2 MB pages";
+		return addr;
+	}
+#endif
+
+#if defined(MADV_HUGEPAGE)
+	// over-allocate by 2 MB and trim to a 2 MB aligned region, so that the whole region can use huge pages
+	size_t thp_len = (size + HUGE_2MB - 1) & ~(HUGE_2MB - 1);
+	addr = mmap(NULL, thp_len + HUGE_2MB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr != MAP_FAILED)
+	{
+		char* start = static_cast<char*>(addr);
+		char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(start) + HUGE_2MB - 1) & ~(HUGE_2MB - 1));
+		if (aligned > start)
+			munmap(start, aligned - start);
+		if (start + HUGE_2MB > aligned)
+			munmap(aligned + thp_len, start + HUGE_2MB - aligned);
+		size = thp_len;
+		backing = madvise(aligned, thp_len, MADV_HUGEPAGE) == 0 ? "transparent huge pages" : "regular pages (huge pages are not available)";
+		return aligned;
+	}
+#endif
+
+	backing = "regular pages (huge pages are not available)";
+	return MAP_FAILED;
+} // ~map_huge
+#endif
+
+/**
+ * load the index part i.e. map its image file. The image is created from the legacy files if it does not exist.
+ */
+void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats & refstats)
+{
+	load(idx_num, idx_part, opts, refstats.lnwin[idx_num]);
+
+	// the minimizer seed engine. The last engine given applies to the remaining indices.
+	auto const& engines = opts.is_minimizer_seeds;
+	if (!engines.empty() && engines[std::min<size_t>(idx_num, engines.size() - 1)])
+	{
+		auto minifile = MinimizerIndex::file_name(opts.indexfiles[idx_num].second, idx_part);
+		if (!minimizers.load(minifile, refstats.lnwin[idx_num]))
+		{
+			std::stringstream ss;
+			ss << STAMP << "The minimizer index [" << minifile << "] is missing, of an older format, or was built with another seed length."
+				<< " Using the burst tries. Re-build the index with '--" << OPT_MINIMIZER_W << "' > 0 to use the minimizers.";
+			WARN(ss.str());
+		}
+	}
+} // ~Index::load
+
+/* load the index part given its seed length i.e. without the reference statistics (see index_stats) */
+void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, uint32_t lnwin)
+{
+	std::stringstream ss;
+	clear();
+	seed_hits = 0;
+	seed_positions = 0;
+	masked_hits = 0;
+	masked_positions = 0;
+
+	auto imgfile = image_file(opts, idx_num, idx_part);
+
+	// the image of an older format version is re-created
+	if (!is_image_current(imgfile))
+	{
+		ss << STAMP << "Converting the index part [" << opts.indexfiles[idx_num].second << "_" << idx_part 
+			<< "] into the image file [" << imgfile << "]" << std::endl;
+		std::cout << ss.str();
+		if (!convert(opts, idx_num, idx_part, lnwin))
+		{
+			// cannot write the image - use it from memory
+			load_legacy(opts, idx_num, idx_part, lnwin, image_buf);
+			set_image(image_buf.data(), image_buf.size(), imgfile, lnwin);
+			index_num = idx_num;
+			part = idx_part;
+			return;
+		}
+	}
+
+#if defined(_WIN32)
+	// no mmap - read the image
+	image_buf.resize(std::filesystem::file_size(imgfile));
+	std::ifstream ifs(imgfile, std::ios::in | std::ios::binary);
+	ifs.read(image_buf.data(), image_buf.size());
+	set_image(image_buf.data(), image_buf.size(), imgfile, lnwin);
+#else
+	int fd = ::open(imgfile.data(), O_RDONLY);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) == -1)
+	{
+		ss.str("");
+		ss << STAMP << "Failed to open the index image [" << imgfile << "]: " << strerror(errno);
+		ERR(ss.str());
 		exit(EXIT_FAILURE);
 	}
 
-	for (uint32_t i = 0; i < number_elements; i++)
+	// the image hosted in shared memory by 'sortmerna --index_host'
+	if (!opts.is_huge_pages && attach(opts, idx_num, idx_part, st.st_size, lnwin))
 	{
-		/* the number of positions */
-		positions_tbl.push_back(kmer_origin());
-		inreff.read(reinterpret_cast<char*>(&size), sizeof(uint32_t));
-		positions_tbl[i].size = size;
-		/* the sequence seq_pos array */
-		positions_tbl[i].arr = new seq_pos[size]();
-		if (positions_tbl[i].arr == NULL)
+		::close(fd);
+		index_num = idx_num;
+		part = idx_part;
+		return;
+	}
+
+	void* addr = MAP_FAILED;
+	map_size = st.st_size;
+	if (opts.is_huge_pages)
+	{
+		// private copy of the image backed by huge pages
+		std::string backing;
+		addr = map_huge(map_size, backing);
+		if (addr != MAP_FAILED)
 		{
-			fprintf(stderr, "  ERROR: could not allocate memory for positions_tbl (paralleltraversal.cpp)\n");
-			exit(EXIT_FAILURE);
+			ss.str("");
+			ss << STAMP << "Index memory: " << backing << std::endl;
+			std::cout << ss.str();
+			char* dst = static_cast<char*>(addr);
+			for (off_t pos = 0; pos < st.st_size;)
+			{
+				ssize_t nread = pread(fd, dst + pos, st.st_size - pos, pos);
+				if (nread <= 0)
+				{
+					ss.str("");
+					ss << STAMP << "Failed to read the index image [" << imgfile << "]: " << strerror(errno);
+					ERR(ss.str());
+					exit(EXIT_FAILURE);
+				}
+				pos += nread;
+			}
 		}
-		inreff.read(reinterpret_cast<char*>(positions_tbl[i].arr), sizeof(seq_pos)*size);
 	}
 
-	inreff.close();
+	if (addr == MAP_FAILED)
+	{
+		// shared read-only mapping - the pages are shared with other processes using the same index
+		map_size = st.st_size;
+		addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+#if defined(MADV_HUGEPAGE)
+		// the file pages are only collapsed into huge pages if the kernel supports it (READ_ONLY_THP_FOR_FS)
+		if (addr != MAP_FAILED)
+			madvise(addr, st.st_size, MADV_HUGEPAGE);
+#endif
+	}
+	::close(fd);
+	if (addr == MAP_FAILED)
+	{
+		ss.str("");
+		ss << STAMP << "Failed to map the index image [" << imgfile << "]: " << strerror(errno);
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	is_mapped = true;
+	set_image(static_cast<char*>(addr), st.st_size, imgfile, lnwin);
+#endif
+
 	index_num = idx_num;
 	part = idx_part;
 } // ~Index::load
 
+/**
+ * validate the image and set the table pointers
+ */
+void Index::set_image(char* img, size_t size, const std::string & name, uint32_t lnwin)
+{
+	image = img;
+	image_size = size;
+
+	IndexImageHeader* hdr = reinterpret_cast<IndexImageHeader*>(image);
+	if (size < sizeof(IndexImageHeader) 
+		|| memcmp(hdr->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0
+		|| hdr->version != IMAGE_VERSION
+		|| hdr->lnwin != lnwin
+		|| hdr->size != size)
+	{
+		std::stringstream ss;
+		ss << STAMP << "The index image [" << name << "] is not valid for this index. Remove it to have it re-created.";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	number_elements = hdr->number_elements;
+	lookup_size = 1 << hdr->lnwin;
+	lookup_tbl = reinterpret_cast<kmer_entry*>(image + hdr->lookup_off);
+	tries = image + hdr->tries_off;
+	positions_tbl = reinterpret_cast<uint64_t*>(image + hdr->positions_off);
+	positions_pool = reinterpret_cast<seq_pos*>(image + hdr->pool_off);
+	packed_pool = (hdr->flags & IMAGE_PACKED_POSITIONS) ? reinterpret_cast<unsigned char*>(image + hdr->pool_off) : nullptr;
+} // ~Index::set_image
+
 void Index::clear()
 {
-	// lookup_tbl
-	for (int i = 0; i < lookup_tbl.size(); i++)
+#if !defined(_WIN32)
+	if (is_mapped && image != nullptr)
+		munmap(image - map_off, map_size);
+	if (shm_fd != -1)
+		::close(shm_fd); // releases the shared lock
+#endif
+	std::vector<char>().swap(image_buf);
+	image = nullptr;
+	image_size = 0;
+	map_size = 0;
+	map_off = 0;
+	shm_fd = -1;
+	is_mapped = false;
+
+	number_elements = 0;
+	lookup_size = 0;
+	lookup_tbl = nullptr;
+	tries = nullptr;
+	positions_tbl = nullptr;
+	positions_pool = nullptr;
+	packed_pool = nullptr;
+	minimizers.clear();
+} // ~Index::clear
+
+/**
+ * the image file exists and is of the current format version
+ */
+bool Index::is_image_current(const std::string & imgfile)
+{
+	IndexImageHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	std::ifstream ifs(imgfile, std::ios::in | std::ios::binary);
+	ifs.read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+	return memcmp(hdr.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 && hdr.version == IMAGE_VERSION;
+} // ~Index::is_image_current
+
+/**
+ * name of the shared memory segment hosting the index part i.e. derived from the absolute path of its image file
+ */
+std::string Index::shm_name(Runopts & opts, uint32_t idx_num, uint32_t idx_part)
+{
+	auto imgfile = std::filesystem::absolute(image_file(opts, idx_num, idx_part)).string();
+	return "/sortmerna_" + string_hash(imgfile);
+} // ~Index::shm_name
+
+/**
+ * attach the shared memory segment hosting the index part if it exists, is fully loaded, and is not stale
+ *
+ * The segment is locked (shared) while attached i.e. the lock is the reference of this process to the segment,
+ * which the hosting process checks before evicting an idle index. The lock is released by 'clear',
+ * or by the OS if the process terminates.
+ *
+ * @return false if the segment cannot be used
+ */
+bool Index::attach(Runopts & opts, uint32_t idx_num, uint32_t idx_part, uint64_t img_size, uint32_t lnwin)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	auto name = shm_name(opts, idx_num, idx_part);
+	int fd = shm_open(name.data(), O_RDONLY, 0);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (flock(fd, LOCK_SH) == -1 || fstat(fd, &st) == -1 || (uint64_t)st.st_size != SHM_IMAGE_OFF + img_size)
 	{
-		if (lookup_tbl[i].trie_F != NULL)
-		{
-			delete[] lookup_tbl[i].trie_F;
-			lookup_tbl[i].trie_F = NULL;
-			lookup_tbl[i].trie_R = NULL;
-		}
-		if (lookup_tbl[i].trie_R != NULL)
+		::close(fd);
+		return false;
+	}
+
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+	{
+		::close(fd);
+		return false;
+	}
+
+	auto imgfile = image_file(opts, idx_num, idx_part);
+	ShmIndexHeader* hdr = static_cast<ShmIndexHeader*>(addr);
+	if (memcmp(hdr->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0
+		|| hdr->image_size != img_size
+		|| hdr->image_time != (int64_t)std::filesystem::last_write_time(imgfile).time_since_epoch().count())
+	{
+		munmap(addr, st.st_size);
+		::close(fd);
+		return false;
+	}
+
+	shm_fd = fd;
+	is_mapped = true;
+	map_size = st.st_size;
+	map_off = SHM_IMAGE_OFF;
+	set_image(static_cast<char*>(addr) + SHM_IMAGE_OFF, img_size, name, lnwin);
+
+	std::stringstream ss;
+	ss << STAMP << "Attached the shared index [" << name << "] ";
+	std::cout << ss.str();
+	return true;
+#endif
+} // ~Index::attach
+
+static volatile std::sig_atomic_t host_signal = 0;
+static void on_host_signal(int sig) { host_signal = sig; }
+
+/**
+ * host all parts of the indices in POSIX shared memory segments, so the 'sortmerna' processes running on the node
+ * share a single copy of the index (option '--index_host'). The processes attach the segments in 'Index::load'.
+ *
+ * The hosting process runs until it is terminated (SIGINT, SIGTERM), or until none of the segments has been
+ * attached for the number of seconds given by the option. The segments are then unlinked i.e. no new process
+ * can attach them, and their memory is freed by the OS when the last attached process detaches.
+ */
+void Index::host(Runopts & opts)
+{
+	std::stringstream ss;
+#if defined(_WIN32)
+	ss << STAMP << "Option '" << OPT_INDEX_HOST << "' is not supported on Windows";
+	ERR(ss.str());
+	exit(EXIT_FAILURE);
+#else
+	std::vector<std::pair<std::string, int>> segments; // name, file descriptor
+
+	for (uint32_t idx_num = 0; idx_num < opts.indexfiles.size(); ++idx_num)
+	{
+		uint32_t lnwin = 0;
+		uint16_t num_parts = 0;
+		bool is_packed = false;
+		read_index_layout(opts.indexfiles[idx_num].second + ".stats", lnwin, num_parts, is_packed);
+
+		for (uint32_t idx_part = 0; idx_part < num_parts; ++idx_part)
 		{
-			delete[] lookup_tbl[i].trie_R;
-			lookup_tbl[i].trie_R = NULL;
+			auto imgfile = image_file(opts, idx_num, idx_part);
+			if (!is_image_current(imgfile) && !convert(opts, idx_num, idx_part, lnwin))
+			{
+				ss.str("");
+				ss << STAMP << "Cannot host the index part [" << opts.indexfiles[idx_num].second << "_" << idx_part
+					<< "] without its image file [" << imgfile << "]";
+				ERR(ss.str());
+				exit(EXIT_FAILURE);
+			}
+
+			// a segment left by a terminated host is replaced
+			auto name = shm_name(opts, idx_num, idx_part);
+			shm_unlink(name.data());
+			uint64_t img_size = std::filesystem::file_size(imgfile);
+			size_t seg_size = SHM_IMAGE_OFF + img_size;
+			int fd = shm_open(name.data(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			void* addr = MAP_FAILED;
+			if (fd != -1 && ftruncate(fd, seg_size) == 0)
+				addr = mmap(NULL, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (addr == MAP_FAILED)
+			{
+				ss.str("");
+				ss << STAMP << "Failed to create the shared memory segment [" << name << "] of " << seg_size 
+					<< " bytes: " << strerror(errno);
+				ERR(ss.str());
+				exit(EXIT_FAILURE);
+			}
+
+			char* dst = static_cast<char*>(addr) + SHM_IMAGE_OFF;
+			int imgfd = ::open(imgfile.data(), O_RDONLY);
+			for (uint64_t pos = 0; pos < img_size;)
+			{
+				ssize_t nread = imgfd == -1 ? -1 : pread(imgfd, dst + pos, img_size - pos, pos);
+				if (nread <= 0)
+				{
+					ss.str("");
+					ss << STAMP << "Failed to read the index image [" << imgfile << "]: " << strerror(errno);
+					ERR(ss.str());
+					exit(EXIT_FAILURE);
+				}
+				pos += nread;
+			}
+			::close(imgfd);
+
+			ShmIndexHeader* hdr = static_cast<ShmIndexHeader*>(addr);
+			hdr->image_size = img_size;
+			hdr->image_time = std::filesystem::last_write_time(imgfile).time_since_epoch().count();
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(hdr->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+			munmap(addr, seg_size);
+			segments.push_back({ name, fd });
+
+			ss.str("");
+			ss << STAMP << "Hosting the index part [" << opts.indexfiles[idx_num].second << "_" << idx_part 
+				<< "] in the shared memory segment [" << name << "] " << seg_size / (1024 * 1024) << " MB" << std::endl;
+			std::cout << ss.str();
 		}
 	}
-	lookup_tbl.clear();
 
-	// positions_tbl
-	for (int i = 0; i < positions_tbl.size(); i++)
+	signal(SIGINT, on_host_signal);
+	signal(SIGTERM, on_host_signal);
+
+	// wait for the termination or the idle timeout
+	for (uint32_t idle = 0; host_signal == 0 && (opts.index_host_idle == 0 || idle < opts.index_host_idle); ++idle)
 	{
-		if (positions_tbl[i].arr != NULL)
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		for (auto const& seg : segments)
 		{
-			delete[] positions_tbl[i].arr;
-			positions_tbl[i].arr = NULL;
+			// a segment cannot be locked exclusively while attached
+			if (flock(seg.second, LOCK_EX | LOCK_NB) == -1)
+			{
+				idle = 0;
+				break;
+			}
+			flock(seg.second, LOCK_UN);
 		}
 	}
-	positions_tbl.clear();
-} // ~Index::clear
\ No newline at end of file
+
+	for (auto const& seg : segments)
+	{
+		shm_unlink(seg.first.data());
+		::close(seg.second);
+	}
+	ss.str("");
+	ss << STAMP << "Evicted " << segments.size() << " hosted index parts" << std::endl;
+	std::cout << ss.str();
+#endif
+} // ~Index::host
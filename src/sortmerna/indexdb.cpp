@@ -45,13 +45,19 @@
 #include <unistd.h>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <queue>
+#include <unordered_map>
+#include <string_view>
 
 #include "version.h"
 #include "build_version.h"
 #include "indexdb.hpp"
-#include "cmph.h"
 #include <sys/stat.h> //for creating tmp dir
 #include "options.hpp"
+#include "ThreadPool.hpp"
+#include "minimizer.hpp"
 
 #if defined(_WIN32)
 #include <Winsock.h>
@@ -62,7 +68,12 @@ const std::string ENV_TMPDIR = "TMPDIR";
 const char PATH_SEPARATOR = '/';
 #endif
 
+// forward
+uint64_t fnv1a(const char* data, size_t len, uint64_t hash = 14695981039346656037ULL); // util.cpp
 
+// estimated memory (MB) per L-mer of an index part with the bit-packed positions (see Runopts::is_packed_pos)
+// The packed positions take ~22 bits instead of 64, which makes the loaded index ~23% smaller (SILVA 16S)
+const double PACKED_MEM_PER_LMER = 7.3e-6;
 
 //! burst trie nucleotide map
 /*! the trie nodes consist of an array holding four
@@ -134,16 +145,16 @@ uint32_t num_elem[100] = { 0 };
  * recorded in a bucket using 2 bits per nt
  * @param NodeElement* trie_node
  * @param char* str
- * @param uint32_t sig
+ * @param uint32_t id: id of the 18-mer prefix of the 19-mer
  * @return void
  * @version 1.0 Dec 11, 2012
  *
  *******************************************************************/
 inline void insert_prefix(NodeElement* trie_node,
-	unsigned char *prefix)
+	unsigned char *prefix,
+	uint32_t id)
 {
 	uint32_t depth = 0;
-	uint32_t sig = 0;
 
 	// get the trie node from which to start traversal (A,C,G or T)
 	NodeElement *node_elem = (NodeElement*)(trie_node + *prefix++);
@@ -208,8 +219,8 @@ inline void insert_prefix(NodeElement* trie_node,
 
 	*entry++ = encode;
 
-	// add the signature of the prefix following the tail
-	*entry = sig;
+	// add the id of the 18-mer following the tail
+	*entry = id;
 
 	// record the new size of bucket
 	(node_elem->size) += ENTRYSIZE;
@@ -388,13 +399,14 @@ void freebursttrie(NodeElement* trie_node)
  * @param NodeElement* trie_node: pointer to mini-burst trie
  * @param unsigned char* kmer_short_key: pointer to second half of
  * 19-mer window
- * @param bool &new_position: true if 18-mer prefix of 19-mer exists in
- * the burst trie, false otherwise
+ * @param bool &new_position: false if 18-mer prefix of 19-mer exists in
+ * the burst trie, true otherwise
+ * @param uint32_t &id: the id of the 18-mer prefix if it exists in the burst trie
  * @return bool: true if 19-mer is in the burst trie, false otherwise
  * @version 1.0 Mar 4, 2013
  *
  *******************************************************************/
-bool search_burst_trie(NodeElement* trie_node, unsigned char* kmer_short_key, bool &new_position)
+bool search_burst_trie(NodeElement* trie_node, unsigned char* kmer_short_key, bool &new_position, uint32_t &id)
 {
 	uint32_t depth = 0;
 
@@ -434,6 +446,7 @@ bool search_burst_trie(NodeElement* trie_node, unsigned char* kmer_short_key, bo
 		if ((encode&msk) == (*((uint32_t*)start_bucket)&msk))
 		{
 			new_position = false;
+			id = *((uint32_t*)(start_bucket + sizeof(uint32_t)));
 			// 19-mer found
 			if (encode == *((uint32_t*)start_bucket)) return true;
 		}
@@ -449,7 +462,7 @@ bool search_burst_trie(NodeElement* trie_node, unsigned char* kmer_short_key, bo
 /*
  *
  * @function add_id_to_burst_trie: initially all id's in the burst trie are set
- * to 0, here we set them to their proper MPHF values, forward 19-mer and reverse 19-mer must have the same id
+ * to 0, here we set them to their proper 18-mer id values, forward 19-mer and reverse 19-mer must have the same id
  * @param NodeElement* trie_node: pointer to mini-burst trie
  * @param unsigned char* kmer_id_short_F_ptr: pointer to second half of
  * 19-mer window
@@ -698,172 +711,281 @@ void traversetrie_debug(NodeElement* trie_node, uint32_t depth, uint32_t &total_
 
 /*
  *
- * @function load index: write to binary file the 9-mer look-up
- * tables and the mini-burst tries
- * @param string root: the file name of the index
- * @param kmer* lookup_table: pointer to the 9-mer lookup table
+ * @function write_tries: write to binary file the sizes of the two
+ * mini-burst tries of a 9-mer followed by the tries in breadth-first order
+ * @param ofstream btrie: the burst tries file
+ * @param kmer entry: the 9-mer look-up table entry
  * @return void
- * @version 1.0 Jan 16, 2013
  *
  *******************************************************************/
-void load_index(kmer* lookup_table, char* outfile, Runopts &opts)
+void write_tries(std::ofstream &btrie, kmer &entry)
 {
-	// output the mini-burst tries
-	std::ofstream btrie(outfile, std::ofstream::binary);
-
 	uint32_t sizeoftries[2] = { 0 };
-
-	// loop through all 9-mers
-	for (uint32_t i = 0; i < (uint32_t)(1 << opts.seed_win_len); i++)
-	{
-		NodeElement* trienode = NULL;
+	NodeElement* trienode = NULL;
 
 #ifdef see_binary_output
-		cout << "9-mer = " << i; //TESTING
+	cout << "9-mer"; //TESTING
 #endif
 
 	// 1. output size for the two mini-burst tries for each 9-mer
-		for (int j = 0; j < 2; j++)
-		{
-			total_num_trie_nodes = 0;
-			size_of_all_buckets = 0;
-			if (j == 0) trienode = lookup_table[i].trie_F;
-			else trienode = lookup_table[i].trie_R;
+	for (int j = 0; j < 2; j++)
+	{
+		total_num_trie_nodes = 0;
+		size_of_all_buckets = 0;
+		if (j == 0) trienode = entry.trie_F;
+		else trienode = entry.trie_R;
 
-			if (trienode != NULL) traversetrie(trienode, 0);
+		if (trienode != NULL) traversetrie(trienode, 0);
 
-			sizeoftrie = total_num_trie_nodes * sizeof(NodeElement) * 4 + size_of_all_buckets * sizeof(char);
-			sizeoftries[j] = sizeoftrie;
-			btrie.write(reinterpret_cast<const char*>(&sizeoftrie), sizeof(uint32_t));
+		sizeoftrie = total_num_trie_nodes * sizeof(NodeElement) * 4 + size_of_all_buckets * sizeof(char);
+		sizeoftries[j] = sizeoftrie;
+		btrie.write(reinterpret_cast<const char*>(&sizeoftrie), sizeof(uint32_t));
 
 #ifdef see_binary_output
-			if (j == 0) cout << "\tsizeoftrie f = " << sizeoftrie; //TESTING
-			else cout << "\tsizeoftrie r = " << sizeoftrie; //TESTING
+		if (j == 0) cout << "\tsizeoftrie f = " << sizeoftrie; //TESTING
+		else cout << "\tsizeoftrie r = " << sizeoftrie; //TESTING
 #endif
-		}
+	}
 
 #ifdef see_binary_output
-		cout << "\tlookup_tbl[i].count = " << lookup_table[i].count << endl; //TESTING
+	cout << "\tlookup_tbl[i].count = " << entry.count << endl; //TESTING
 #endif        
 	// 2. output both mini-burst tries into binary file
-		for (int j = 0; j < 2; j++)
+	for (int j = 0; j < 2; j++)
+	{
+		// the mini-burst trie exists, load into memory
+		if (sizeoftries[j] != 0)
 		{
-			// the mini-burst trie exists, load into memory
-			if (sizeoftries[j] != 0)
+			if (j == 0)
 			{
-				if (j == 0)
-				{
-					trienode = lookup_table[i].trie_F;
+				trienode = entry.trie_F;
 #ifdef see_binary_output
-					cout << "forward burst-trie \n"; //TESTING
+				cout << "forward burst-trie \n"; //TESTING
 #endif
-				}
-				else
-				{
-					trienode = lookup_table[i].trie_R;
+			}
+			else
+			{
+				trienode = entry.trie_R;
 #ifdef see_binary_output
-					cout << "reverse burst-trie \n"; //TESTING
+				cout << "reverse burst-trie \n"; //TESTING
 #endif
-				}
+			}
 
-				// queue of node elements for breadth-first traversal
-				std::deque<NodeElement*> nodes;
+			// queue of node elements for breadth-first traversal
+			std::deque<NodeElement*> nodes;
 
-				// load first set of NodeElements into the queue & write to file
-				for (int i = 0; i < 4; i++)
-				{
-					nodes.push_back(trienode);
-					btrie.write(reinterpret_cast<const char*>(&(trienode->flag)), sizeof(char));
+			// load first set of NodeElements into the queue & write to file
+			for (int i = 0; i < 4; i++)
+			{
+				nodes.push_back(trienode);
+				btrie.write(reinterpret_cast<const char*>(&(trienode->flag)), sizeof(char));
 #ifdef see_binary_output
-					cout << " " << (int)trienode->flag; //TESTING
+				cout << " " << (int)trienode->flag; //TESTING
 #endif
-					trienode++;
-				}
+				trienode++;
+			}
 
-				int depth = 0;
-				int poplimit = 4;
-				int numpops = 0;
-				int topop = 0;
+			int depth = 0;
+			int poplimit = 4;
+			int numpops = 0;
+			int topop = 0;
 
-				while (!nodes.empty())
+			while (!nodes.empty())
+			{
+				// increment depth of burst trie
+				if (numpops == poplimit)
 				{
-					// increment depth of burst trie
-					if (numpops == poplimit)
-					{
-						depth++;
-						poplimit = topop;
-						numpops = 0;
-						topop = 0;
-					}
+					depth++;
+					poplimit = topop;
+					numpops = 0;
+					topop = 0;
+				}
 
-					trienode = nodes.front();
+				trienode = nodes.front();
 
-					switch (trienode->flag)
-					{
-						// empty node
-					case 0:
-					{
-						;
-					}
-					break;
-					// trie node, add child trie node to queue
-					case 1:
+				switch (trienode->flag)
+				{
+					// empty node
+				case 0:
+				{
+					;
+				}
+				break;
+				// trie node, add child trie node to queue
+				case 1:
+				{
+					NodeElement *child = trienode->nodetype.trie;
+					for (int i = 0; i < 4; i++)
 					{
-						NodeElement *child = trienode->nodetype.trie;
-						for (int i = 0; i < 4; i++)
-						{
-							nodes.push_back(child);
-							btrie.write(reinterpret_cast<const char*>(&(child->flag)), sizeof(char));
+						nodes.push_back(child);
+						btrie.write(reinterpret_cast<const char*>(&(child->flag)), sizeof(char));
 #ifdef see_binary_output
-							cout << " " << (int)child->flag; //TESTING
+						cout << " " << (int)child->flag; //TESTING
 #endif
-							child++;
-						}
-						topop += 4;
+						child++;
 					}
-					break;
-					// bucket node, add bucket to output file
-					case 2:
-					{
-						char* bucket = (char*)(trienode->nodetype.bucket);
+					topop += 4;
+				}
+				break;
+				// bucket node, add bucket to output file
+				case 2:
+				{
+					char* bucket = (char*)(trienode->nodetype.bucket);
 
-						// bucket information
-						uint32_t sizeofbucket = trienode->size;
+					// bucket information
+					uint32_t sizeofbucket = trienode->size;
 
 #ifdef see_binary_output
-						cout << "\tsizeofbucket = " << sizeofbucket; //TESTING
+					cout << "\tsizeofbucket = " << sizeofbucket; //TESTING
 #endif                 
-						btrie.write(reinterpret_cast<const char*>(&sizeofbucket), sizeof(uint32_t));
+					btrie.write(reinterpret_cast<const char*>(&sizeofbucket), sizeof(uint32_t));
 
-						// bucket content
-						char* start = (char*)bucket;
+					// bucket content
+					char* start = (char*)bucket;
 
-						btrie.write(reinterpret_cast<const char*>(start), sizeofbucket);
-					}
-					break;
-					// ?
-					default:
-					{
-						std::cerr << RED << "  ERROR" << COLOFF 
-							<<": flag is set to " << trienode->flag << " (load_index)" << std::endl;
-						exit(EXIT_FAILURE);
-					}
-					break;
-					}
+					btrie.write(reinterpret_cast<const char*>(start), sizeofbucket);
+				}
+				break;
+				// ?
+				default:
+				{
+					std::cerr << RED << "  ERROR" << COLOFF 
+						<<": flag is set to " << trienode->flag << " (load_index)" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				break;
+				}
 
-					nodes.pop_front();
-					numpops++;
+				nodes.pop_front();
+				numpops++;
 
 #ifdef see_binary_output
-					if (numpops % 4 == 0) cout << "\n"; //TESTING
+				if (numpops % 4 == 0) cout << "\n"; //TESTING
 #endif             
-				}//~while the queue is not empty
-			}//~if mini-burst trie exists
-		}//~for each mini-burst trie in the 9-mer
-	}//~for each 9-mer
+			}//~while the queue is not empty
+		}//~if mini-burst trie exists
+	}//~for each mini-burst trie in the 9-mer
+}//~write_tries()
+
+/*
+ *
+ * @function load index: write to binary file the 9-mer look-up
+ * tables and the mini-burst tries
+ * @param string root: the file name of the index
+ * @param kmer* lookup_table: pointer to the 9-mer lookup table
+ * @param offsets: the offset table of the part. Filled with the tries offsets
+ * @return void
+ * @version 1.0 Jan 16, 2013
+ *
+ *******************************************************************/
+void load_index(kmer* lookup_table, char* outfile, Runopts &opts, PartOffsets &offsets)
+{
+	// output the mini-burst tries
+	std::ofstream btrie(outfile, std::ofstream::binary);
+
+	// loop through all 9-mers
+	for (uint32_t i = 0; i < (uint32_t)(1 << opts.seed_win_len); i++)
+	{
+		if (i % PartOffsets::STRIDE == 0)
+			offsets.tries.push_back(btrie.tellp());
+		write_tries(btrie, lookup_table[i]);
+	}
+	offsets.tries.push_back(btrie.tellp());
+
 	btrie.close();
 }//~load_index()
 
+void PartOffsets::write(const std::string &file)
+{
+	std::ofstream os(file, std::ios::binary);
+	if (!os.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open file: " << file << " for writing. Error: " << strerror(errno);
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	uint32_t stride = STRIDE;
+	uint32_t size = tries.size();
+	os.write(reinterpret_cast<const char*>(&stride), sizeof(uint32_t));
+	os.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+	os.write(reinterpret_cast<const char*>(tries.data()), sizeof(uint64_t) * size);
+	size = pos.size();
+	os.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+	os.write(reinterpret_cast<const char*>(pos.data()), sizeof(uint64_t) * size);
+	os.close();
+} // ~PartOffsets::write
+
+bool PartOffsets::read(const std::string &file)
+{
+	std::ifstream is(file, std::ios::binary);
+	uint32_t stride = 0;
+	uint32_t size = 0;
+	if (!is.read(reinterpret_cast<char*>(&stride), sizeof(uint32_t)) || stride != STRIDE)
+		return false;
+	if (!is.read(reinterpret_cast<char*>(&size), sizeof(uint32_t)))
+		return false;
+	tries.resize(size);
+	if (!is.read(reinterpret_cast<char*>(tries.data()), sizeof(uint64_t) * size))
+		return false;
+	if (!is.read(reinterpret_cast<char*>(&size), sizeof(uint32_t)))
+		return false;
+	pos.resize(size);
+	if (!is.read(reinterpret_cast<char*>(pos.data()), sizeof(uint64_t) * size))
+		return false;
+	return true;
+} // ~PartOffsets::read
+
+/**
+ * the smallest number of positions such that at most the fraction 'frac' of the (L+1)-mers have more positions.
+ * The (L+1)-mers with the same number of positions are either all masked or none is.
+ */
+uint32_t OccurHist::threshold(double frac)
+{
+	uint64_t total = 0;
+	for (auto const& count : counts)
+		total += count.second;
+
+	uint64_t masked = 0;
+	for (auto it = counts.rbegin(); it != counts.rend(); ++it)
+	{
+		if (masked + it->second > frac * total)
+			return it == counts.rbegin() ? 0 : it->first;
+		masked += it->second;
+	}
+	return 0;
+} // ~OccurHist::threshold
+
+void OccurHist::write(std::ofstream &os, uint32_t max_occur)
+{
+	uint32_t size = counts.size();
+	os.write(reinterpret_cast<const char*>(&max_occur), sizeof(uint32_t));
+	os.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+	for (auto const& count : counts)
+	{
+		os.write(reinterpret_cast<const char*>(&count.first), sizeof(uint32_t));
+		os.write(reinterpret_cast<const char*>(&count.second), sizeof(uint64_t));
+	}
+} // ~OccurHist::write
+
+bool OccurHist::read(std::ifstream &is, uint32_t &max_occur)
+{
+	uint32_t size = 0;
+	if (!is.read(reinterpret_cast<char*>(&max_occur), sizeof(uint32_t)) 
+		|| !is.read(reinterpret_cast<char*>(&size), sizeof(uint32_t)))
+		return false;
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		uint32_t num_pos = 0;
+		uint64_t num = 0;
+		if (!is.read(reinterpret_cast<char*>(&num_pos), sizeof(uint32_t)) 
+			|| !is.read(reinterpret_cast<char*>(&num), sizeof(uint64_t)))
+			return false;
+		counts[num_pos] = num;
+	}
+	return true;
+} // ~OccurHist::read
+
 
 
 /*
@@ -977,139 +1099,786 @@ namespace {
 	}//~printlist()
 }
 
-void get_keys_file(std::string &keys_file, Runopts &opts)
+/**
+ * Build the mini-burst tries of the L/2-mers owned by the given shard i.e. the L/2-mers 'k' with (k % num_shards == shard)
+ *
+ * Each shard scans all the sequences of the index part in the order of the reference file, and only processes 
+ * the 19-mers, which L/2-mer prefix (forward trie) or suffix (reverse trie) it owns. Thus every burst trie gets exactly 
+ * the same insertions in exactly the same order as in the single threaded build, and the L/2-mer counts are the same.
+ *
+ * A new 18-mer gets the next shard local id, which is stored in the forward trie together with the 19-mer.
+ * The 19-mers sharing the 18-mer prefix are always in the same bucket and get the same id. 
+ * The ids in the reverse tries are set later in 'fill_positions_shard'.
+ *
+ * @param lookup_table  L/2-mer look-up table. Only the entries owned by the shard are modified.
+ * @param part_seqs     encoded sequences of the index part
+ * @param part_seqs_r   reversed sequences of the index part
+ * @param win_offsets   number of the first 19-mer window of each sequence counting from the start of the index part
+ * @param new_keys      window numbers of the unique 18-mers found by this shard. Indexed by the shard local id i.e. sorted.
+ */
+void build_tries_shard(
+	kmer* lookup_table,
+	std::vector<std::vector<unsigned char>> &part_seqs,
+	std::vector<std::vector<unsigned char>> &part_seqs_r,
+	std::vector<uint64_t> &win_offsets,
+	uint32_t shard,
+	uint32_t num_shards,
+	Runopts &opts,
+	std::vector<uint64_t> &new_keys)
 {
-	std::stringstream ss;
-	ss << "sortmerna_keys_" << getpid() << ".txt";
-	keys_file = opts.workdir.string() + ss.str();
+	// bool vector to keep track which L/2-mers have been counted for by the forward sliding L/2-mer window
+	std::vector<bool> incremented_by_forward((1 << opts.seed_win_len));
+
+	for (size_t i = 0; i < part_seqs.size(); ++i)
+	{
+		if (part_seqs[i].empty()) continue; // not indexed (see find_members)
+		uint32_t len = part_seqs[i].size();
+		uint32_t kmer_key_short_f = 0;
+		uint32_t kmer_key_short_r = 0;
+		unsigned char* kmer_key_short_f_p = &part_seqs[i][0];
+		unsigned char* kmer_key_short_r_p = &part_seqs[i][partialwin_gv + 1];
+		unsigned char* kmer_key_short_r_rp = &part_seqs_r[i][len - partialwin_gv - 1];
+
+		// initialize the prefix and suffix 9-mers
+		for (uint32_t j = 0; j < partialwin_gv; j++)
+		{
+			(kmer_key_short_f <<= 2) |= (int)*kmer_key_short_f_p++;
+			(kmer_key_short_r <<= 2) |= (int)*kmer_key_short_r_p++;
+		}
+
+		uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval;
+
+		// for all 19-mers on the sequence
+		for (uint32_t j = 0; j < numwin; j++)
+		{
+			// ****** add the forward 19-mer
+			if (kmer_key_short_f % num_shards == shard)
+			{
+				lookup_table[kmer_key_short_f].count++;
+				incremented_by_forward[kmer_key_short_f] = true;
+
+				// new position for 18-mer in positions_tbl
+				bool new_position = true;
+				uint32_t id = 0;
 
-	std::fstream ifs(keys_file, std::ios_base::out | std::ios_base::binary);
-	if (ifs.is_open())
+				// forward 19-mer does not exist in the burst trie (duplicates not allowed)
+				if (lookup_table[kmer_key_short_f].trie_F == NULL ||
+					!search_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, new_position, id))
+				{
+					// create a trie node if it doesn't exist
+					if (lookup_table[kmer_key_short_f].trie_F == NULL)
+					{
+						lookup_table[kmer_key_short_f].trie_F = (NodeElement*)malloc(4 * sizeof(NodeElement));
+						if (lookup_table[kmer_key_short_f].trie_F == NULL)
+						{
+							ERR("could not allocate memory for trie_node in indexdb.cpp");
+							exit(EXIT_FAILURE);
+						}
+						memset(lookup_table[kmer_key_short_f].trie_F, 0, 4 * sizeof(NodeElement));
+					}
+
+					// 18-mer doesn't exist in the burst trie - new id
+					if (new_position)
+					{
+						id = (uint32_t)new_keys.size();
+						new_keys.push_back(win_offsets[i] + j);
+					}
+
+					insert_prefix(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, id);
+				}
+			}
+
+			// ****** add the reverse 19-mer
+			if (kmer_key_short_r % num_shards == shard)
+			{
+				// increment 9-mer count only if it wasn't already incremented by kmer_key_short_f before
+				if (!incremented_by_forward[kmer_key_short_r]) lookup_table[kmer_key_short_r].count++;
+
+				bool new_position = true;
+				uint32_t id = 0;
+
+				// reverse 19-mer does not exist in the burst trie
+				if (lookup_table[kmer_key_short_r].trie_R == NULL ||
+					!search_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, new_position, id))
+				{
+					// create a trie node if it doesn't exist
+					if (lookup_table[kmer_key_short_r].trie_R == NULL)
+					{
+						lookup_table[kmer_key_short_r].trie_R = (NodeElement*)malloc(4 * sizeof(NodeElement));
+						if (lookup_table[kmer_key_short_r].trie_R == NULL)
+						{
+							ERR("could not allocate memory for trie_node in indexdb.cpp");
+							exit(EXIT_FAILURE);
+						}
+						memset(lookup_table[kmer_key_short_r].trie_R, 0, 4 * sizeof(NodeElement));
+					}
+
+					insert_prefix(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, 0);
+				}
+			}
+
+			// shift 19-mer window and both 9-mers
+			if (j != numwin - 1)
+			{
+				for (uint32_t shift = 0; shift < opts.interval; shift++)
+				{
+					((kmer_key_short_f <<= 2) &= mask32) |= (int)*kmer_key_short_f_p++;
+					((kmer_key_short_r <<= 2) &= mask32) |= (int)*kmer_key_short_r_p++;
+					kmer_key_short_r_rp--;
+				}
+			}
+		}//~for all 19-mers on the sequence
+	}//~for all sequences in the part
+} // ~build_tries_shard
+
+/**
+ * replace the shard local ids in the buckets of the given trie with the part ids
+ */
+void remap_trie_ids(NodeElement* trie_node, std::vector<uint32_t> &ids)
+{
+	for (int i = 0; i < 4; i++, trie_node++)
 	{
-		ifs.close();
+		if (trie_node->flag == 1)
+		{
+			remap_trie_ids(trie_node->nodetype.trie, ids);
+		}
+		else if (trie_node->flag == 2)
+		{
+			unsigned char* start_bucket = (unsigned char*)trie_node->nodetype.bucket;
+			unsigned char* end_bucket = start_bucket + trie_node->size;
+			for (; start_bucket != end_bucket; start_bucket += ENTRYSIZE)
+			{
+				uint32_t* id = (uint32_t*)(start_bucket + sizeof(uint32_t));
+				*id = ids[*id];
+			}
+		}
 	}
-	else
+} // ~remap_trie_ids
+
+/**
+ * Set the part ids in the forward tries of the L/2-mers owned by the given shard
+ *
+ * @param ids  part id for each shard local id
+ */
+void remap_ids_shard(kmer* lookup_table, std::vector<uint32_t> &ids, uint32_t shard, uint32_t num_shards, Runopts &opts)
+{
+	for (uint32_t k = shard; k < (uint32_t)(1 << opts.seed_win_len); k += num_shards)
 	{
-		ERR("Failed writing to file: " + keys_file + " Error: " + strerror(errno));
+		if (lookup_table[k].trie_F != NULL)
+			remap_trie_ids(lookup_table[k].trie_F, ids);
 	}
-} //~get_keys_file
+} // ~remap_ids_shard
 
 /**
- * TODO: remove - not used any longer. Outdated
+ * Set the 18-mer ids in the reverse burst tries, and fill the positions table for the L/2-mers owned by the given shard.
  *
- * Prepare the temporary file for storing keys of all s-mer (19-mer) words
- * of the reference sequences.
- * Required for CMPH to build the hash functions. See 'cmph_io_nlfile_adapter(keys)'
+ * The ids are taken from the forward tries i.e. all the forward tries must have the final ids (see 'remap_ids_shard').
+ * The forward tries are only read here, and can be shared between the shards.
+ * All the occurrences of an 18-mer have the same L/2-mer prefix i.e. are processed by the same shard, and
+ * are added to the positions table in the order of the reference file, same as in the single threaded build.
  */
-void get_keys_str(std::string &keys_str)
+void fill_positions_shard(
+	kmer* lookup_table,
+	kmer_origin* positions_tbl,
+	std::vector<std::vector<unsigned char>> &part_seqs,
+	std::vector<std::vector<unsigned char>> &part_seqs_r,
+	uint32_t shard,
+	uint32_t num_shards,
+	Runopts &opts)
 {
-	std::stringstream ss;
+	for (uint32_t i = 0; i < part_seqs.size(); ++i)
+	{
+		if (part_seqs[i].empty()) continue; // not indexed (see find_members)
+		uint32_t len = part_seqs[i].size();
+		uint32_t kmer_key_short_f = 0;
+		uint32_t kmer_key_short_r = 0;
+		unsigned char* kmer_key_short_f_p = &part_seqs[i][0];
+		unsigned char* kmer_key_short_r_p = &part_seqs[i][partialwin_gv + 1];
+		unsigned char* kmer_key_short_r_rp = &part_seqs_r[i][len - partialwin_gv - 1];
+
+		// initialize the 9-mers
+		for (uint32_t j = 0; j < partialwin_gv; j++)
+		{
+			(kmer_key_short_f <<= 2) |= (int)*kmer_key_short_f_p++;
+			(kmer_key_short_r <<= 2) |= (int)*kmer_key_short_r_p++;
+		}
+
+		uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval;
+		uint32_t index_pos = 0;
+
+		// for all 19-mers on the sequence
+		for (uint32_t j = 0; j < numwin; j++)
+		{
+			bool is_own_f = kmer_key_short_f % num_shards == shard;
+			bool is_own_r = kmer_key_short_r % num_shards == shard;
+
+			if (is_own_f || is_own_r)
+			{
+				uint32_t id = 0;
+				search_for_id(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, id);
+
+				if (is_own_f)
+					add_kmer_to_table(positions_tbl + id, i, index_pos, opts.max_pos);
+
+				if (is_own_r)
+					add_id_to_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, id);
+			}
+
+			// shift the 9-mers
+			if (j != numwin - 1)
+			{
+				for (uint32_t shift = 0; shift < opts.interval; shift++)
+				{
+					((kmer_key_short_f <<= 2) &= mask32) |= (int)*kmer_key_short_f_p++;
+					((kmer_key_short_r <<= 2) &= mask32) |= (int)*kmer_key_short_r_p++;
+					kmer_key_short_r_rp--;
+					index_pos++;
+				}
+			}
+		}
+	}//~for all sequences in the part
+} // ~fill_positions_shard
+
+/**
+ * Collect the (w,k)-minimizers of the sequences owned by the given shard with k = L, and the ids of the (L+1)-mers they start
+ * (see MinimizerIndex). The minimizers are selected among all the L-mers of a sequence, same as on the reads,
+ * but only the ones starting a window of the index (see 'opts.interval') have an id.
+ *
+ * The ids are taken from the forward tries i.e. all the forward tries must have the final ids (see 'remap_ids_shard').
+ */
+void collect_minimizers_shard(
+	kmer* lookup_table,
+	std::vector<std::vector<unsigned char>> &part_seqs,
+	uint32_t shard,
+	uint32_t num_shards,
+	Runopts &opts,
+	std::vector<std::pair<uint64_t, uint32_t>> &entries)
+{
+	for (uint32_t i = shard; i < part_seqs.size(); i += num_shards)
+	{
+		if (part_seqs[i].empty()) continue; // not indexed (see find_members)
+		uint32_t len = part_seqs[i].size();
+		uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval;
+		uint32_t last_win = (numwin - 1) * opts.interval;
+
+		for_each_minimizer(&part_seqs[i][0], len, opts.seed_win_len, opts.minimizer_w, [&](uint32_t pos, uint64_t code) {
+			if (pos > last_win || pos % opts.interval != 0) return;
+			// the id of the (L+1)-mer starting with the minimizer (see MinimizerIndex)
+			uint32_t kmer_key_short_f = (uint32_t)(code >> (2 * partialwin_gv));
+			uint32_t id = 0;
+			search_for_id(lookup_table[kmer_key_short_f].trie_F, &part_seqs[i][pos + partialwin_gv], id);
+			entries.push_back(std::make_pair(code, id));
+		});
+	}
+} // ~collect_minimizers_shard
+
+ExtPartBuilder::ExtPartBuilder(Runopts &opts)
+	: 
+	opts(opts),
+	sorter_mem((size_t)(opts.max_ram * 1024 * 1024 / 3)),
+	counts((size_t)1 << opts.seed_win_len, 0),
+	incremented_by_forward((size_t)1 << opts.seed_win_len),
+	occs(new ExtSorter<ext_occ>(opts.idxdir, "occ", sorter_mem)),
+	num_win(0),
+	num_seq(0)
+{}
+
+/**
+ * Count the L/2-mers of the sequence, and add its 19-mer occurrences. Same as 'build_tries_shard'
+ * the L/2-mer count is incremented for the forward window, and for the reverse window unless the forward
+ * window has already counted the L/2-mer.
+ */
+void ExtPartBuilder::add_seq(std::vector<unsigned char> &seq)
+{
+	if (seq.empty())
+	{
+		++num_seq; // not indexed (see find_members)
+		return;
+	}
 
-	char* tmpdir_env = NULL;
-	char pidStr[4000];
+	uint32_t numwin = (seq.size() - pread_gv + opts.interval) / opts.interval;
+	uint64_t kmer_key = 0;
+	unsigned char* kmer_key_p = &seq[0];
 
-	int32_t pid = getpid();
-	sprintf(pidStr, "%d", pid);
+	// initialize the 19-mer
+	for (uint32_t j = 0; j < pread_gv; j++) (kmer_key <<= 2) |= (int)*kmer_key_p++;
 
-	// try $TMPDIR, /tmp and local directories
-	bool try_further = true;
+	for (uint32_t j = 0; j < numwin; j++)
+	{
+		uint32_t kmer_key_short_f = (uint32_t)(kmer_key >> (2 * (pread_gv - partialwin_gv)));
+		uint32_t kmer_key_short_r = (uint32_t)(kmer_key & mask32);
+
+		counts[kmer_key_short_f]++;
+		incremented_by_forward[kmer_key_short_f] = true;
+		if (!incremented_by_forward[kmer_key_short_r]) counts[kmer_key_short_r]++;
+
+		ext_occ occ;
+		occ.kmer = kmer_key;
+		occ.win = num_win++;
+		occ.pos.pos = j * opts.interval;
+		occ.pos.seq = num_seq;
+		occs->push(occ);
+
+		// shift the 19-mer window
+		if (j != numwin - 1)
+		{
+			for (uint32_t shift = 0; shift < opts.interval; shift++)
+				((kmer_key <<= 2) &= mask64) |= (int)*kmer_key_p++;
+		}
+	}
+	++num_seq;
+} // ~ExtPartBuilder::add_seq
 
-	// try TMPDIR
-	tmpdir_env = getenv(ENV_TMPDIR.data());
-	if (tmpdir_env != NULL && strcmp(tmpdir_env, "") != 0)
+/**
+ * insert the L/2-mer trie key of the 19-mer into the trie, creating the trie if it doesn't exist
+ *
+ * @param first  the position of the first key character on the 19-mer
+ * @param step   +1 for the forward trie, -1 for the reverse trie (the key is read backwards)
+ */
+static void insert_ext_entry(NodeElement* &trie, ext_entry &entry, int first, int step)
+{
+	unsigned char key[32];
+	for (uint32_t t = 0; t <= partialwin_gv; ++t)
+		key[t] = (entry.kmer >> (2 * (pread_gv - 1 - (first + step * (int)t)))) & 3;
+
+	if (trie == NULL)
 	{
-		std::string tmp_dir(tmpdir_env);
-		if (tmp_dir[tmp_dir.size() - 1] != PATH_SEPARATOR)
-			tmp_dir += PATH_SEPARATOR;
+		trie = (NodeElement*)malloc(4 * sizeof(NodeElement));
+		if (trie == NULL)
+		{
+			ERR("could not allocate memory for trie_node in indexdb.cpp");
+			exit(EXIT_FAILURE);
+		}
+		memset(trie, 0, 4 * sizeof(NodeElement));
+	}
 
-		std::string tmp_file = tmp_dir + "test" + pidStr + ".txt";
+	insert_prefix(trie, key, entry.id);
+} // ~insert_ext_entry
+
+uint32_t ExtPartBuilder::write(const std::string &kmer_file, const std::string &btrie_file, const std::string &pos_file, PartOffsets &offsets, OccurHist &hist)
+{
+	timeval t;
+	double start = 0.0;
+	double end = 0.0;
+	uint32_t number_elements = 0;
 
-		FILE *tmp = fopen(tmp_file.data(), "w+");
-		if (tmp == NULL)
+	// 1. group the occurrences on the 18-mers. Get the unique 19-mers, and the (capped) 18-mer positions
+	DBG(opts.is_verbose, "    (2/3) sorting %llu 19-mer occurrences ..", (unsigned long long)occs->size());
+	TIME(start);
+	ExtSorter<ext_kmer> kmers(opts.idxdir, "kmer", sorter_mem);
+	{
+		ExtSorter<ext_pos> positions(opts.idxdir, "pos", sorter_mem);
+		occs->sort();
+
+		ext_occ occ;
+		uint64_t kmer18 = UINT64_MAX;
+		uint64_t win18 = 0;
+		uint32_t num_pos = 0;
+		unsigned seen = 0; // last nucleotides of the 19-mers seen for the current 18-mer
+		while (occs->next(occ))
 		{
-			ss.str("");
-			ss << "No write permissions in directory [" << tmpdir_env << "]: " << strerror(errno) << std::endl
-				<< "  will try /tmp/.";
-			WARN(ss.str());
+			if ((occ.kmer >> 2) != kmer18)
+			{
+				kmer18 = occ.kmer >> 2;
+				win18 = occ.win;
+				num_pos = 0;
+				seen = 0;
+				++number_elements;
+			}
+
+			if (!(seen & (1 << (occ.kmer & 3))))
+			{
+				seen |= 1 << (occ.kmer & 3);
+				kmers.push(ext_kmer{ win18, occ.win, occ.kmer });
+			}
+
+			// max_pos == 0 means to store all occurrences
+			if (opts.max_pos == 0 || num_pos < opts.max_pos)
+			{
+				positions.push(ext_pos{ win18, occ.win, occ.pos });
+				++num_pos;
+			}
 		}
-		else
+		occs.reset();
+
+		// 2. the positions ordered by the 18-mer ids
+		std::ofstream ospos(pos_file, std::ios::binary);
+		if (!ospos.is_open())
+		{
+			std::stringstream ss;
+			ss << STAMP << "Failed to open file: " << pos_file << " for writing. Error: " << strerror(errno);
+			ERR(ss.str());
+			exit(EXIT_FAILURE);
+		}
+		ospos.write(reinterpret_cast<const char*>(&number_elements), sizeof(uint32_t));
+
+		positions.sort();
+		ext_pos pos;
+		std::vector<seq_pos> group; // positions of the current 18-mer
+		uint32_t num_groups = 0;
+		win18 = UINT64_MAX;
+		for (bool is_next = positions.next(pos); ; is_next = positions.next(pos))
 		{
-			// remove the temporary test file
-			fclose(tmp);
-			if (remove(tmp_file.data()) != 0)
+			if (!group.empty() && (!is_next || pos.win18 != win18))
 			{
-				ss.str("");
-				ss << "Could not delete temporary file " << tmp_file.data();
-				WARN(ss.str());
+				if (num_groups++ % PartOffsets::STRIDE == 0)
+					offsets.pos.push_back(ospos.tellp());
+				uint32_t size = group.size();
+				ospos.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+				ospos.write(reinterpret_cast<const char*>(group.data()), sizeof(seq_pos) * size);
+				hist.add(size);
+				group.clear();
+			}
+			if (!is_next) break;
+			win18 = pos.win18;
+			group.push_back(pos.pos);
+		}
+		offsets.pos.push_back(ospos.tellp());
+		ospos.close();
+	}
+	TIME(end);
+	DBG(opts.is_verbose, " done [%f sec]\n", (end - start));
+
+	// 3. assign the 18-mer ids in the order of the first occurrence, and split the 19-mers into the trie entries
+	DBG(opts.is_verbose, "    (3/3) building burst tries ..");
+	TIME(start);
+	ExtSorter<ext_entry> entries_f(opts.idxdir, "trie_f", sorter_mem);
+	ExtSorter<ext_entry> entries_r(opts.idxdir, "trie_r", sorter_mem);
+	{
+		kmers.sort();
+		ext_kmer km;
+		uint64_t win18 = UINT64_MAX;
+		uint32_t id = 0;
+		while (kmers.next(km))
+		{
+			if (km.win18 != win18)
+			{
+				if (win18 != UINT64_MAX) ++id;
+				win18 = km.win18;
 			}
-			// set working directory
-			keys_str += tmp_dir;
-			//memcpy(keys_str.data(), tmp_dir.data(), 4000);
-			try_further = false;
+			entries_f.push(ext_entry{ km.kmer, km.win, (uint32_t)(km.kmer >> (2 * (pread_gv - partialwin_gv))), id });
+			entries_r.push(ext_entry{ km.kmer, km.win, (uint32_t)(km.kmer & mask32), id });
 		}
 	}
 
-	// try "/tmp" directory
-	if (try_further)
+	// 4. build and write the burst tries one L/2-mer at a time
+	std::ofstream btrie(btrie_file, std::ofstream::binary);
+	if (!btrie.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open file: " << btrie_file << " for writing. Error: " << strerror(errno);
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	entries_f.sort();
+	entries_r.sort();
+	ext_entry ef, er;
+	bool is_f = entries_f.next(ef);
+	bool is_r = entries_r.next(er);
+	for (uint32_t i = 0; i < (uint32_t)(1 << opts.seed_win_len); i++)
+	{
+		kmer entry = { NULL, NULL, counts[i] };
+		if (i % PartOffsets::STRIDE == 0)
+			offsets.tries.push_back(btrie.tellp());
+
+		// forward key: the 19-mer suffix following the L/2-mer
+		for (; is_f && ef.key == i; is_f = entries_f.next(ef))
+			insert_ext_entry(entry.trie_F, ef, partialwin_gv, 1);
+
+		// reverse key: the reversed 19-mer prefix preceding the L/2-mer
+		for (; is_r && er.key == i; is_r = entries_r.next(er))
+			insert_ext_entry(entry.trie_R, er, partialwin_gv, -1);
+
+		write_tries(btrie, entry);
+
+		if (entry.trie_F != NULL)
+		{
+			freebursttrie(entry.trie_F);
+			free(entry.trie_F);
+		}
+		if (entry.trie_R != NULL)
+		{
+			freebursttrie(entry.trie_R);
+			free(entry.trie_R);
+		}
+	}
+	offsets.tries.push_back(btrie.tellp());
+	btrie.close();
+	TIME(end);
+	DBG(opts.is_verbose, " done [%f sec]\n", (end - start));
+
+	// 5. the L/2-mer counts
+	std::ofstream oskmer(kmer_file, std::ios::binary);
+	if (!oskmer.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open file: " << kmer_file << " for writing. Error: " << strerror(errno);
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	oskmer.write(reinterpret_cast<const char*>(counts.data()), sizeof(uint32_t) * counts.size());
+	oskmer.close();
+
+	return number_elements;
+} // ~ExtPartBuilder::write
+
+/**
+ * read the '.stats' file of an existing index to continue it with the sequences appended to the reference file
+ *
+ * The background frequencies are converted back to the nucleotide counts using the total length of the indexed
+ * sequences, which includes the ambiguous 'N's i.e. the merged frequencies slightly differ from the ones of
+ * a full rebuild if the reference has 'N's.
+ *
+ * @param start_file      size of the reference file when it was indexed i.e. start of the appended sequences
+ * @param background_freq nucleotide counts of the indexed sequences
+ * @param strs            2 x number of the indexed sequences (see 'build_index')
+ * @param part_num        number of the existing index parts
+ * @param hist            positions histogram of the existing index parts (see OccurHist)
+ * @param ref_hash        hash of the reference file up to 'start_file' (see ref_file_hash)
+ */
+static void read_index_stats(
+	const std::string &stats_file,
+	Runopts &opts,
+	size_t &start_file,
+	double(&background_freq)[4],
+	uint64_t &full_len,
+	uint64_t &strs,
+	uint16_t &part_num,
+	std::vector<index_parts_stats> &index_parts_stats_vec,
+	std::vector<std::pair<std::string, uint32_t>> &sam_sq_header,
+	OccurHist &hist,
+	uint64_t &ref_hash)
+{
+	std::ifstream stats(stats_file, std::ios::binary);
+	if (!stats.good())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Cannot open the index file [" << stats_file << "]";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	stats.read(reinterpret_cast<char*>(&start_file), sizeof(size_t));
+	uint32_t fasta_len = 0;
+	stats.read(reinterpret_cast<char*>(&fasta_len), sizeof(uint32_t));
+	std::string fasta_name(fasta_len, 0);
+	stats.read(&fasta_name[0], fasta_len);
+	stats.read(reinterpret_cast<char*>(background_freq), sizeof(double) * 4);
+	stats.read(reinterpret_cast<char*>(&full_len), sizeof(uint64_t));
+	uint32_t seed_win_len = 0;
+	stats.read(reinterpret_cast<char*>(&seed_win_len), sizeof(uint32_t));
+	uint64_t numseq = 0;
+	stats.read(reinterpret_cast<char*>(&numseq), sizeof(uint64_t));
+	strs = numseq * 2;
+	stats.read(reinterpret_cast<char*>(&part_num), sizeof(uint16_t));
+	for (uint16_t j = 0; j < part_num; j++)
+	{
+		index_parts_stats part;
+		stats.read(reinterpret_cast<char*>(&part), sizeof(index_parts_stats));
+		index_parts_stats_vec.push_back(part);
+	}
+
+	uint32_t num_sq = 0;
+	stats.read(reinterpret_cast<char*>(&num_sq), sizeof(uint32_t));
+	for (uint32_t j = 0; j < num_sq; j++)
+	{
+		uint32_t len_id = 0;
+		stats.read(reinterpret_cast<char*>(&len_id), sizeof(uint32_t));
+		std::string id(len_id, 0);
+		stats.read(&id[0], len_id);
+		uint32_t len = 0;
+		stats.read(reinterpret_cast<char*>(&len), sizeof(uint32_t));
+		sam_sq_header.push_back(std::pair<std::string, uint32_t>(id, len));
+	}
+
+	if (!stats)
+	{
+		std::stringstream ss;
+		ss << STAMP << "The index file [" << stats_file << "] is truncated or corrupted. Build the index anew.";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	if (seed_win_len != opts.seed_win_len)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Cannot append to the index [" << stats_file << "] built with the seed length " << seed_win_len 
+			<< " using the seed length " << opts.seed_win_len << ". Use the option '" << OPT_L << " " << seed_win_len << "'";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	// the positions encoding. Not present in the indices built before the option existed.
+	uint32_t packed_pos = 0;
+	if (!stats.read(reinterpret_cast<char*>(&packed_pos), sizeof(uint32_t)))
+		packed_pos = 0;
+	if ((packed_pos != 0) != opts.is_packed_pos)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Cannot append to the index [" << stats_file << "] built " << (packed_pos ? "with" : "without")
+			<< " the option '" << OPT_PACKED_POS << "' " << (packed_pos ? "without" : "with") << " the option";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	uint32_t max_occur = 0;
+	if (!hist.read(stats, max_occur) && opts.mask_frac > 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "The index [" << stats_file << "] has no positions histogram. The masking threshold of the option '"
+			<< OPT_MASK_FRAC << "' is computed from the appended sequences only";
+		WARN(ss.str());
+	}
+
+	// not present in the indices built before the option 'index_append' checked the indexed sequences
+	if (!stats.read(reinterpret_cast<char*>(&ref_hash), sizeof(uint64_t)))
+	{
+		std::stringstream ss;
+		ss << STAMP << "The index [" << stats_file << "] has no checksum of the indexed reference file i.e. the sequences "
+			<< "appended to the file cannot be told from the modified ones. Build the index anew.";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < 4; ++i)
+		background_freq[i] *= full_len;
+} // ~read_index_stats
+
+/**
+ * hash of the first 'len' bytes of the reference file, stored in the '.stats' file to check that the indexed
+ * sequences are unchanged when the sequences appended to the file are indexed (option 'index_append')
+ */
+static uint64_t ref_file_hash(FILE* fp, size_t len)
+{
+	uint64_t hash = fnv1a(nullptr, 0);
+	std::vector<char> buf(1 << 20);
+	fseek(fp, 0, SEEK_SET);
+	while (len > 0)
+	{
+		size_t num = fread(buf.data(), 1, std::min(len, buf.size()), fp);
+		if (num == 0)
+			break;
+		hash = fnv1a(buf.data(), num, hash);
+		len -= num;
+	}
+	return hash;
+} // ~ref_file_hash
+
+// reference sequence represented in the index by another sequence (option 'dedup')
+struct ref_member
+{
+	int64_t rep; // number of the representative sequence. -1 - the sequence is indexed.
+	uint32_t offset; // the sequence is [offset, offset + length) of the representative
+};
+
+/**
+ * find the reference sequences, which are duplicates of an earlier sequence, and with 'is_contained' also the ones,
+ * which are found within a longer sequence. Such member sequences are not indexed, their seeds are found on
+ * the representative, and the alignments are reported for the members too (see References::load_members).
+ *
+ * The contained sequences are found using the first (L+1)-mer of each sequence: the sequences are scanned for
+ * the first (L+1)-mers of the shorter sequences, which are compared at the positions found. Only one (L+1)-mer
+ * per sequence is held in memory.
+ * The containers, which are themselves contained, are replaced by their representative at the end, so the
+ * representative of a sequence is always an indexed sequence.
+ *
+ * @param seqs  upper case sequences in the order of the reference file
+ * @return      representative of each sequence
+ */
+static std::vector<ref_member> find_members(const std::vector<std::string> &seqs, bool is_contained)
+{
+	std::vector<ref_member> members(seqs.size(), ref_member{ -1, 0 });
+
+	// the duplicates are represented by the first occurrence
+	std::unordered_map<std::string_view, uint32_t> first;
+	for (uint32_t i = 0; i < seqs.size(); ++i)
+	{
+		auto res = first.emplace(std::string_view(seqs[i]), i);
+		if (!res.second)
+			members[i].rep = res.first->second;
+	}
+	std::unordered_map<std::string_view, uint32_t>().swap(first);
+
+	if (is_contained)
 	{
-		char tmp_str[4000] = "";
-		strcat(tmp_str, "/tmp/test_");
-		strcat(tmp_str, pidStr);
-		strcat(tmp_str, ".txt");
+		struct kmer_pos
+		{
+			uint64_t kmer;
+			uint32_t seq;
+			uint32_t pos;
+			bool operator<(const kmer_pos &o) const { return kmer < o.kmer; }
+		};
+		auto code = [](char c) {
+			switch (c)
+			{
+			case 'A': return 0;
+			case 'C': return 1;
+			case 'G': return 2;
+			case 'T': case 'U': return 3;
+			default: return -1;
+			}
+		};
+		// calls 'fn(pos, kmer)' for the (L+1)-mers of the sequence made of A, C, G, T only. Stops if 'fn' returns true.
+		auto for_kmers = [&code](const std::string &seq, auto fn) {
+			uint64_t kmer = 0;
+			uint32_t valid = 0; // number of the last valid characters
+			for (uint32_t i = 0; i < seq.size(); ++i)
+			{
+				int c = code(seq[i]);
+				valid = c < 0 ? 0 : valid + 1;
+				kmer = ((kmer << 2) | (c < 0 ? 0 : c)) & mask64;
+				if (valid >= pread_gv && fn(i + 1 - pread_gv, kmer))
+					return;
+			}
+		};
 
-		FILE *tmp = fopen(tmp_str, "w+");
-		if (tmp == NULL)
+		// the first (L+1)-mer of each indexed sequence
+		std::vector<kmer_pos> firsts;
+		for (uint32_t i = 0; i < seqs.size(); ++i)
 		{
-			ss.str("");
-			ss << "No write permissions in directory /tmp/: " << strerror(errno) << std::endl
-				<< "  will try local directory.";
-			WARN(ss.str());
+			if (members[i].rep != -1)
+				continue;
+			for_kmers(seqs[i], [&firsts, i](uint32_t pos, uint64_t kmer) {
+				firsts.push_back(kmer_pos{ kmer, i, pos });
+				return true;
+			});
 		}
-		else
-		{
-			// remove the temporary test file
-			if (remove(tmp_str) != 0)
-				std::cerr << YELLOW << "  WARNING" << COLOFF << ": could not delete temporary file " << tmp_str << std::endl;
-
-			// set working directory
-			strcat(keys_str.data(), "/tmp/");
+		std::sort(firsts.begin(), firsts.end());
 
-			try_further = false;
+		// the (L+1)-mers of the indexed sequences, which are the first (L+1)-mer of a shorter sequence,
+		// give the candidate positions of the shorter sequence
+		for (uint32_t t = 0; t < seqs.size() && !firsts.empty(); ++t)
+		{
+			if (members[t].rep != -1)
+				continue; // the sequences within 't' are found within its representative too
+			for_kmers(seqs[t], [&](uint32_t pos, uint64_t kmer) {
+				auto range = std::equal_range(firsts.begin(), firsts.end(), kmer_pos{ kmer, 0, 0 });
+				for (auto it = range.first; it != range.second; ++it)
+				{
+					uint32_t s = it->seq;
+					if (members[s].rep != -1 || seqs[t].size() <= seqs[s].size() || pos < it->pos)
+						continue;
+					uint32_t start = pos - it->pos;
+					if (start + seqs[s].size() <= seqs[t].size() && seqs[t].compare(start, seqs[s].size(), seqs[s]) == 0)
+						members[s] = ref_member{ t, start }; // 't' may itself be contained in a longer sequence (see below)
+				}
+				return false;
+			});
 		}
 	}
 
-	// try the local directory
-	if (try_further)
+	// the duplicates of the contained sequences are represented by the container
+	for (uint32_t i = 0; i < seqs.size(); ++i)
 	{
-		char tmp_str[4000] = "";
-		strcat(tmp_str, "./test_");
-		strcat(tmp_str, pidStr);
-		strcat(tmp_str, ".txt");
-
-		FILE *tmp = fopen(tmp_str, "w+");
-		if (tmp == NULL)
+		while (members[i].rep != -1 && members[members[i].rep].rep != -1)
 		{
-			ss.str("");
-			ss << "No write permissions in current directory: " << strerror(errno) << std::endl
-				<< "  Please set --tmpdir to a writable directory,"
-				<< " or change the write permissions in $TMPDIR, e.g. /tmp/ (Linux), or current directory.";
-			ERR(ss.str());
-			exit(EXIT_FAILURE);
-		}
-		else
-		{
-			// remove the temporary test file
-			if (remove(tmp_str) != 0)
-				std::cerr << YELLOW << "  WARNING" << COLOFF << ": could not delete temporary file " << tmp_str << std::endl;
-
-			// set working directory
-			strcat(keys_str.data(), "./");
-			try_further = false;
+			members[i].offset += members[members[i].rep].offset;
+			members[i].rep = members[members[i].rep].rep;
 		}
 	}
-
-	keys_str = keys_str + "sortmerna_keys_" + pidStr + ".txt";
-} // ~get_keys_str
+	return members;
+} // ~find_members
 
 /**
  *
@@ -1137,11 +1906,6 @@ int build_index(Runopts &opts)
 	mask32 = (1 << opts.seed_win_len) - 1;
 	mask64 = (2ULL << ((pread_gv * 2) - 1)) - 1;
 
-	// temp file for storing keys of all s-mer (19-mer) words of the reference sequences. 
-	// Required for CMPH to build minimal perfect hash functions
-	std::string keys_file;
-	get_keys_file(keys_file, opts);
-
 	DBG(opts.is_verbose, "\n  Parameters summary: \n");
 	DBG(opts.is_verbose, "    K-mer size: %d\n", opts.seed_win_len + 1);
 	DBG(opts.is_verbose, "    K-mer interval: %d\n", opts.interval);
@@ -1153,6 +1917,12 @@ int build_index(Runopts &opts)
 
 	DBG(opts.is_verbose, "\n  Total number of databases to index: %d\n", (int)opts.indexfiles.size());
 
+	// number of threads for building the index. Each thread builds the burst tries of a subset (shard) of L/2-mers.
+	uint32_t num_build_thread = opts.num_proc_thread > 0 ? opts.num_proc_thread : std::thread::hardware_concurrency();
+	if (num_build_thread == 0) num_build_thread = 1;
+	DBG(opts.is_verbose, "    Number of indexing threads: %d\n", num_build_thread);
+	ThreadPool tpool(num_build_thread);
+
 	// build index for each pair in indexfiles vector
 	// Split the index into smaller parts when 'opts.max_file_size' is exceeded
 	for (auto idxpair: opts.indexfiles)
@@ -1163,6 +1933,9 @@ int build_index(Runopts &opts)
 		// the original FASTA file were added to each index part
 		std::vector<index_parts_stats> index_parts_stats_vec;
 
+		// numbers of positions of the (L+1)-mers of all the parts
+		OccurHist hist;
+
 		// Open reference file for reading
 		FILE *fp = fopen(idxpair.first.data(), "r");
 		if (fp == NULL)
@@ -1210,9 +1983,70 @@ int build_index(Runopts &opts)
 		// total length of reference sequences
 		uint64_t full_len = 0;
 		int nt = 0;
+		// number of the index part
+		uint16_t part_num = 0;
+		// where to start reading the reference file. Non zero when appending to an existing index.
+		size_t start_file = 0;
+		// hash of the reference file up to 'start_file' (see ref_file_hash)
+		uint64_t ref_hash = 0;
+
+		// append mode - continue the existing index from the end of the previously indexed reference file
+		std::string stats_file = idxpair.second + ".stats";
+		if (opts.is_index_append && std::filesystem::exists(stats_file) && !std::filesystem::is_empty(stats_file))
+		{
+			read_index_stats(stats_file, opts, start_file, background_freq, full_len, strs, part_num,
+				index_parts_stats_vec, sam_sq_header, hist, ref_hash);
+
+			// the indexed sequences must be unchanged, and the appended part must start with a new sequence
+			bool is_appended = start_file <= filesize && ref_file_hash(fp, start_file) == ref_hash;
+			if (is_appended && start_file < filesize)
+			{
+				fseek(fp, start_file, SEEK_SET);
+				is_appended = fgetc(fp) == '>';
+			}
+			if (!is_appended)
+			{
+				ss.str("");
+				ss << STAMP << "The reference file " << idxpair.first << " was modified other than by appending sequences "
+					<< "since it was indexed (indexed size: " << start_file << ", current size: " << filesize << "). "
+					<< "Remove the index files " << idxpair.second << ".* and build the index anew.";
+				ERR(ss.str());
+				exit(EXIT_FAILURE);
+			}
+
+			if (start_file == filesize)
+			{
+				ss.str("");
+				ss << STAMP << "No sequences were appended to " << idxpair.first << " since it was indexed. Nothing to do.";
+				DBG(opts.is_verbose, "%s\n", ss.str().data());
+				fclose(fp);
+				continue;
+			}
+			fseek(fp, start_file, SEEK_SET);
+
+			ss.str("");
+			ss << STAMP << "Appending to the index of " << part_num << " parts " << (strs / 2) << " sequences. Indexing " 
+				<< (filesize - start_file) << " bytes starting from position " << start_file << std::endl;
+			DBG(opts.is_verbose, ss.str().data());
+		}
+
+		// the sequences searched for the duplicates are held in memory (see find_members)
+		if (opts.is_dedup && opts.max_ram > 0 && filesize - start_file > opts.max_ram * 1024 * 1024)
+		{
+			ss.str("");
+			ss << STAMP << "The option '" << OPT_DEDUP << "' holds the reference sequences in memory while indexing: "
+				<< (filesize - start_file) / (1024 * 1024) << " MB of " << idxpair.first << " do not fit into '"
+				<< OPT_MAX_RAM << " " << opts.max_ram << "'. Increase '" << OPT_MAX_RAM << "' or index without '" << OPT_DEDUP << "'";
+			ERR(ss.str());
+			exit(EXIT_FAILURE);
+		}
 
 		DBG(opts.is_verbose, "  Collecting nucleotide distribution statistics ..");
 
+		// the sequences searched for the duplicates (option 'dedup')
+		std::vector<std::string> dedup_seqs;
+		size_t num_sq_indexed = sam_sq_header.size(); // number of the sequences of the existing index parts
+
 		TIME(start);
 		do
 		{
@@ -1246,6 +2080,7 @@ int build_index(Runopts &opts)
 
 			*p_header = '\0';
 			len = 0;
+			if (opts.is_dedup) dedup_seqs.emplace_back();
 
 			// scan through the sequence, count its length
 			nt = fgetc(fp);
@@ -1256,6 +2091,7 @@ int build_index(Runopts &opts)
 				{
 					len++;
 					if (nt != 'N') background_freq[(int)map_nt[nt]]++;
+					if (opts.is_dedup && nt != '\r') dedup_seqs.back().push_back((char)toupper(nt));
 				}
 				nt = fgetc(fp);
 			}
@@ -1282,19 +2118,51 @@ int build_index(Runopts &opts)
 
 		DBG(opts.is_verbose, "  done  [%f sec]\n", (end - start));
 
-		// set file pointer back to the beginning of file
-		rewind(fp);
+		// the duplicate sequences are not indexed. Their representatives are listed in the '.members' file:
+		//   representative id | member id | offset of the member on the representative | member length
+		// When appending, the appended sequences are only compared with each other.
+		std::vector<ref_member> members;
+		std::string members_file = idxpair.second + ".members";
+		if (opts.is_dedup)
+		{
+			DBG(opts.is_verbose, "  Searching duplicate sequences ..");
+			TIME(start);
+			members = find_members(dedup_seqs, opts.is_dedup_contained);
+			std::vector<std::string>().swap(dedup_seqs);
+
+			std::ofstream osmem(members_file, start_file > 0 ? std::ios::app : std::ios::trunc);
+			uint32_t num_members = 0;
+			for (size_t i = 0; i < members.size(); ++i)
+			{
+				if (members[i].rep == -1) continue;
+				osmem << sam_sq_header[num_sq_indexed + members[i].rep].first << "\t"
+					<< sam_sq_header[num_sq_indexed + i].first << "\t"
+					<< members[i].offset << "\t" << sam_sq_header[num_sq_indexed + i].second << "\n";
+				++num_members;
+			}
+			osmem.close();
+			TIME(end);
+			DBG(opts.is_verbose, "  done  [%f sec] %u of %zu sequences are represented by another sequence\n", 
+				(end - start), num_members, members.size());
+		}
+		else if (start_file == 0)
+		{
+			std::error_code ec;
+			std::filesystem::remove(members_file, ec); // stale
+		}
+		uint32_t seq_num = 0; // number of the sequence counting from 'start_file'
+
+		// set file pointer back to the beginning of the sequences to index
+		fseek(fp, start_file, SEEK_SET);
 
 		/* END STEP 1 ***************************************************************************/
 
 		/* STEP 2 *******************************************************************************/
 		/* For every part of total index,
-			 (a) build the burst trie and set all 19-mer ids to 0
-			 (b) count the number of unique 19-mers in the database
-			 (c) output the unique 19-mers into a file for MPHF */
+			 (a) build the burst trie and give each unique 18-mer a dense id
+			 (b) count the number of unique 18-mers in the database
+			 (c) fill the positions table indexed by the 18-mer ids */
 
-		// number of the index part
-		uint16_t part_num = 0;
 		// starting position given by ftell() where to
 		// begin reading the reference sequences
 		unsigned long int start_part = 0;
@@ -1312,41 +2180,19 @@ int build_index(Runopts &opts)
 			// set the file pointer to the beginning of the current part
 			start_part = ftell(fp);
 
-			// store all s-mer (19-mer) words of the reference sequences in a file. 
-			// Required for CMPH to build minimal perfect hash functions
-			FILE *keys = fopen(keys_file.c_str(), "w+");
-			if (keys == NULL)
-			{
-				ss.str("");
-				ss << "Could not open [" << keys_file << "] file for writing";
-				ERR(ss.str());
-				exit(EXIT_FAILURE);
-			}
-
 			// count of unique 19-mers in database
 			uint32_t number_elements = 0;
 
-			// table storing occurrence of each 9-mer and pointers to
-			// the forward and reverse burst tries
-			kmer *lookup_table = (kmer*)malloc((1 << opts.seed_win_len) * sizeof(kmer));
-			if (lookup_table == NULL)
-			{
-				ss.str("");
-				ss << STAMP << "Could not allocate memory for 9-mer look-up table";
-				ERR(ss.str());
-				exit(EXIT_FAILURE);
-			}
-
-			memset(lookup_table, 0, (1 << opts.seed_win_len) * sizeof(kmer));
-
-			// bool vector to keep track which L/2-mers have been counted for by the forward sliding L/2-mer window
-			std::vector<bool> incremented_by_forward((1 << opts.seed_win_len));
+			// bounded memory build of the part using temporary files (option 'max_ram')
+			std::unique_ptr<ExtPartBuilder> ext_builder;
+			if (opts.max_ram > 0)
+				ext_builder.reset(new ExtPartBuilder(opts));
 
 			// total size of index so far in bytes
 			index_size = 0;
 
 			DBG(opts.is_verbose, "\n  start index part # %d: \n", part_num);
-			DBG(opts.is_verbose, "    (1/3) building burst tries ..");
+			DBG(opts.is_verbose, ext_builder ? "    (1/3) counting 19-mers .." : "    (1/3) building burst tries ..");
 
 			TIME(start);
 
@@ -1361,7 +2207,9 @@ int build_index(Runopts &opts)
 			// we store all unique 18-mer positions (not 19-mer) because if an 18-mer on a read matches exactly to the prefix
 			// or suffix of a 19-mer in the mini-burst trie, we need to recover all of the 18-mer occurrences in the database
 			//
-			// read the reads file char by char
+			// read the sequences of this part. Encode each sequence using integer alphabet {0,1,2,3}
+			std::vector<std::vector<unsigned char>> part_seqs;
+			std::vector<std::vector<unsigned char>> part_seqs_r; // reversed sequences
 			do
 			{
 				// start of current sequence in file
@@ -1371,33 +2219,35 @@ int build_index(Runopts &opts)
 				// scan to end of header name
 				while (nt != '\n') nt = fgetc(fp);
 
-				unsigned char* myseq = new unsigned char[maxlen];
-				unsigned char* myseqr = new unsigned char[maxlen];
-				uint32_t _j = 0;
-				len = 0;
+				std::vector<unsigned char> myseq;
+				myseq.reserve(maxlen);
 
 				nt = fgetc(fp);
-				// encode each sequence using integer alphabet {0,1,2,3}
 				while (nt != '>' && nt != EOF)
 				{
 					// skip line feed, carriage return or empty space in the sequence
 					if (nt != '\n' && nt != ' ')
 					{
-						len++;
 						// exact character
-						myseq[_j++] = map_nt[nt];
+						myseq.push_back(map_nt[nt]);
 					}
 					nt = fgetc(fp);
 				}
+				len = myseq.size();
 
 				// end of current sequence in file
 				if (nt != EOF) ungetc(nt, fp);
 
 				long int end_seq = ftell(fp);
 
+				// the sequence is represented by another one, and is only counted in the part (see find_members)
+				bool is_member = !members.empty() && members[seq_num].rep != -1;
+				if (is_member)
+					myseq.clear();
+
 				// check the addition of this sequence will not overflow the
-				// maximum memory (estimated memory 10 bytes per L-mer)
-				double estimated_seq_mem = (len - pread_gv + 1)*9.5e-6;
+				// maximum memory (estimated memory 10 bytes per L-mer, of which 8 bytes are the position)
+				double estimated_seq_mem = is_member ? 0 : (len - pread_gv + 1) * (opts.is_packed_pos ? PACKED_MEM_PER_LMER : 9.5e-6);
 
 				// the sequence alone is too large, it will not fit into maximum
 				// memory, skip it
@@ -1415,6 +2265,7 @@ int build_index(Runopts &opts)
 					std::cerr << "` will not fit into " << opts.max_file_size << " Mbytes memory, it will be skipped.";
 					std::cerr << "  If memory can be increased, please try `-m " << estimated_seq_mem << "` Mbytes.";
 					fseek(fp, end_seq, SEEK_SET);
+					++seq_num;
 					continue;
 				}
 				// the additional sequence will overflow the maximum index memory,
@@ -1439,178 +2290,151 @@ int build_index(Runopts &opts)
 					seq_part_size = ftell(fp) - start_part;
 					// record the number of sequences in this part
 					numseq_part++;
+					++seq_num;
 				}
 
-				// create a reverse sequence using the forward
-				unsigned char* ptr = &myseq[len - 1];
-
-				for (_j = 0; _j < len; _j++) myseqr[_j] = *ptr--;
-				// 9-mer prefix of 19-mer
-				uint32_t kmer_key_short_f = 0;
-				// 9-mer suffix of 19-mer
-				uint32_t kmer_key_short_r = 0;
-				// pointer to next letter to add to 9-mer prefix
-				unsigned char* kmer_key_short_f_p = &myseq[0];
-				// pointer to next letter to add to 9-mer suffix
-				unsigned char* kmer_key_short_r_p = &myseq[partialwin_gv + 1];
-				// pointer to 10-mer of reverse 19-mer to insert
-				// into the mini-burst trie
-				unsigned char* kmer_key_short_r_rp = &myseqr[len - partialwin_gv - 1];
-				// 19-mer
-				unsigned long long int kmer_key = 0;
-				// pointer to 19-mer
-				unsigned char* kmer_key_ptr = &myseq[0];
-
-				// initialize the prefix and suffix 9-mers
-				for (uint32_t j = 0; j < partialwin_gv; j++)
+				if (ext_builder)
 				{
-					(kmer_key_short_f <<= 2) |= (int)*kmer_key_short_f_p++;
-					(kmer_key_short_r <<= 2) |= (int)*kmer_key_short_r_p++;
+					ext_builder->add_seq(myseq);
+					continue;
 				}
 
-				// initialize the 19-mer
-				for (uint32_t j = 0; j < pread_gv; j++) (kmer_key <<= 2) |= (int)*kmer_key_ptr++;
-
-				uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval; //TESTING
-				uint32_t index_pos = 0;
+				// create a reverse sequence using the forward
+				part_seqs_r.push_back(std::vector<unsigned char>(myseq.rbegin(), myseq.rend()));
+				part_seqs.push_back(std::move(myseq));
 
-				// for all 19-mers on the sequence
-				for (uint32_t j = 0; j < numwin; j++) //TESTING
-				{
-					lookup_table[kmer_key_short_f].count++;
-					incremented_by_forward[kmer_key_short_f] = true;
-					// increment 9-mer count only if it wasn't already
-					// incremented by kmer_key_short_f before
-					if (!incremented_by_forward[kmer_key_short_r]) lookup_table[kmer_key_short_r].count++;
+			} while (nt != EOF); // end of reads file
 
-					// ****** add the forward 19-mer
+			// covert part number into a string
+			ss.str("");
+			ss << part_num;
+			std::string part_str = ss.str();
 
-					// new position for 18-mer in positions_tbl
-					bool new_position = true;
+			std::string kmer_file = idxpair.second + ".kmer_" + part_str + ".dat";
+			std::string btrie_file = idxpair.second + ".bursttrie_" + part_str + ".dat";
+			std::string pos_file = idxpair.second + ".pos_" + part_str + ".dat";
+			std::string offsets_file = idxpair.second + ".offsets_" + part_str + ".dat";
+			PartOffsets offsets;
 
-					// forward 19-mer does not exist in the burst trie (duplicates not allowed)
-					if (lookup_table[kmer_key_short_f].trie_F == NULL ||
-						(lookup_table[kmer_key_short_f].trie_F != NULL && 
-						!search_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, new_position)))
-					{
-						// create a trie node if it doesn't exist
-						if (lookup_table[kmer_key_short_f].trie_F == NULL)
-						{
-							lookup_table[kmer_key_short_f].trie_F = (NodeElement*)malloc(4 * sizeof(NodeElement));
-							if (lookup_table[kmer_key_short_f].trie_F == NULL)
-							{
-								std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for trie_node in indexdb.cpp" << std::endl;
-								exit(EXIT_FAILURE);
-							}
-							memset(lookup_table[kmer_key_short_f].trie_F, 0, 4 * sizeof(NodeElement));
-						}
+			// the image of the previous index part is stale (see Index::convert)
+			std::error_code ec;
+			std::filesystem::remove(idxpair.second + ".img_" + part_str + ".dat", ec);
+			std::filesystem::remove(MinimizerIndex::file_name(idxpair.second, part_num), ec);
 
-						insert_prefix(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p);
-					}
+			index_parts_stats thispart;
+			memset(&thispart, 0, sizeof(index_parts_stats)); // written as is to .stats - zero the padding
+			thispart.start_part = start_part;
+			thispart.seq_part_size = seq_part_size;
+			thispart.numseq_part = numseq_part;
 
-					// 18-mer doesn't exist in the burst trie, add it to keys file
-					if (new_position)
-					{
-						// increment number of unique 18-mers
-						number_elements++;
-						fprintf(keys, "%llu\n", (kmer_key >> 2));
-					}
+			if (ext_builder)
+			{
+				TIME(end);
+				if (numseq_part == 0)
+				{
+					DBG(opts.is_verbose, "\n  %sERROR%s: no index was created, all of your sequences are "
+						"too large to be indexed with the current memory limit of %e Mbytes.\n",
+						RED, COLOFF, opts.max_file_size);
+					break;
+				}
+				DBG(opts.is_verbose, " done  [%f sec]\n", (end - start));
 
-					// ****** add the reverse 19-mer
-					new_position = true;
+				number_elements = ext_builder->write(kmer_file, btrie_file, pos_file, offsets, hist);
+				offsets.write(offsets_file);
+				DBG(opts.is_verbose, "    total number of sequences in this part = %d\n", ext_builder->num_seqs());
+				DBG(opts.is_verbose, "      wrote %s, %s, %s\n", kmer_file.data(), btrie_file.data(), pos_file.data());
 
-					// reverse 19-mer does not exist in the burst trie
-					if (lookup_table[kmer_key_short_r].trie_R == NULL ||
-						((lookup_table[kmer_key_short_r].trie_R != NULL) && 
-						!search_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, new_position)))
-					{
-						// create a trie node if it doesn't exist
-						if (lookup_table[kmer_key_short_r].trie_R == NULL)
-						{
-							lookup_table[kmer_key_short_r].trie_R = (NodeElement*)malloc(4 * sizeof(NodeElement));
-							if (lookup_table[kmer_key_short_r].trie_R == NULL)
-							{
-								std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for trie_node in indexdb.cpp" << std::endl;
-								exit(EXIT_FAILURE);
-							}
-							memset(lookup_table[kmer_key_short_r].trie_R, 0, 4 * sizeof(NodeElement));
-						}
+				index_parts_stats_vec.push_back(thispart);
+				part_num++;
+				continue;
+			}
 
-						insert_prefix(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp);
-					}
+			// table storing occurrence of each 9-mer and pointers to
+			// the forward and reverse burst tries
+			kmer *lookup_table = (kmer*)malloc((1 << opts.seed_win_len) * sizeof(kmer));
+			if (lookup_table == NULL)
+			{
+				ss.str("");
+				ss << STAMP << "Could not allocate memory for 9-mer look-up table";
+				ERR(ss.str());
+				exit(EXIT_FAILURE);
+			}
 
-					// shift 19-mer window and both 9-mers
-					if (j != numwin - 1)
-					{
-						for (uint32_t shift = 0; shift < opts.interval; shift++)
-						{
-							((kmer_key_short_f <<= 2) &= mask32) |= (int)*kmer_key_short_f_p++;
-							((kmer_key_short_r <<= 2) &= mask32) |= (int)*kmer_key_short_r_p++;
-							((kmer_key <<= 2) &= mask64) |= (int)*kmer_key_ptr++;
-							kmer_key_short_r_rp--;
-							index_pos++;
-						}
-					}
-				}//~for all 19-mers on the sequence
+			memset(lookup_table, 0, (1 << opts.seed_win_len) * sizeof(kmer));
 
-				delete[] myseq;
-				delete[] myseqr;
+			// number of the first 19-mer window of each sequence counting from the start of the part
+			std::vector<uint64_t> win_offsets(part_seqs.size(), 0);
+			for (size_t k = 1; k < part_seqs.size(); ++k)
+				win_offsets[k] = win_offsets[k - 1] 
+					+ (part_seqs[k - 1].empty() ? 0 : (part_seqs[k - 1].size() - pread_gv + opts.interval) / opts.interval);
 
-			} while (nt != EOF); // end of reads file
+			// build the burst tries in parallel. Each thread builds the tries of own L/2-mers
+			std::vector<std::vector<uint64_t>> shard_keys(num_build_thread);
+			for (uint32_t shard = 0; shard < num_build_thread; ++shard)
+			{
+				tpool.addJob([&, shard]() {
+					build_tries_shard(lookup_table, part_seqs, part_seqs_r, win_offsets, shard, num_build_thread, 
+						opts, shard_keys[shard]);
+				});
+			}
+			tpool.waitAll();
 
 			TIME(end);
 
 			// no index can be created, all reference sequences are too large to fit alone into maximum memory
-			if (index_size == 0)
+			if (numseq_part == 0)
 			{
 				DBG(opts.is_verbose, "\n  %sERROR%s: no index was created, all of your sequences are "
 					"too large to be indexed with the current memory limit of %e Mbytes.\n",
 					RED, COLOFF, opts.max_file_size);
 				break;
 			}
-			// continue to build hash and positions tables
-			else index_size = 0;
-
-			rewind(keys);
 
 			DBG(opts.is_verbose, " done  [%f sec]\n", (end - start));
 
-			// 4. build MPHF on the unique 18-mers
-			DBG(opts.is_verbose, "    (2/3) building CMPH hash ..");
+			// 4. assign the ids to the unique 18-mers in the order they occur in the reference file.
+			//    The order does not depend on the number of threads i.e. the index is always the same.
+			DBG(opts.is_verbose, "    (2/3) assigning 18-mer ids ..");
 			TIME(start);
-			cmph_t *hash = NULL;
 
-			FILE * keys_fd = keys;
-			if (keys_fd == NULL)
+			// part id for each shard local id
+			std::vector<std::vector<uint32_t>> shard_ids(num_build_thread);
 			{
-				std::cerr << "File '"<< keys_file << "' not found" << std::endl;
-				exit(EXIT_FAILURE);
-			}
-			cmph_io_adapter_t *source = cmph_io_nlfile_adapter(keys_fd);
+				// merge the shards on the window number of the 18-mer's first occurrence [window number, shard]
+				std::priority_queue<std::pair<uint64_t, uint32_t>, 
+					std::vector<std::pair<uint64_t, uint32_t>>, std::greater<std::pair<uint64_t, uint32_t>>> heads;
+				std::vector<size_t> next(num_build_thread, 0);
+				for (uint32_t shard = 0; shard < num_build_thread; ++shard)
+				{
+					shard_ids[shard].resize(shard_keys[shard].size());
+					if (!shard_keys[shard].empty())
+						heads.push(std::make_pair(shard_keys[shard][0], shard));
+				}
 
-			cmph_config_t *config = cmph_config_new(source);
-			cmph_config_set_algo(config, CMPH_CHM);
-			hash = cmph_new(config);
-			cmph_config_destroy(config);
+				while (!heads.empty())
+				{
+					uint32_t shard = heads.top().second;
+					heads.pop();
+					shard_ids[shard][next[shard]++] = number_elements++;
+					if (next[shard] < shard_keys[shard].size())
+						heads.push(std::make_pair(shard_keys[shard][next[shard]], shard));
+				}
+				std::vector<std::vector<uint64_t>>().swap(shard_keys);
+			}
 
-			// Destroy file adapter
-			cmph_io_nlfile_adapter_destroy(source);
-			fclose(keys_fd);
+			for (uint32_t shard = 0; shard < num_build_thread; ++shard)
+			{
+				tpool.addJob([&, shard]() { remap_ids_shard(lookup_table, shard_ids[shard], shard, num_build_thread, opts); });
+			}
+			tpool.waitAll();
+			std::vector<std::vector<uint32_t>>().swap(shard_ids);
 
 			TIME(end);
 
 			DBG(opts.is_verbose, " done  [%f sec]\n", (end - start));
 
-			int ret = remove(keys_file.c_str());
-			if (ret != 0)
-			{
-				ss.str("");
-				ss << STAMP << "Could not delete temporary file " << keys_file;
-				WARN(ss.str());
-			}
-
-			// 5. add ids to burst trie
-			// 6. build the positions lookup table using MPHF
+			// 5. add ids to the reverse burst tries
+			// 6. build the positions lookup table
 
 			DBG(opts.is_verbose, "    (3/3) building position lookup tables ..");
 
@@ -1619,7 +2443,7 @@ int build_index(Runopts &opts)
 			kmer_origin* positions_tbl = NULL;
 
 			positions_tbl = (kmer_origin*)malloc(number_elements * sizeof(kmer_origin));
-			if (positions_tbl == NULL)
+			if (positions_tbl == NULL && number_elements > 0)
 			{
 				std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for positions_tbl (main(), indexdb.cpp)" << std::endl;
 				exit(EXIT_FAILURE);
@@ -1627,145 +2451,30 @@ int build_index(Runopts &opts)
 
 			memset(positions_tbl, 0, number_elements * sizeof(kmer_origin));
 
-			// sequence number
-			uint32_t i = 0;
-
-			// reset the file pointer to the beginning of the current part
-			fseek(fp, start_part, SEEK_SET);
-
+			// set the ids and fill the positions table in parallel. Each thread processes own L/2-mers
 			TIME(start);
-			do
+			for (uint32_t shard = 0; shard < num_build_thread; ++shard)
 			{
-				long int start_seq = ftell(fp);
-				nt = fgetc(fp);
-
-				//cout << ">"; //TESTING2
-
-				// scan to end of header name
-				while (nt != '\n')
-				{
-					nt = fgetc(fp);
-					// if ( nt != '\n' ) cout << (char)nt; //TESTING
-				}
-
-				unsigned char* myseq = new unsigned char[maxlen];
-				unsigned char* myseqr = new unsigned char[maxlen];
-				uint32_t _j = 0;
-				len = 0;
-
-				// encode each sequence using integer alphabet {0,1,2,3}
-				nt = fgetc(fp);
-				while (nt != '>' && nt != EOF)
-				{
-					// skip line feed, carriage return or empty space in the sequence
-					if (nt != '\n' && nt != ' ')
-					{
-						len++;
-						// exact character
-						myseq[_j++] = map_nt[nt];
-					}
-					nt = fgetc(fp);
-				}
-
-				// put back the >
-				if (nt != EOF) ungetc(nt, fp);
-
-				// check the addition of this sequence will not overflow the maximum memory
-				double estimated_seq_mem = (len - pread_gv + 1)*9.5e-6;
-
-				// the sequence alone is too large, it will not fit into maximum memory, skip it
-				if (estimated_seq_mem > opts.max_file_size) continue;
-				// the additional sequence will overflow the maximum index memory,
-				// write existing index to disk and start a new index
-				else if (index_size + estimated_seq_mem > opts.max_file_size)
-				{
-					// set the character to something other than EOF
-					if (nt == EOF) nt = 'A';
-
-					// scan back to start of sequence for next index part
-					fseek(fp, start_seq, SEEK_SET);
-					break;
-				}
-				// add the additional sequence to the index
-				else
-				{
-					index_size += estimated_seq_mem;
-				}
-
-				// create a reverse sequence using the forward
-				unsigned char* ptr = &myseq[len - 1];
-
-				for (_j = 0; _j < len; _j++) myseqr[_j] = *ptr--;
-
-				uint32_t kmer_key_short_f = 0;
-				uint32_t kmer_key_short_r = 0;
-				unsigned char* kmer_key_short_f_p = &myseq[0];
-				unsigned char* kmer_key_short_r_p = &myseq[partialwin_gv + 1];
-				unsigned char* kmer_key_short_r_rp = &myseqr[len - partialwin_gv - 1];
-				unsigned long long int kmer_key = 0;
-				unsigned char* kmer_key_ptr = &myseq[0];
-
-				// initialize the 9-mers
-				for (uint32_t j = 0; j < partialwin_gv; j++)
-				{
-					(kmer_key_short_f <<= 2) |= (int)*kmer_key_short_f_p++;
-					(kmer_key_short_r <<= 2) |= (int)*kmer_key_short_r_p++;
-				}
-
-				// initialize the 19-mer
-				for (uint32_t j = 0; j < pread_gv; j++)
-					(kmer_key <<= 2) |= (int)*kmer_key_ptr++;
-
-				uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval; //TESTING
-				uint32_t id = 0;
-
-				uint32_t index_pos = 0; //TESTING
-
-				// for all 19-mers on the sequence
-				for (uint32_t j = 0; j < numwin; j++) //TESTING
-				{
-					// character array to hold an unsigned long long integer for CMPH
-					char a[38] = { 0 };
-					sprintf(a, "%llu", (kmer_key >> 2));
-					const char *key = a;
-					id = cmph_search(hash, key, (cmph_uint32)strlen(key));
-
-					//cout << "\t" << id << "=" << (kmer_key>>2); //TESTING
-
-					add_id_to_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, id);
-					add_id_to_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, id);
-
-					add_kmer_to_table(positions_tbl + id, i, index_pos, opts.max_pos);
-
-					// shift the 19-mer and 9-mers
-					if (j != numwin - 1)
-					{
-						for (uint32_t shift = 0; shift < opts.interval; shift++)
-						{
-							((kmer_key_short_f <<= 2) &= mask32) |= (int)*kmer_key_short_f_p++;
-							((kmer_key_short_r <<= 2) &= mask32) |= (int)*kmer_key_short_r_p++;
-							((kmer_key <<= 2) &= mask64) |= (int)*kmer_key_ptr++;
-							kmer_key_short_r_rp--;
-							index_pos++;
-						}
-					}
-				} 
-
-				delete[] myseq;
-				delete[] myseqr;
-
-				// next sequence
-				i++;
+				tpool.addJob([&, shard]() {
+					fill_positions_shard(lookup_table, positions_tbl, part_seqs, part_seqs_r, shard, num_build_thread, opts);
+				});
+			}
+			tpool.waitAll();
 
-			} while (nt != EOF); // for all file     
+			// the minimizers of the part (see MinimizerIndex)
+			std::vector<std::vector<std::pair<uint64_t, uint32_t>>> minimizers(opts.minimizer_w > 0 ? num_build_thread : 0);
+			for (uint32_t shard = 0; shard < minimizers.size(); ++shard)
+			{
+				tpool.addJob([&, shard]() {
+					collect_minimizers_shard(lookup_table, part_seqs, shard, num_build_thread, opts, minimizers[shard]);
+				});
+			}
+			tpool.waitAll();
 
 			TIME(end);
 			DBG(opts.is_verbose, " done [%f sec]\n", (end - start));
 
-			DBG(opts.is_verbose, "    total number of sequences in this part = %d\n", i);
-
-			// Destroy hash
-			cmph_destroy(hash);
+			DBG(opts.is_verbose, "    total number of sequences in this part = %d\n", (uint32_t)part_seqs.size());
 
 			// *********** Check ID's in Burst trie are correct *****
 
@@ -1945,64 +2654,75 @@ int build_index(Runopts &opts)
 
 		  // Load constructed index part to binary file
 
-			// covert part number into a string
-			ss.str("");
-			ss << part_num;
-			std::string part_str = ss.str();
+			DBG(opts.is_verbose, "      writing kmer data to %s\n", kmer_file.data());
+			DBG(opts.is_verbose, "      writing burst tries to %s\n", btrie_file.data());
+			DBG(opts.is_verbose, "      writing position lookup table to %s\n", pos_file.data());
+			if (opts.minimizer_w > 0)
+				DBG(opts.is_verbose, "      writing minimizers to %s\n", MinimizerIndex::file_name(idxpair.second, part_num).data());
 
-			// 1. load the kmer 'count' variable /index/kmer.dat
-			std::string idx_file = idxpair.second + ".kmer_" + part_str + ".dat";
-			std::ofstream oskmer(idx_file, std::ios::binary);
-			if (!oskmer.is_open())
-			{
-				ss.str("");
-				ss << STAMP << "Failed to open file: " << idx_file << " for writing. Error: " << strerror(errno);
-				ERR(ss.str());
-				exit(1);
-			}
+			index_parts_stats_vec.push_back(thispart);
 
-			DBG(opts.is_verbose, "      temporary file was here: %s\n", keys_file.data());
-			DBG(opts.is_verbose, "      writing kmer data to %s\n", idx_file.data());
+			// the part files are independent - write them concurrently
 
-			index_parts_stats thispart;
-			thispart.start_part = start_part;
-			thispart.seq_part_size = seq_part_size;
-			thispart.numseq_part = numseq_part;
-			index_parts_stats_vec.push_back(thispart);
+			// 1. load the kmer 'count' variable /index/kmer.dat
+			tpool.addJob([&]() {
+				std::ofstream oskmer(kmer_file, std::ios::binary);
+				if (!oskmer.is_open())
+				{
+					std::stringstream ess;
+					ess << STAMP << "Failed to open file: " << kmer_file << " for writing. Error: " << strerror(errno);
+					ERR(ess.str());
+					exit(1);
+				}
 
-			// the 9-mer look up tables
-			for (uint32_t j = 0; j < (uint32_t)(1 << opts.seed_win_len); j++)
-			{
-				oskmer.write(reinterpret_cast<const char*>(&(lookup_table[j].count)),
-					sizeof(uint32_t));
-			}
-			oskmer.close();
+				// the 9-mer look up tables
+				for (uint32_t j = 0; j < (uint32_t)(1 << opts.seed_win_len); j++)
+				{
+					oskmer.write(reinterpret_cast<const char*>(&(lookup_table[j].count)),
+						sizeof(uint32_t));
+				}
+				oskmer.close();
+			});
 
 			// 2. mini-burst tries
 			// load 9-mer look-up table and mini-burst tries to /index/bursttrief.dat
-			ss.str("");
-			idx_file = idxpair.second + ".bursttrie_" + part_str + ".dat";
-			ss << std::endl << "      writing burst tries to " << idx_file << std::endl;
-			DBG(opts.is_verbose, ss.str().data());
-
-			load_index(lookup_table, (char*)idx_file.data(), opts);
+			tpool.addJob([&]() { load_index(lookup_table, (char*)btrie_file.data(), opts, offsets); });
 
 			// 3. 19-mer position look up tables
-			idx_file = idxpair.second + ".pos_" + part_str + ".dat";
-			std::ofstream ospos(idx_file, std::ios::binary);
+			tpool.addJob([&]() {
+				std::ofstream ospos(pos_file, std::ios::binary);
 
-			DBG(opts.is_verbose, "      writing position lookup table to %s\n", idx_file.data());
+				// number of unique 19-mers
+				ospos.write(reinterpret_cast<const char*>(&number_elements), sizeof(uint32_t));
+				// the positions
+				for (uint32_t j = 0; j < number_elements; j++)
+				{
+					if (j % PartOffsets::STRIDE == 0)
+						offsets.pos.push_back(ospos.tellp());
+					uint32_t size = positions_tbl[j].size;
+					ospos.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+					ospos.write(reinterpret_cast<const char*>(positions_tbl[j].arr), sizeof(seq_pos)*size);
+					hist.add(size);
+				}
+				offsets.pos.push_back(ospos.tellp());
+				ospos.close();
+			});
 
-			// number of unique 19-mers
-			ospos.write(reinterpret_cast<const char*>(&number_elements), sizeof(uint32_t));
-			// the positions
-			for (uint32_t j = 0; j < number_elements; j++)
+			// 4. minimizers
+			if (opts.minimizer_w > 0)
 			{
-				uint32_t size = positions_tbl[j].size;
-				ospos.write(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
-				ospos.write(reinterpret_cast<const char*>(positions_tbl[j].arr), sizeof(seq_pos)*size);
+				tpool.addJob([&]() {
+					std::vector<std::pair<uint64_t, uint32_t>> entries;
+					for (auto & shard_entries : minimizers)
+					{
+						entries.insert(entries.end(), shard_entries.begin(), shard_entries.end());
+						std::vector<std::pair<uint64_t, uint32_t>>().swap(shard_entries);
+					}
+					MinimizerIndex::write(MinimizerIndex::file_name(idxpair.second, part_num), opts.seed_win_len, opts.minimizer_w, entries);
+				});
 			}
-			ospos.close();
+			tpool.waitAll();
+			offsets.write(offsets_file);
 
 			// Free malloc'd memory
 			// Table of unique 19-mer positions
@@ -2090,6 +2810,26 @@ int build_index(Runopts &opts)
 				// the length of the sequence itself
 				stats.write(reinterpret_cast<const char*>(&(samheader.second)), sizeof(uint32_t));
 			}
+
+			// encoding of the positions in the loaded index: 1 - bit-packed (see IndexImageHeader)
+			uint32_t packed_pos = opts.is_packed_pos ? 1 : 0;
+			stats.write(reinterpret_cast<const char*>(&packed_pos), sizeof(uint32_t));
+
+			// the (L+1)-mers with more positions than the threshold are masked in the seed search (see alignmentCb)
+			uint32_t max_occur = opts.mask_frac > 0 ? hist.threshold(opts.mask_frac) : 0;
+			hist.write(stats, max_occur);
+			if (max_occur > 0)
+			{
+				uint64_t num_masked = 0;
+				for (auto it = hist.counts.upper_bound(max_occur); it != hist.counts.end(); ++it)
+					num_masked += it->second;
+				DBG(opts.is_verbose, "    masking the %llu (L+1)-mers with more than %u positions\n", 
+					(unsigned long long)num_masked, max_occur);
+			}
+
+			// hash of the indexed reference file, checked when the sequences appended to it are indexed
+			ref_hash = ref_file_hash(fp, filesize);
+			stats.write(reinterpret_cast<const char*>(&ref_hash), sizeof(uint64_t));
 			stats.close();
 
 			DBG(opts.is_verbose, "    done.\n\n");
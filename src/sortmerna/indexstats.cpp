@@ -0,0 +1,391 @@
+/**
+ * FILE: indexstats.cpp
+ * Created: Oct 18, 2026 Sun
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "indexstats.hpp"
+#include "index.hpp"
+#include "options.hpp"
+#include "common.hpp"
+
+// forward
+void read_index_layout(const std::string & stats_file, uint32_t & lnwin, uint16_t & num_parts, bool & is_packed); // index.cpp
+
+typedef rapidjson::PrettyWriter<rapidjson::StringBuffer> JsonWriter;
+
+void Log2Hist::add(uint64_t val, uint64_t times)
+{
+	uint32_t bin = 0;
+	for (uint64_t v = val; v > 1; v >>= 1)
+		++bin;
+	if (bins.size() <= bin)
+		bins.resize(bin + 1, 0);
+	bins[bin] += times;
+	num += times;
+	sum += val * times;
+	max = std::max(max, val);
+} // ~Log2Hist::add
+
+void IndexPartStats::collect(Index & index, uint32_t lnwin)
+{
+	const char NT[4] = { 'A', 'C', 'G', 'T' };
+	this->lnwin = lnwin;
+	partialwin = lnwin / 2;
+
+	// image sections
+	const IndexImageHeader* hdr = index.header();
+	bytes_image = hdr->size;
+	bytes_header = sizeof(IndexImageHeader);
+	bytes_lookup = hdr->tries_off - hdr->lookup_off;
+	bytes_tries = hdr->positions_off - hdr->tries_off;
+	bytes_positions = hdr->pool_off - hdr->positions_off;
+	bytes_pool = hdr->size - hdr->pool_off;
+
+	// look-up table
+	for (uint32_t kmer = 0; kmer < index.lookup_size; ++kmer)
+	{
+		if (index.lookup_tbl[kmer].count > 0)
+		{
+			++kmers_used;
+			kmer_count.add(index.lookup_tbl[kmer].count);
+		}
+		if (index.lookup_tbl[kmer].trie_F != NO_TRIE) ++kmers_trie_F;
+		if (index.lookup_tbl[kmer].trie_R != NO_TRIE) ++kmers_trie_R;
+	}
+
+	// positions lists
+	std::vector<uint32_t> lens(index.number_elements);
+	for (uint32_t id = 0; id < index.number_elements; ++id)
+	{
+		lens[id] = index.num_positions(id);
+		positions.add(lens[id]);
+	}
+
+	for (uint32_t threshold = 10; threshold <= 100000; threshold *= 10)
+	{
+		uint64_t num_over = 0;
+		uint64_t pos_over = 0;
+		for (auto len : lens)
+		{
+			if (len > threshold)
+			{
+				++num_over;
+				pos_over += len;
+			}
+		}
+		over.push_back({ threshold, { num_over, pos_over } });
+	}
+
+	std::vector<uint32_t> ids(lens.size());
+	for (uint32_t id = 0; id < ids.size(); ++id)
+		ids[id] = id;
+	uint32_t num_top = std::min<uint32_t>(NUM_TOP, (uint32_t)ids.size());
+	std::partial_sort(ids.begin(), ids.begin() + num_top, ids.end(),
+		[&lens](uint32_t a, uint32_t b) { return lens[a] > lens[b] || (lens[a] == lens[b] && a < b); });
+	for (uint32_t i = 0; i < num_top; ++i)
+		seeds[ids[i]] = "";
+
+	std::vector<uint32_t> sorted(lens);
+	for (double q : { 0.5, 0.9, 0.99, 0.999 })
+	{
+		if (sorted.empty()) break;
+		auto nth = sorted.begin() + (size_t)(q * (sorted.size() - 1));
+		std::nth_element(sorted.begin(), nth, sorted.end());
+		quantiles.push_back({ q, *nth });
+	}
+
+	// mini burst tries, forward and reverse. The seeds of the top ids are spelled from the forward tries only:
+	// each id is in both tries, and the path of a reverse trie is the (L+1)-mer read backwards (see walk)
+	std::string path;
+	for (uint32_t kmer = 0; kmer < index.lookup_size; ++kmer)
+	{
+		path.clear();
+		for (int i = partialwin - 1; i >= 0; --i)
+			path.push_back(NT[(kmer >> (2 * i)) & 3]);
+
+		TrieNode* trie = index.trie_F(kmer);
+		if (trie != nullptr)
+		{
+			++num_tries;
+			walk(trie, trie, 0, path, true);
+		}
+		trie = index.trie_R(kmer);
+		if (trie != nullptr)
+		{
+			++num_tries;
+			walk(trie, trie, 0, path, false);
+		}
+	}
+
+	for (uint32_t i = 0; i < num_top; ++i)
+		top.push_back({ seeds[ids[i]], lens[ids[i]] });
+} // ~IndexPartStats::collect
+
+/**
+ * visit the trie nodes and the buckets of a mini burst trie
+ *
+ * @param depth trie node depth, root = 0
+ * @param path  the L/2-mer and the nucleotides of the trie nodes on the path to 'node'
+ */
+void IndexPartStats::walk(TrieNode* node, TrieNode* root, uint32_t depth, std::string & path, bool is_forward)
+{
+	const char NT[4] = { 'A', 'C', 'G', 'T' };
+	++trie_nodes;
+	bytes_trie_nodes += 4 * sizeof(TrieNode);
+
+	for (uint32_t i = 0; i < 4; ++i, ++node)
+	{
+		if (node->flag == 1)
+		{
+			path.push_back(NT[i]);
+			walk(node->trie(root), root, depth + 1, path, is_forward);
+			path.pop_back();
+		}
+		else if (node->flag == 2)
+		{
+			uint32_t num_entries = node->size / ENTRYSIZE;
+			++buckets;
+			bucket_entries += num_entries;
+			bucket_depth[depth + 1] += 1;
+			entry_depth[depth + 1] += num_entries;
+			bucket_size.add(num_entries);
+			bytes_buckets += node->size;
+
+			if (!is_forward) continue; // the same ids as in the forward tries
+
+			// the bucket entry: the rest of the (L+1)-mer (2 bits per nt, first nt in the lowest bits), id
+			uint32_t* entry = reinterpret_cast<uint32_t*>(node->bucket(root));
+			for (uint32_t e = 0; e < num_entries; ++e, entry += 2)
+			{
+				auto seed = seeds.find(entry[1]);
+				if (seed == seeds.end() || !seed->second.empty()) continue;
+				std::string kmer = path + NT[i];
+				for (uint32_t j = 0, str = entry[0]; j < partialwin - depth; ++j, str >>= 2)
+					kmer.push_back(NT[str & 3]);
+				seed->second = kmer.substr(0, lnwin); // the id is that of the L-mer prefix
+			}
+		}
+	}
+} // ~IndexPartStats::walk
+
+static void write_hist(JsonWriter & writer, Log2Hist & hist)
+{
+	writer.StartObject();
+	writer.Key("num");
+	writer.Uint64(hist.num);
+	writer.Key("max");
+	writer.Uint64(hist.max);
+	writer.Key("mean");
+	writer.Double(hist.num > 0 ? (double)hist.sum / hist.num : 0);
+	writer.Key("bins");
+	writer.StartArray();
+	for (uint32_t bin = 0; bin < hist.bins.size(); ++bin)
+	{
+		if (hist.bins[bin] == 0) continue;
+		writer.StartObject();
+		writer.Key("min");
+		writer.Uint64(bin == 0 ? 0 : 1ULL << bin);
+		writer.Key("max");
+		writer.Uint64((2ULL << bin) - 1);
+		writer.Key("count");
+		writer.Uint64(hist.bins[bin]);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+} // ~write_hist
+
+static void write_depths(JsonWriter & writer, std::map<uint32_t, uint64_t> & depths)
+{
+	writer.StartArray();
+	for (auto const& depth : depths)
+	{
+		writer.StartObject();
+		writer.Key("depth");
+		writer.Uint(depth.first);
+		writer.Key("count");
+		writer.Uint64(depth.second);
+		writer.EndObject();
+	}
+	writer.EndArray();
+} // ~write_depths
+
+static void write_part(JsonWriter & writer, IndexPartStats & stats, uint32_t idx_part, uint32_t number_elements)
+{
+	writer.StartObject();
+	writer.Key("part");
+	writer.Uint(idx_part);
+
+	writer.Key("lookup");
+	writer.StartObject();
+	writer.Key("kmers_used");
+	writer.Uint64(stats.kmers_used);
+	writer.Key("kmers_trie_forward");
+	writer.Uint64(stats.kmers_trie_F);
+	writer.Key("kmers_trie_reverse");
+	writer.Uint64(stats.kmers_trie_R);
+	writer.Key("count");
+	write_hist(writer, stats.kmer_count);
+	writer.EndObject();
+
+	writer.Key("tries");
+	writer.StartObject();
+	writer.Key("tries");
+	writer.Uint64(stats.num_tries);
+	writer.Key("trie_nodes");
+	writer.Uint64(stats.trie_nodes);
+	writer.Key("buckets");
+	writer.Uint64(stats.buckets);
+	writer.Key("bucket_entries");
+	writer.Uint64(stats.bucket_entries);
+	writer.Key("bucket_depth");
+	write_depths(writer, stats.bucket_depth);
+	writer.Key("entry_depth");
+	write_depths(writer, stats.entry_depth);
+	writer.Key("bucket_size");
+	write_hist(writer, stats.bucket_size);
+	writer.EndObject();
+
+	writer.Key("positions");
+	writer.StartObject();
+	writer.Key("kmers");
+	writer.Uint(number_elements);
+	writer.Key("length");
+	write_hist(writer, stats.positions);
+	writer.Key("quantiles");
+	writer.StartArray();
+	for (auto const& q : stats.quantiles)
+	{
+		writer.StartObject();
+		writer.Key("q");
+		writer.Double(q.first);
+		writer.Key("length");
+		writer.Uint(q.second);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.Key("over");
+	writer.StartArray();
+	for (auto const& over : stats.over)
+	{
+		writer.StartObject();
+		writer.Key("length");
+		writer.Uint(over.first);
+		writer.Key("kmers");
+		writer.Uint64(over.second.first);
+		writer.Key("positions");
+		writer.Uint64(over.second.second);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.Key("top");
+	writer.StartArray();
+	for (auto const& top : stats.top)
+	{
+		writer.StartObject();
+		writer.Key("seed");
+		writer.String(top.first.data(), (rapidjson::SizeType)top.first.size());
+		writer.Key("positions");
+		writer.Uint(top.second);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	writer.Key("bytes");
+	writer.StartObject();
+	writer.Key("image");
+	writer.Uint64(stats.bytes_image);
+	writer.Key("header");
+	writer.Uint64(stats.bytes_header);
+	writer.Key("lookup");
+	writer.Uint64(stats.bytes_lookup);
+	writer.Key("tries");
+	writer.Uint64(stats.bytes_tries);
+	writer.Key("trie_nodes");
+	writer.Uint64(stats.bytes_trie_nodes);
+	writer.Key("buckets");
+	writer.Uint64(stats.bytes_buckets);
+	writer.Key("positions_table");
+	writer.Uint64(stats.bytes_positions);
+	writer.Key("positions_pool");
+	writer.Uint64(stats.bytes_pool);
+	writer.Key("pool_per_position");
+	writer.Double(stats.positions.sum > 0 ? (double)stats.bytes_pool / stats.positions.sum : 0);
+	writer.EndObject();
+
+	writer.EndObject();
+} // ~write_part
+
+/**
+ * load each part of each index, and write their statistics into Runopts::index_stats_file
+ */
+void index_stats(Runopts & opts, Index & index)
+{
+	std::stringstream ss;
+	rapidjson::StringBuffer sbuf;
+	JsonWriter writer(sbuf);
+
+	writer.StartObject();
+	writer.Key("indexes");
+	writer.StartArray();
+	for (uint32_t idx_num = 0; idx_num < opts.indexfiles.size(); ++idx_num)
+	{
+		uint32_t lnwin = 0;
+		uint16_t num_parts = 0;
+		bool is_packed = false;
+		read_index_layout(opts.indexfiles[idx_num].second + ".stats", lnwin, num_parts, is_packed);
+
+		writer.StartObject();
+		writer.Key("reference");
+		writer.String(opts.indexfiles[idx_num].first.data(), (rapidjson::SizeType)opts.indexfiles[idx_num].first.size());
+		writer.Key("index");
+		writer.String(opts.indexfiles[idx_num].second.data(), (rapidjson::SizeType)opts.indexfiles[idx_num].second.size());
+		writer.Key("seed_length");
+		writer.Uint(lnwin);
+		writer.Key("packed_positions");
+		writer.Bool(is_packed);
+		writer.Key("parts");
+		writer.StartArray();
+		for (uint16_t idx_part = 0; idx_part < num_parts; ++idx_part)
+		{
+			ss.str("");
+			ss << STAMP << "Collecting the statistics of the index part [" << opts.indexfiles[idx_num].second
+				<< "_" << idx_part << "]" << std::endl;
+			std::cout << ss.str();
+
+			index.load(idx_num, idx_part, opts, lnwin);
+			IndexPartStats stats;
+			stats.collect(index, lnwin);
+			write_part(writer, stats, idx_part, index.number_elements);
+			index.clear();
+		}
+		writer.EndArray();
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	std::ofstream ofs(opts.index_stats_file, std::ios::binary);
+	if (!ofs.is_open())
+	{
+		ss.str("");
+		ss << STAMP << "Failed to open file [" << opts.index_stats_file << "] for writing: " << strerror(errno);
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	ofs << sbuf.GetString() << std::endl;
+
+	ss.str("");
+	ss << STAMP << "Index statistics written into [" << opts.index_stats_file.generic_string() << "]" << std::endl;
+	std::cout << ss.str();
+} // ~index_stats
@@ -5,11 +5,15 @@
  */
 #include "kvdb.hpp"
 #include "common.hpp"
+#include "rocksdb/write_batch.h"
 
 #include <iostream>
+#include <sstream>
 #include <filesystem>
+#include <algorithm>
 
-KeyValueDatabase::KeyValueDatabase(std::string const &kvdbPath) 
+KeyValueDatabase::KeyValueDatabase(std::string const &kvdbPath, std::string const &run)
+	: kvdb(nullptr), run_name(run), run_cf(nullptr)
 {
 	// init and open key-value database for read matches
 	options.IncreaseParallelism();
@@ -19,26 +23,128 @@ KeyValueDatabase::KeyValueDatabase(std::string const &kvdbPath)
 	options.compression = rocksdb::kZlibCompression;
 #endif
 	options.create_if_missing = true;
-	rocksdb::Status s = rocksdb::DB::Open(options, kvdbPath, &kvdb);
+
+	// all existing Column Families have to be opened. None exist if DB is new.
+	std::vector<std::string> cf_names;
+	rocksdb::Status s = rocksdb::DB::ListColumnFamilies(options, kvdbPath, &cf_names);
+	if (!s.ok() || cf_names.empty())
+		cf_names = { rocksdb::kDefaultColumnFamilyName };
+
+	std::vector<rocksdb::ColumnFamilyDescriptor> cf_descs;
+	for (auto const& name : cf_names)
+		cf_descs.push_back(rocksdb::ColumnFamilyDescriptor(name, rocksdb::ColumnFamilyOptions(options)));
+
+	s = rocksdb::DB::Open(options, kvdbPath, cf_descs, &cf_handles, &kvdb);
 	assert(s.ok());
+
+	if (open_run(run_name) != 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open KVDB Column Family [" << run_name << "] in " << kvdbPath << std::endl;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+} // ~KeyValueDatabase::KeyValueDatabase
+
+KeyValueDatabase::~KeyValueDatabase()
+{
+	for (auto handle : cf_handles)
+		kvdb->DestroyColumnFamilyHandle(handle);
+	delete kvdb;
 }
 
+/*
+ * find the Column Family for the given run among the opened ones, or create it
+ */
+int KeyValueDatabase::open_run(std::string const &run)
+{
+	std::string name = run.empty() ? rocksdb::kDefaultColumnFamilyName : run;
+	auto it = std::find_if(cf_handles.begin(), cf_handles.end(),
+		[&name](rocksdb::ColumnFamilyHandle* handle) { return handle->GetName() == name; });
+	if (it != cf_handles.end())
+	{
+		run_cf = *it;
+		return 0;
+	}
+
+	rocksdb::ColumnFamilyHandle* handle = nullptr;
+	rocksdb::Status s = kvdb->CreateColumnFamily(rocksdb::ColumnFamilyOptions(options), name, &handle);
+	if (!s.ok())
+		return 1;
+	cf_handles.push_back(handle);
+	run_cf = handle;
+	return 0;
+} // ~KeyValueDatabase::open_run
+
 /* 
- * Remove database files from the given location
+ * Remove all records of the current run. 
+ * The run's Column Family is dropped and re-created empty i.e. the cost does not depend on the number of records.
+ * The default Column Family cannot be dropped, and is cleared by deleting its records one by one.
+ * 'dbPath' is kept for compatibility, the DB opened by this object is cleared.
  */
 int KeyValueDatabase::clear(std::string dbpath)
 {
-	return 0;
+	if (run_cf->GetName() == rocksdb::kDefaultColumnFamilyName)
+	{
+		rocksdb::WriteBatch batch;
+		std::unique_ptr<rocksdb::Iterator> it(kvdb->NewIterator(rocksdb::ReadOptions(), run_cf));
+		for (it->SeekToFirst(); it->Valid(); it->Next())
+			batch.Delete(run_cf, it->key());
+		return kvdb->Write(rocksdb::WriteOptions(), &batch).ok() ? 0 : 1;
+	}
+
+	std::string name = run_cf->GetName();
+	if (drop(name) != 0)
+		return 1;
+	return open_run(name);
 } // ~KeyValueDatabase::clear
 
+/*
+ * Drop the Column Family of the given run. Used for removing the runs stored in a shared KVDB directory.
+ */
+int KeyValueDatabase::drop(std::string const &run)
+{
+	if (run.empty() || run == rocksdb::kDefaultColumnFamilyName)
+		return 1;
+
+	auto it = std::find_if(cf_handles.begin(), cf_handles.end(),
+		[&run](rocksdb::ColumnFamilyHandle* handle) { return handle->GetName() == run; });
+	if (it == cf_handles.end())
+		return 1;
+
+	rocksdb::Status s = kvdb->DropColumnFamily(*it);
+	if (!s.ok())
+		return 1;
+
+	if (*it == run_cf)
+		run_cf = nullptr;
+	kvdb->DestroyColumnFamilyHandle(*it);
+	cf_handles.erase(it);
+	return 0;
+} // ~KeyValueDatabase::drop
+
+/*
+ * names of all the runs stored in this DB
+ */
+std::vector<std::string> KeyValueDatabase::list_runs()
+{
+	std::vector<std::string> runs;
+	for (auto handle : cf_handles)
+	{
+		if (handle->GetName() != rocksdb::kDefaultColumnFamilyName)
+			runs.push_back(handle->GetName());
+	}
+	return runs;
+} // ~KeyValueDatabase::list_runs
+
 void KeyValueDatabase::put(std::string key, std::string val)
 {
-	rocksdb::Status s = kvdb->Put(rocksdb::WriteOptions(), key, val);
+	rocksdb::Status s = kvdb->Put(rocksdb::WriteOptions(), run_cf, key, val);
 }
 
 std::string KeyValueDatabase::get(std::string key)
 {
 	std::string val;
-	rocksdb::Status s = kvdb->Get(rocksdb::ReadOptions(), key, &val);
+	rocksdb::Status s = kvdb->Get(rocksdb::ReadOptions(), run_cf, key, &val);
 	return val;
-}
\ No newline at end of file
+}
@@ -42,6 +42,7 @@
 #include "kvdb.hpp"
 #include "index.hpp"
 #include "indexdb.hpp"
+#include "indexstats.hpp"
 
 namespace fs = std::filesystem;
 
@@ -63,7 +64,18 @@ int main(int argc, char** argv)
 	std::cout << STAMP << "Running command:\n" << opts.cmdline << std::endl;
 
 	Index index(opts); // reference index DB
-	KeyValueDatabase kvdb(opts.kvdbdir.string());
+
+	if (opts.is_index_host)
+	{
+		Index::host(opts);
+		return 0;
+	}
+	if (opts.is_index_stats)
+	{
+		index_stats(opts, index);
+		return 0;
+	}
+	KeyValueDatabase kvdb(opts.kvdbdir.string(), opts.run_fingerprint);
 
 	if (opts.is_cmd) {
 		CmdSession cmd;
@@ -71,6 +83,14 @@ int main(int argc, char** argv)
 	}
 	else
 	{
+		// new alignment - drop the records left by a previous run with the same fingerprint
+		if (opts.alirep == Runopts::ALIGN_REPORT::align 
+			|| opts.alirep == Runopts::ALIGN_REPORT::alipost 
+			|| opts.alirep == Runopts::ALIGN_REPORT::all)
+		{
+			kvdb.clear(opts.kvdbdir.string());
+		}
+
 		Readstats readstats(opts, kvdb);
 		Output output(opts, readstats);
 
@@ -0,0 +1,136 @@
+/**
+ * FILE: minimizer.cpp
+ * Created: Oct 18, 2026 Sun
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+
+#include "minimizer.hpp"
+#include "common.hpp"
+
+std::string MinimizerIndex::file_name(const std::string & idxpfx, uint32_t idx_part)
+{
+	return idxpfx + ".mini_" + std::to_string(idx_part) + ".dat";
+}
+
+/**
+ * Write the minimizers of an index part. The entries (code, id) are sorted and the duplicates removed.
+ * The ids of a code are those of the (L+1)-mers starting with the code.
+ */
+void MinimizerIndex::write(const std::string & file, uint32_t k, uint32_t w, std::vector<std::pair<uint64_t, uint32_t>> & entries)
+{
+	std::sort(entries.begin(), entries.end());
+	entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+	std::ofstream os(file, std::ios::binary);
+	if (!os.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open file: " << file << " for writing. Error: " << strerror(errno);
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	std::vector<uint64_t> codes;
+	std::vector<uint32_t> id_starts;
+	for (uint32_t i = 0; i < entries.size(); ++i)
+	{
+		if (codes.empty() || codes.back() != entries[i].first)
+		{
+			codes.push_back(entries[i].first);
+			id_starts.push_back(i);
+		}
+	}
+	id_starts.push_back((uint32_t)entries.size());
+
+	uint64_t num_codes = codes.size();
+	uint64_t num_ids = entries.size();
+	os.write(reinterpret_cast<const char*>(&k), sizeof(uint32_t));
+	os.write(reinterpret_cast<const char*>(&w), sizeof(uint32_t));
+	os.write(reinterpret_cast<const char*>(&num_codes), sizeof(uint64_t));
+	os.write(reinterpret_cast<const char*>(&num_ids), sizeof(uint64_t));
+	os.write(reinterpret_cast<const char*>(codes.data()), num_codes * sizeof(uint64_t));
+	os.write(reinterpret_cast<const char*>(id_starts.data()), id_starts.size() * sizeof(uint32_t));
+	for (auto const& entry : entries)
+		os.write(reinterpret_cast<const char*>(&entry.second), sizeof(uint32_t));
+} // ~MinimizerIndex::write
+
+/**
+ * Load the minimizers of an index part.
+ *
+ * @return false if the file does not exist, is truncated, is of an older format, or was built with another seed length
+ */
+bool MinimizerIndex::load(const std::string & file, uint32_t lnwin)
+{
+	clear();
+	std::ifstream is(file, std::ios::binary);
+	uint32_t file_k = 0;
+	uint32_t file_w = 0;
+	uint64_t num_codes = 0;
+	uint64_t num_ids = 0;
+	is.read(reinterpret_cast<char*>(&file_k), sizeof(uint32_t));
+	is.read(reinterpret_cast<char*>(&file_w), sizeof(uint32_t));
+	is.read(reinterpret_cast<char*>(&num_codes), sizeof(uint64_t));
+	is.read(reinterpret_cast<char*>(&num_ids), sizeof(uint64_t));
+	if (!is || file_k != lnwin || file_w == 0 || file_w > MAX_MINIMIZER_W || num_codes > num_ids || num_ids > UINT32_MAX)
+		return false;
+
+	// the size of the file tells the older format (codes and ids of the same number) from this one
+	std::error_code ec;
+	uint64_t size = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + num_codes * sizeof(uint64_t)
+		+ (num_codes + 1) * sizeof(uint32_t) + num_ids * sizeof(uint32_t);
+	if (std::filesystem::file_size(file, ec) != size || ec)
+		return false;
+
+	codes.resize(num_codes);
+	id_starts.resize(num_codes + 1);
+	ids.resize(num_ids);
+	is.read(reinterpret_cast<char*>(codes.data()), num_codes * sizeof(uint64_t));
+	is.read(reinterpret_cast<char*>(id_starts.data()), id_starts.size() * sizeof(uint32_t));
+	is.read(reinterpret_cast<char*>(ids.data()), num_ids * sizeof(uint32_t));
+	if (!is)
+	{
+		clear();
+		return false;
+	}
+
+	// the ranges of the codes on their top bits
+	uint32_t shift = 2 * file_k - DIR_BITS;
+	dir.assign((1U << DIR_BITS) + 1, 0);
+	for (auto code : codes)
+		++dir[(code >> shift) + 1];
+	for (size_t b = 1; b < dir.size(); ++b)
+		dir[b] += dir[b - 1];
+
+	k = file_k;
+	w = file_w;
+	return true;
+} // ~MinimizerIndex::load
+
+std::pair<const uint32_t*, const uint32_t*> MinimizerIndex::find(uint64_t code) const
+{
+	uint64_t b = code >> (2 * k - DIR_BITS);
+	auto first = codes.begin() + dir[b];
+	auto last = codes.begin() + dir[b + 1];
+	auto it = std::lower_bound(first, last, code);
+	if (it == last || *it != code)
+		return { nullptr, nullptr };
+	auto c = it - codes.begin();
+	return { ids.data() + id_starts[c], ids.data() + id_starts[c + 1] };
+} // ~MinimizerIndex::find
+
+void MinimizerIndex::clear()
+{
+	k = 0;
+	w = 0;
+	std::vector<uint64_t>().swap(codes);
+	std::vector<uint32_t>().swap(id_starts);
+	std::vector<uint32_t>().swap(ids);
+	std::vector<uint32_t>().swap(dir);
+} // ~MinimizerIndex::clear
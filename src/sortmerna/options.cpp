@@ -15,6 +15,8 @@
 #include "common.hpp"
 #include "gzip.hpp"
 #include "kvdb.hpp"
+#include "minimizer.hpp" // MAX_MINIMIZER_W
+#include "dedup.hpp" // DedupCache::NUM_SHARDS
 
  // standard
 #include <limits>
@@ -45,6 +47,7 @@ std::string get_user_home(); // util.cpp
 //bool dirExists(std::string dpath); // replaced with filesystem
 std::string trim_leading_dashes(std::string const& name); // util.cpp
 std::string get_basename(const std::string &file); // util.cpp
+std::string string_hash(const std::string &val); // util.cpp
 std::streampos filesize(const std::string &file); // util.cpp
 
 Runopts::Runopts(int argc, char**argv, bool dryrun)
@@ -1008,6 +1011,199 @@ void Runopts::opt_threp(const std::string &val)
 	}
 } // ~Runopts::opt_threads
 
+void Runopts::opt_huge_pages(const std::string &val)
+{
+	is_huge_pages = true;
+} // ~Runopts::opt_huge_pages
+
+void Runopts::opt_index_host(const std::string &val)
+{
+	is_index_host = true;
+	if (val.size() > 0)
+	{
+		int idle = std::stoi(val);
+		if (idle < 0)
+		{
+			std::stringstream ss;
+			ss << STAMP << "Option '" << OPT_INDEX_HOST << "' takes a positive number of seconds. Provided value: " << idle
+				<< " The index will be hosted until terminated.";
+			WARN(ss.str());
+		}
+		else
+		{
+			index_host_idle = idle;
+		}
+	}
+} // ~Runopts::opt_index_host
+
+void Runopts::opt_index_stats(const std::string &val)
+{
+	is_index_stats = true;
+	if (val.size() > 0)
+		index_stats_file = val;
+} // ~Runopts::opt_index_stats
+
+void Runopts::opt_seed_batch(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_SEED_BATCH << "' requires a number of reads e.g. 8, or 0 to disable the prefetching";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	int batch = std::stoi(val);
+	if (batch < 0)
+	{
+		ss << STAMP << "Option '" << OPT_SEED_BATCH << "' takes a non-negative number of reads. Provided value: " << batch
+			<< " Using default: " << seed_batch;
+		WARN(ss.str());
+	}
+	else
+	{
+		seed_batch = batch;
+	}
+} // ~Runopts::opt_seed_batch
+
+void Runopts::opt_reorder(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_REORDER << "' requires a number of reads e.g. 1024";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	int num_reads = std::stoi(val);
+	if (num_reads < 0)
+	{
+		ss << STAMP << "Option '" << OPT_REORDER << "' takes a non-negative number of reads. Provided value: " << num_reads
+			<< " The reads are searched in the file order.";
+		WARN(ss.str());
+	}
+	else
+	{
+		reorder = num_reads;
+	}
+} // ~Runopts::opt_reorder
+
+void Runopts::opt_seed_engine(const std::string &val)
+{
+	std::stringstream ss;
+	std::istringstream strm(val);
+	std::string tok;
+	while (std::getline(strm, tok, ','))
+	{
+		if (tok == "trie")
+			is_minimizer_seeds.push_back(false);
+		else if (tok == "minimizer")
+			is_minimizer_seeds.push_back(true);
+		else
+		{
+			ss << STAMP << "Option '" << OPT_SEED_ENGINE << "' takes a comma separated list of 'trie' or 'minimizer'."
+				<< " Provided value: " << val;
+			ERR(ss.str());
+			exit(EXIT_FAILURE);
+		}
+	}
+} // ~Runopts::opt_seed_engine
+
+void Runopts::opt_minimizer_w(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_MINIMIZER_W << "' requires a number of L-mers e.g. 10";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	int w = std::stoi(val);
+	if (w < 0 || w > (int)MAX_MINIMIZER_W)
+	{
+		ss << STAMP << "Option '" << OPT_MINIMIZER_W << "' takes a number of L-mers in the range [0, " << MAX_MINIMIZER_W
+			<< "]. Provided value: " << w;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	minimizer_w = w;
+} // ~Runopts::opt_minimizer_w
+
+void Runopts::opt_long_read(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_LONG_READ << "' requires a read length e.g. 2000";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	int len = std::stoi(val);
+	if (len < 0)
+	{
+		ss << STAMP << "Option '" << OPT_LONG_READ << "' takes a non-negative read length. Provided value: " << len;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	long_read = len;
+} // ~Runopts::opt_long_read
+
+void Runopts::opt_dedup_reads(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_DEDUP_READS << "' requires a number of sequences e.g. 1000000";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	int num = std::stoi(val);
+	if (num < 0)
+	{
+		ss << STAMP << "Option '" << OPT_DEDUP_READS << "' takes a non-negative number of sequences. Provided value: " << num;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	if (num > 0 && num < (int)DedupCache::NUM_SHARDS)
+	{
+		ss << STAMP << "Option '" << OPT_DEDUP_READS << "' takes 0 or at least " << DedupCache::NUM_SHARDS
+			<< " sequences (one per cache shard). Provided value: " << num;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	dedup_reads = num;
+} // ~Runopts::opt_dedup_reads
+
+void Runopts::opt_align_cache(const std::string &val)
+{
+	if (val.size() == 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Option '" << OPT_ALIGN_CACHE << "' requires a directory path";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	align_cache = std::filesystem::absolute(val).generic_string();
+} // ~Runopts::opt_align_cache
+
+void Runopts::opt_align_cache_size(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_ALIGN_CACHE_SIZE << "' requires a size in MB e.g. 1024";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	int size = std::stoi(val);
+	if (size < 1)
+	{
+		ss << STAMP << "Option '" << OPT_ALIGN_CACHE_SIZE << "' takes a positive size in MB. Provided value: " << size;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	align_cache_size = size;
+} // ~Runopts::opt_align_cache_size
+
 void Runopts::opt_dbg_put_db(const std::string &val)
 {
 	is_dbg_put_kvdb = true;
@@ -1204,6 +1400,85 @@ void Runopts::opt_max_pos(const std::string &val)
 	}
 }
 
+void Runopts::opt_max_ram(const std::string &val)
+{
+	std::stringstream ss;
+	auto count = mopt.count(OPT_MAX_RAM);
+	if (count > 1)
+	{
+		ss << " Option '" << OPT_MAX_RAM << "' entered [" << count << "] times. Only the last value will be used" << std::endl 
+			<< "\tHelp: " << help_max_ram;
+		WARN(ss.str());
+	}
+
+	if (val.size() == 0)
+	{
+		ss.str("");
+		ss << "Option '" << OPT_MAX_RAM << "' takes a positive number of Mbytes e.g. 1024. Using default: " << max_ram;
+		WARN(ss.str());
+	}
+	else
+	{
+		double max_ram_t = std::stod(val);
+		if (max_ram_t < 0)
+		{
+			ss.str("");
+			ss << STAMP << "Option '" << OPT_MAX_RAM << "' cannot be negative. Provided value: " << max_ram_t 
+				<< " Default will be used: " << max_ram;
+			WARN(ss.str());
+		}
+		else
+		{
+			max_ram = max_ram_t;
+		}
+	}
+} // ~Runopts::opt_max_ram
+
+void Runopts::opt_index_append(const std::string &val)
+{
+	is_index_append = true;
+} // ~Runopts::opt_index_append
+
+void Runopts::opt_packed_pos(const std::string &val)
+{
+	is_packed_pos = true;
+} // ~Runopts::opt_packed_pos
+
+void Runopts::opt_mask_frac(const std::string &val)
+{
+	std::stringstream ss;
+	if (val.size() == 0)
+	{
+		ss << STAMP << "Option '" << OPT_MASK_FRAC << "' requires a fraction e.g. 0.0002";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	mask_frac = std::stod(val);
+	if (mask_frac < 0 || mask_frac >= 1)
+	{
+		ss << STAMP << "Option '" << OPT_MASK_FRAC << "' takes a fraction in the range [0, 1). Provided value: " << mask_frac;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+} // ~Runopts::opt_mask_frac
+
+void Runopts::opt_dedup(const std::string &val)
+{
+	is_dedup = true;
+	if (val == "contained")
+	{
+		is_dedup_contained = true;
+	}
+	else if (val.size() > 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Option '" << OPT_DEDUP << "' takes no value or the value 'contained'. Provided value: " << val;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+} // ~Runopts::opt_dedup
+
 /* 
  * called from validate
  */
@@ -1233,6 +1508,9 @@ void Runopts::validate_idxdir() {
 			std::cout << STAMP << "IDX directory: " << std::filesystem::absolute(idxdir) << " exists and is not empty" << std::endl;
 		}
 	}
+
+	if (is_index_stats && index_stats_file.empty())
+		index_stats_file = idxdir / "index_stats.json";
 }
 
 /* 
@@ -1264,11 +1542,15 @@ void Runopts::validate_kvdbdir()
 		}
 		else // not empty
 		{
-			// TODO: Store some metadata in DB to verify the alignment.
-			// kvdb.verify()
-			if (ALIGN_REPORT::align == alirep || ALIGN_REPORT::all == alirep || ALIGN_REPORT::alipost == alirep)
+			// an existing KVDB can be shared between runs - each run uses own Column Family (see KeyValueDatabase)
+			bool is_kvdb = std::filesystem::exists(kvdbdir / "CURRENT");
+			if (is_kvdb)
+			{
+				std::cout << STAMP << "KVDB directory: " << std::filesystem::absolute(kvdbdir) 
+					<< " contains a Key-value database. Run records will be stored in a separate Column Family." << std::endl;
+			}
+			else if (ALIGN_REPORT::align == alirep || ALIGN_REPORT::all == alirep || ALIGN_REPORT::alipost == alirep)
 			{
-				// if (kvdb.verify()) // TODO
 				// output the listing
 				std::stringstream ss;
 				ss << STAMP << "Path: " << std::filesystem::absolute(kvdbdir) << " exists with the following content:" << std::endl;
@@ -1276,7 +1558,7 @@ void Runopts::validate_kvdbdir()
 				for (auto& subpath : std::filesystem::directory_iterator(kvdbdir))
 					ss << subpath.path().filename() << std::endl;
 
-				ss << "\tPlease, ensure the directory " << std::filesystem::absolute(kvdbdir) << " is Empty prior running 'sortmerna'" << std::endl;
+				ss << "\tPlease, ensure the directory " << std::filesystem::absolute(kvdbdir) << " is either Empty or a Key-value database prior running 'sortmerna'" << std::endl;
 				WARN(ss.str());
 				exit(EXIT_FAILURE);
 			}
@@ -1707,8 +1989,36 @@ void Runopts::validate()
 		if (is_otu_map) min_cov = 0.97;
 		else min_cov = 0;
 	}
+
+	set_run_fingerprint();
 } // ~Runopts::validate
 
+/*
+ * Fingerprint of the run - used as the name of the KVDB Column Family storing the run's records.
+ * Runs on the same reads and references using the same alignment options share the fingerprint
+ * i.e. the post-processing and reports find the records stored by the alignment.
+ * called from validate
+ */
+void Runopts::set_run_fingerprint()
+{
+	std::stringstream ss;
+	for (auto const& readsfile : readfiles)
+		ss << std::filesystem::absolute(readsfile).generic_string() << ";";
+	for (auto const& ref : indexfiles)
+		ss << std::filesystem::absolute(ref.first).generic_string() << ";";
+	ss << seed_win_len << ";" << is_forward << is_reverse << is_full_search << ";"
+		<< num_alignments << ";" << num_best_hits << ";" << min_lis << ";" << seed_hits << ";" << edges << ";"
+		<< match << ";" << mismatch << ";" << gap_open << ";" << gap_extension << ";" << score_N << ";"
+		<< evalue << ";" << minoccur;
+	// the seed engine and the long read length are only added if set, so the default runs keep their fingerprint
+	for (bool is_minimizer : is_minimizer_seeds)
+		ss << (is_minimizer ? ";minimizer" : ";trie");
+	if (long_read != LONG_READ_LEN)
+		ss << ";" << long_read;
+	run_fingerprint = "run_" + string_hash(ss.str());
+	std::cout << STAMP << "Run fingerprint: " << run_fingerprint << std::endl;
+} // ~Runopts::set_run_fingerprint
+
 /* 
  * human readable representation of the options
  */
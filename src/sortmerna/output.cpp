@@ -427,72 +427,81 @@ void Output::report_blast
 				read.calcMismatchGapId(refs, i, mismatches, gaps, id);
 				int32_t total_pos = mismatches + gaps + id;
 
-				blast_os << "\t";
-				// (2) Subject
-				blast_os << ref_id << "\t";
-				// (3) %id
-				blast_os.precision(3);
-				blast_os << (double)id / (mismatches + gaps + id) * 100 << "\t";
-				// (4) alignment length
-				blast_os << (read.hits_align_info.alignv[i].read_end1 - read.hits_align_info.alignv[i].read_begin1 + 1) << "\t";
-				// (5) mismatches
-				blast_os << mismatches << "\t";
-				// (6) gap openings
-				blast_os << gaps << "\t";
-				// (7) q.start
-				blast_os << read.hits_align_info.alignv[i].read_begin1 + 1 << "\t";
-				// (8) q.end
-				blast_os << read.hits_align_info.alignv[i].read_end1 + 1 << "\t";
-				// (9) s.start
-				blast_os << read.hits_align_info.alignv[i].ref_begin1 + 1 << "\t";
-				// (10) s.end
-				blast_os << read.hits_align_info.alignv[i].ref_end1 + 1 << "\t";
-				// (11) e-value
-				blast_os << evalue_score << "\t";
-				// (12) bit score
-				blast_os << bitscore;
-				// OPTIONAL columns
+				// (11) e-value, (12) bit score, OPTIONAL columns
+				std::stringstream tail;
+				tail.precision(3);
+				tail << evalue_score << "\t";
+				tail << bitscore;
 				for (uint32_t l = 0; l < opts.blastops.size(); l++)
 				{
 					// output CIGAR string
 					if (opts.blastops[l].compare("cigar") == 0)
 					{
-						blast_os << "\t";
+						tail << "\t";
 						// masked region at beginning of alignment
-						if (read.hits_align_info.alignv[i].read_begin1 != 0) blast_os << read.hits_align_info.alignv[i].read_begin1 << "S";
+						if (read.hits_align_info.alignv[i].read_begin1 != 0) tail << read.hits_align_info.alignv[i].read_begin1 << "S";
 						for (int c = 0; c < read.hits_align_info.alignv[i].cigar.size(); ++c)
 						{
 							uint32_t letter = 0xf & read.hits_align_info.alignv[i].cigar[c];
 							uint32_t length = (0xfffffff0 & read.hits_align_info.alignv[i].cigar[c]) >> 4;
-							blast_os << length;
-							if (letter == 0) blast_os << "M";
-							else if (letter == 1) blast_os << "I";
-							else blast_os << "D";
+							tail << length;
+							if (letter == 0) tail << "M";
+							else if (letter == 1) tail << "I";
+							else tail << "D";
 						}
 
 						auto end_mask = read.sequence.length() - read.hits_align_info.alignv[i].read_end1 - 1;
 						// output the masked region at end of alignment
-						if (end_mask > 0) blast_os << end_mask << "S";
+						if (end_mask > 0) tail << end_mask << "S";
 					}
 					// output % query coverage
 					else if (opts.blastops[l].compare("qcov") == 0)
 					{
-						blast_os << "\t";
-						blast_os.precision(3);
+						tail << "\t";
+						tail.precision(3);
 						double coverage = abs(read.hits_align_info.alignv[i].read_end1 - read.hits_align_info.alignv[i].read_begin1 + 1)
 							/ read.hits_align_info.alignv[i].readlen;
-						blast_os << coverage * 100; // (double)align_len / readlen
+						tail << coverage * 100; // (double)align_len / readlen
 					}
 					// output strand
 					else if (opts.blastops[l].compare("qstrand") == 0)
 					{
-						blast_os << "\t";
-						blast_os << strandmark;
+						tail << "\t";
+						tail << strandmark;
 						//if (read.hits_align_info.alignv[i].strand) blastout << "+";
 						//else blastout << "-";
 					}
 				}
-				blast_os << std::endl;
+
+				// a line for the reference, and for each of its members containing the alignment (index option 'dedup')
+				auto ids = refs.report_ids(read.hits_align_info.alignv[i].ref_seq, 
+					read.hits_align_info.alignv[i].ref_begin1, read.hits_align_info.alignv[i].ref_end1);
+				for (size_t k = 0; k < ids.size(); ++k)
+				{
+					if (k > 0) blast_os << read.getSeqId();
+					blast_os << "\t";
+					// (2) Subject
+					blast_os << ids[k].first << "\t";
+					// (3) %id
+					blast_os.precision(3);
+					blast_os << (double)id / (mismatches + gaps + id) * 100 << "\t";
+					// (4) alignment length
+					blast_os << (read.hits_align_info.alignv[i].read_end1 - read.hits_align_info.alignv[i].read_begin1 + 1) << "\t";
+					// (5) mismatches
+					blast_os << mismatches << "\t";
+					// (6) gap openings
+					blast_os << gaps << "\t";
+					// (7) q.start
+					blast_os << read.hits_align_info.alignv[i].read_begin1 + 1 << "\t";
+					// (8) q.end
+					blast_os << read.hits_align_info.alignv[i].read_end1 + 1 << "\t";
+					// (9) s.start
+					blast_os << read.hits_align_info.alignv[i].ref_begin1 - ids[k].second + 1 << "\t";
+					// (10) s.end
+					blast_os << read.hits_align_info.alignv[i].ref_end1 - ids[k].second + 1 << "\t";
+					blast_os << tail.str();
+					blast_os << std::endl;
+				}
 			}//~blast tabular m8
 		}
 	} // ~iterate all alignments
@@ -563,65 +572,75 @@ void Output::report_sam
 		if (read.hits_align_info.alignv[i].index_num == refs.num 
 			&& read.hits_align_info.alignv[i].part == refs.part)
 		{
-			// (1) Query
-			sam_os << read.getSeqId();
-			// (2) flag Forward/Reversed
-			if (!read.hits_align_info.alignv[i].strand) sam_os << "\t16\t";
-			else sam_os << "\t0\t";
-			// (3) Subject
-			sam_os << refs.buffer[read.hits_align_info.alignv[i].ref_seq].id;
-			// (4) Ref start
-			sam_os << "\t" << read.hits_align_info.alignv[i].ref_begin1 + 1;
+			// (5) .. (13) are the same for the reference and its members
+			std::stringstream tail;
 			// (5) mapq
-			sam_os << "\t" << 255 << "\t";
+			tail << "\t" << 255 << "\t";
 			// (6) CIGAR
 			// output the masked region at beginning of alignment
 			if (read.hits_align_info.alignv[i].read_begin1 != 0)
-				sam_os << read.hits_align_info.alignv[i].read_begin1 << "S";
+				tail << read.hits_align_info.alignv[i].read_begin1 << "S";
 
 			for (int c = 0; c < read.hits_align_info.alignv[i].cigar.size(); ++c)
 			{
 				uint32_t letter = 0xf & read.hits_align_info.alignv[i].cigar[c];
 				uint32_t length = (0xfffffff0 & read.hits_align_info.alignv[i].cigar[c]) >> 4;
-				sam_os << length;
-				if (letter == 0) sam_os << "M";
-				else if (letter == 1) sam_os << "I";
-				else sam_os << "D";
+				tail << length;
+				if (letter == 0) tail << "M";
+				else if (letter == 1) tail << "I";
+				else tail << "D";
 			}
 
 			auto end_mask = read.sequence.size() - read.hits_align_info.alignv[i].read_end1 - 1;
 			// output the masked region at end of alignment
-			if (end_mask > 0) sam_os << end_mask << "S";
+			if (end_mask > 0) tail << end_mask << "S";
 			// (7) RNEXT, (8) PNEXT, (9) TLEN
-			sam_os << "\t*\t0\t0\t";
+			tail << "\t*\t0\t0\t";
 			// (10) SEQ
 
 			if ( read.hits_align_info.alignv[i].strand == read.reversed ) // XNOR
 				read.revIntStr();
-			sam_os << read.get04alphaSeq();
+			tail << read.get04alphaSeq();
 			// (11) QUAL
-			sam_os << "\t";
+			tail << "\t";
 			// reverse-complement strand
 			if (read.quality.size() > 0 && !read.hits_align_info.alignv[i].strand)
 			{
 				std::reverse(read.quality.begin(), read.quality.end());
-				sam_os << read.quality;
+				tail << read.quality;
 			}
 			else if (read.quality.size() > 0) // forward strand
 			{
-				sam_os << read.quality;
+				tail << read.quality;
 				// FASTA read
 			}
-			else sam_os << "*";
+			else tail << "*";
 
 			// (12) OPTIONAL FIELD: SW alignment score generated by aligner
-			sam_os << "\tAS:i:" << read.hits_align_info.alignv[i].score1;
+			tail << "\tAS:i:" << read.hits_align_info.alignv[i].score1;
 			// (13) OPTIONAL FIELD: edit distance to the reference
 			uint32_t mismatches = 0;
 			uint32_t gaps = 0;
 			uint32_t id = 0;
 			read.calcMismatchGapId(refs, i, mismatches, gaps, id);
-			sam_os << "\tNM:i:" << mismatches + gaps << "\n";
+			tail << "\tNM:i:" << mismatches + gaps << "\n";
+
+			// a record for the reference, and for each of its members containing the alignment (index option 'dedup')
+			auto ids = refs.report_ids(read.hits_align_info.alignv[i].ref_seq,
+				read.hits_align_info.alignv[i].ref_begin1, read.hits_align_info.alignv[i].ref_end1);
+			for (auto const& ref_id : ids)
+			{
+				// (1) Query
+				sam_os << read.getSeqId();
+				// (2) flag Forward/Reversed
+				if (!read.hits_align_info.alignv[i].strand) sam_os << "\t16\t";
+				else sam_os << "\t0\t";
+				// (3) Subject
+				sam_os << ref_id.first;
+				// (4) Ref start
+				sam_os << "\t" << read.hits_align_info.alignv[i].ref_begin1 - ref_id.second + 1;
+				sam_os << tail.str();
+			}
 		}
 	} // ~for read.alignments
 } // ~Output::report_sam
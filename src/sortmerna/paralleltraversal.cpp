@@ -56,6 +56,8 @@
 #include "writer.hpp"
 #include "output.hpp"
 #include "read_control.hpp"
+#include "perfcounters.hpp"
+#include "dedup.hpp"
 
 
 #if defined(_WIN32)
@@ -71,6 +73,79 @@ int clear_dir(std::string dpath);
  //#define HEURISTIC1_OFF
 
 
+/*
+ * Long read mode (see Runopts::long_read): search the seed windows of the read in chunks of 'opts.long_read' positions.
+ * The L/2-mer keys are computed per chunk, and the windows searched in the previous passes are found from the window
+ * shifts of the passes instead of being marked, so the memory of the search does not grow with the read length.
+ * The hits of all the chunks are chained over the whole read by 'compute_lis_alignment' at the end of each pass.
+ *
+ * @param add_hit  adds a seed hit to the read unless its (L+1)-mer is masked (see alignmentCb)
+ */
+template <typename AddHit>
+static void search_long_read(Runopts & opts, Index & index, References & refs, Readstats & readstats, Refstats & refstats,
+	Read & read, uint32_t max_SW_score, bool & read_to_count, AddHit & add_hit)
+{
+	uint32_t lnwin = refstats.lnwin[index.index_num];
+	uint32_t partialwin = refstats.partialwin[index.index_num];
+	uint32_t mask = (1U << (partialwin << 1)) - 1;
+	uint32_t numpos = (uint32_t)read.isequence.size() - lnwin + 1; // number of window positions
+	auto const& skiplengths = opts.skiplengths[index.index_num];
+	std::vector<uint32_t> keys; // L/2-mer keys at the positions of the chunk
+	std::vector<id_win> id_hits;
+
+	bool search = true;
+	for (uint32_t pass_n = 0; search && pass_n < 3; ++pass_n)
+	{
+		uint32_t windowshift = skiplengths[pass_n];
+		// the interval size equals to the previous one, skip it
+		if (pass_n > 0 && windowshift == skiplengths[pass_n - 1])
+			continue;
+
+		if (read.is04) read.flip34(); // back to 03 encoding for the chunk search: the previous pass aligned the read in 04 encoding
+
+		for (uint32_t chunk_pos = 0; chunk_pos < numpos; chunk_pos += opts.long_read)
+		{
+			uint32_t chunk_end = std::min(chunk_pos + opts.long_read, numpos);
+
+			// the keys of the windows [chunk_pos, chunk_end): keyf = keys[win_pos - chunk_pos], keyr = keys[win_pos - chunk_pos + partialwin]
+			keys.clear();
+			uint32_t hash = 0;
+			for (uint32_t i = chunk_pos; i < chunk_end + lnwin - 1; ++i)
+			{
+				hash = ((hash << 2) | (uint32_t)read.isequence[i]) & mask;
+				if (i + 1 >= chunk_pos + partialwin)
+					keys.push_back(hash);
+			}
+
+			for (uint32_t win_pos = (chunk_pos + windowshift - 1) / windowshift * windowshift; win_pos < chunk_end; win_pos += windowshift)
+			{
+				// skip the windows searched in the previous passes
+				bool is_searched = false;
+				for (uint32_t i = 0; i < pass_n && !is_searched; ++i)
+					is_searched = win_pos % skiplengths[i] == 0;
+				if (is_searched)
+					continue;
+
+				bool accept_zero_kmer = false;
+				id_hits.clear();
+				search_window(index, &read.isequence[0], win_pos, keys[win_pos - chunk_pos], keys[win_pos - chunk_pos + partialwin],
+					partialwin, accept_zero_kmer, id_hits, opts);
+
+				bool is_hit = false;
+				for (auto const& hit : id_hits)
+				{
+					if (add_hit(hit))
+						is_hit = true;
+				}
+				if (is_hit)
+					read.readhit++;
+			}
+		}
+
+		compute_lis_alignment(read, opts, index, refs, readstats, refstats, search, max_SW_score, read_to_count);
+	}
+} // ~search_long_read
+
 /* 
  * Callback run in a Processor thread
  * Called on each index * index_part * read.num_strands
@@ -131,24 +206,75 @@ void alignmentCb
 		return;
 	}
 
+	bool is_minimizer = index.minimizers.is_loaded();
+	// long reads are searched in chunks (see 'search_long_read')
+	bool is_long_read = !is_minimizer && opts.long_read > 0 && read.sequence.size() > opts.long_read;
+
 	uint32_t windowshift = opts.skiplengths[index.index_num][0];
 	// keep track of windows (read positions) which have been already traversed in the burst trie
 	// initially all False
-	vector<bool> read_pos_searched(read.sequence.size());
+	vector<bool> read_pos_searched(is_minimizer || is_long_read ? 0 : read.sequence.size());
 
 	uint32_t pass_n = 0; // Pass number (possible value 0,1,2)
 	uint32_t max_SW_score = read.sequence.size() *opts.match; // the maximum SW score attainable for this read
 
-	std::vector<UCHAR> bitvec; // window (prefix/suffix) bitvector
+	// (L+1)-mers with more positions are masked (see OccurHist)
+	uint32_t max_occur = refstats.max_occur[index.index_num];
+	uint64_t seed_hits = 0;
+	uint64_t seed_positions = 0;
+	uint64_t masked_hits = 0;
+	uint64_t masked_positions = 0;
+
+	// associate the id with the read window. The hits of the masked (L+1)-mers are dropped.
+	auto add_hit = [&](const id_win & hit) {
+		if (max_occur > 0)
+		{
+			uint32_t num_pos = index.num_positions(hit.id);
+			++seed_hits;
+			seed_positions += num_pos;
+			if (num_pos > max_occur)
+			{
+				++masked_hits;
+				masked_positions += num_pos;
+				return false;
+			}
+		}
+		read.id_win_hits.push_back(hit);
+		return true;
+	};
+
+	if (read.is04) read.flip34(); // Make sure the read is in 03 encoding for index search
+
+	// minimizer seed engine: a single pass over the exact hits of the read minimizers on this strand
+	// instead of the windows passes (see MinimizerIndex)
+	if (is_minimizer)
+	{
+		for_each_minimizer(&read.isequence[0], (uint32_t)read.isequence.size(), index.minimizers.k, index.minimizers.w,
+			[&](uint32_t pos, uint64_t code) {
+				auto ids = index.minimizers.find(code);
+				for (auto id = ids.first; id != ids.second; ++id)
+				{
+					if (add_hit(id_win(*id, pos)))
+						read.readhit++;
+				}
+			});
+
+		bool search = true;
+		compute_lis_alignment(read, opts, index, refs, readstats, refstats, search, max_SW_score, read_to_count);
+	}
+	else if (is_long_read)
+	{
+		search_long_read(opts, index, refs, readstats, refstats, read, max_SW_score, read_to_count, add_hit);
+	}
 
-	// TODO: below 2 values are unique per index part. Move to index?
-	uint32_t bitvec_size = (refstats.partialwin[index.index_num] - 2) << 2; // e.g. 9 - 2 = 0000 0111 << 2 = 0001 1100 = 28
-	// Does this mark where in 32-bit the bitvector starts?
-	uint32_t offset = (refstats.partialwin[index.index_num] - 3) << 2; // e.g. 9 - 3 = 0000 0110 << 2 = 0001 1000 = 24
+	// L/2-mer look-up keys at each read position, shared by the windows of all the passes:
+	// keyf = kmer_keys[win_pos], keyr = kmer_keys[win_pos + partialwin]
+	// The keys of the other strand were computed along with them (see Read::kmerKeys)
+	auto const& kmer_keys = is_minimizer || is_long_read ? read.kmer_keys[0] : read.kmerKeys(refstats.partialwin[index.index_num]);
 
 	// loop search positions on the read in multiple passes
 	// changing the step (windowshift) when necessary
-	for (bool search = true; search; )
+	for (bool search = !is_minimizer && !is_long_read; search; )
 	{
 		// number of k-mer windows fit along the read given 
 		// the window size and a search step (windowshift)
@@ -172,139 +298,48 @@ void alignmentCb
 				// ids for k-mers that hit the database
 				vector<id_win> id_hits; // TODO: add directly to 'id_win_hits'? - No, id_win_hits may contain hits from different index parts.
 
-				bitvec.resize(bitvec_size);
-				std::fill(bitvec.begin(), bitvec.end(), 0);
-
-				init_win_f(&read.isequence[win_pos + refstats.partialwin[index.index_num]],
-					&bitvec[0],
-					&bitvec[4],
-					refstats.numbvs[index.index_num]);
-
 				// the hash of the first half of the kmer window
-				uint32_t keyf = read.hashKmer(win_pos, refstats.partialwin[index.index_num]);
+				uint32_t keyf = kmer_keys[win_pos];
+				// the hash of the second (rear) half of the kmer window
+				uint32_t keyr = kmer_keys[win_pos + refstats.partialwin[index.index_num]];
 
 				// TODO: remove in production
-				if (index.lookup_tbl.size() <= keyf) {
-					std::stringstream ss;
-					size_t vsize = index.lookup_tbl.size();
-					uint16_t idxn = index.index_num;
-					uint16_t idxp = index.part;
-					std::string id = read.id;
-					bool is03 = read.is03;
-					bool is04 = read.is04;
-					ss << STAMP
-						<< "lookup index: " << keyf << " is larger than lookup_tbl.size: " << vsize 
-						<< " Index: " << idxn
-						<< " Part: " << idxp
-						<< " Read.id: " << id
-						<< " Read.is03: " << is03
-						<< " Read.is04: " << is04
-						<< " Aborting.." << std::endl;
-					ERR(ss.str());
-					exit(EXIT_FAILURE);
-				}
-
-				// do traversal if the exact half window exists in the burst trie
-				if ( index.lookup_tbl[keyf].count > opts.minoccur && index.lookup_tbl[keyf].trie_F != NULL )
-				{
-					/* subsearch (1)(a) d([p_1],[w_1]) = 0 and d([p_2],[w_2]) <= 1;
-					*
-					*  w = |------ [w_1] ------|------ [w_2] ------|
-					*  p = |------ [p_1] ------|------ [p_2] ----| (0/1 deletion in [p_2])
-					*              or
-					*    = |------ [p_1] ------|------ [p_2] ------| (0/1 match/substitution in [p_2])
-					*        or
-					*    = |------ [p_1] ------|------ [p_2] --------| (0/1 insertion in [p_2])
-					*
-					*/
-					traversetrie_align(
-						index.lookup_tbl[keyf].trie_F,
-						0,
-						0,
-						&bitvec[0],
-						&bitvec[offset],
-						accept_zero_kmer,
-						id_hits,
-						//read.id,
-						win_pos,
-						refstats.partialwin[index.index_num],
-						opts
-					);
-				} //~if exact half window exists in the burst trie
-
-				// only search reversed kmer if an exact match has not been found for the forward
-				if (!accept_zero_kmer)
+				for (auto key : { keyf, keyr })
 				{
-					//bitvec.resize(bitvec_size);
-					std::fill(bitvec.begin(), bitvec.end(), 0);
-
-					// init the first bitvector window
-					init_win_r(&read.isequence[win_pos + refstats.partialwin[index.index_num] - 1],
-						&bitvec[0],
-						&bitvec[4],
-						refstats.numbvs[index.index_num]);
-
-					// the hash of the second (rear) half of the kmer window
-					uint32_t keyr = read.hashKmer(win_pos + refstats.partialwin[index.index_num], refstats.partialwin[index.index_num]);
-
-					// TODO: remove in production
-					if (index.lookup_tbl.size() <= keyr) {
+					if (index.lookup_size <= key) {
 						std::stringstream ss;
-						size_t vsize = index.lookup_tbl.size();
+						size_t vsize = index.lookup_size;
 						uint16_t idxn = index.index_num;
 						uint16_t idxp = index.part;
 						std::string id = read.id;
 						bool is03 = read.is03;
 						bool is04 = read.is04;
-						ss << STAMP << "Thread: " << std::this_thread::get_id()
-							<< " ERROR: lookup index: " << keyr << " is larger than lookup_tbl.size: " << vsize
+						ss << STAMP
+							<< "lookup index: " << key << " is larger than lookup_tbl.size: " << vsize 
 							<< " Index: " << idxn
 							<< " Part: " << idxp
 							<< " Read.id: " << id
 							<< " Read.is03: " << is03
 							<< " Read.is04: " << is04
 							<< " Aborting.." << std::endl;
-						std::cout << ss.str();
+						ERR(ss.str());
 						exit(EXIT_FAILURE);
 					}
+				}
 
-					// continue subsearch (1)(b)
-					if ( index.lookup_tbl[keyr].count > opts.minoccur && index.lookup_tbl[keyr].trie_R != NULL )
-					{
-						/* subsearch (1)(b) d([p_1],[w_1]) = 1 and d([p_2],[w_2]) = 0;
-						*
-						*  w =    |------ [w_1] ------|------ [w_2] -------|
-						*  p =      |------- [p_1] ---|--------- [p_2] ----| (1 deletion in [p_1])
-						*              or
-						*    =    |------ [p_1] ------|------ [p_2] -------| (1 match/substitution in [p_1])
-						*        or
-						*    = |------- [p_1] --------|---- [p_2] ---------| (1 insertion in [p_1])
-						*
-						*/
-						traversetrie_align(
-							index.lookup_tbl[keyr].trie_R,
-							0,
-							0,
-							&bitvec[0],
-							&bitvec[offset],
-							accept_zero_kmer,
-							id_hits,
-							//read.id,
-							win_pos,
-							refstats.partialwin[index.index_num], 
-							opts);
-					}//~if exact half window exists in the reverse burst trie                    
-				}//~if (!accept_zero_kmer)
+				// subsearches (1)(a) and (1)(b) in the mini burst tries
+				search_window(index, &read.isequence[0], win_pos, keyf, keyr, refstats.partialwin[index.index_num],
+					accept_zero_kmer, id_hits, opts);
 
 				// associate the ids with the read window number
-				if (!id_hits.empty())
+				bool is_hit = false;
+				for (uint32_t i = 0; i < id_hits.size(); i++)
 				{
-					for (uint32_t i = 0; i < id_hits.size(); i++)
-					{
-						read.id_win_hits.push_back(id_hits[i]);
-					}
-					read.readhit++;
+					if (add_hit(id_hits[i]))
+						is_hit = true;
 				}
+				if (is_hit)
+					read.readhit++;
 			} // ~if not read_pos_searched[win_pos]
 
 			// continue read analysis if threshold seeds were matched
@@ -341,6 +376,14 @@ void alignmentCb
 			//~while all three window skip lengths have not been tested, or a match has not been found
 	}// ~while (search);
 
+	if (max_occur > 0)
+	{
+		index.seed_hits += seed_hits;
+		index.seed_positions += seed_positions;
+		index.masked_hits += masked_hits;
+		index.masked_positions += masked_positions;
+	}
+
 	// the read didn't align (for --num_alignments [INT] option),
 	// output null alignment string
 	if (isLastStrand && !read.is_hit && opts.num_alignments > -1) // !opts.forward
@@ -351,6 +394,59 @@ void alignmentCb
 	}//~if read didn't align
 } // ~alignmentCb
 
+/**
+ * Prefetch the seed look-ups of a batch of reads before they are searched one by one in 'alignmentCb'.
+ * The look-up of a window is a chain of dependent loads: look-up table entry -> trie root -> trie nodes and buckets.
+ * Searching the windows in turn stalls on each DRAM miss of the chain. Instead, the look-up table entries of
+ * the windows of the first pass of all the reads are requested first, then the trie roots, so the misses of
+ * the batch overlap.
+ *
+ * @param keys  buffer for the L/2-mer keys of the batch: forward, reverse for each window
+ */
+void prefetchSeeds(Runopts & opts, Index & index, Refstats & refstats, 
+	std::vector<Read>::iterator first, std::vector<Read>::iterator last, std::vector<uint32_t> & keys)
+{
+	uint32_t lnwin = refstats.lnwin[index.index_num];
+	uint32_t partialwin = refstats.partialwin[index.index_num];
+	uint32_t windowshift = opts.skiplengths[index.index_num][0];
+
+	// the minimizer look-ups are not prefetched
+	if (index.minimizers.is_loaded())
+		return;
+
+	// 1. the look-up table entries of the windows
+	keys.clear();
+	for (; first != last; ++first)
+	{
+		Read & read = *first;
+		if (!read.isValid || read.sequence.size() < lnwin)
+			continue;
+		// the keys of the long reads are computed per chunk (see search_long_read)
+		if (opts.long_read > 0 && read.sequence.size() > opts.long_read)
+			continue;
+		if (read.is04) read.flip34(); // the keys are computed on 03 encoding as in 'alignmentCb'
+		auto const& kmer_keys = read.kmerKeys(partialwin);
+		for (uint32_t win_pos = 0; win_pos + lnwin <= read.sequence.size(); win_pos += windowshift)
+		{
+			uint32_t keyf = kmer_keys[win_pos];
+			uint32_t keyr = kmer_keys[win_pos + partialwin];
+			PREFETCH(&index.lookup_tbl[keyf]);
+			PREFETCH(&index.lookup_tbl[keyr]);
+			keys.push_back(keyf);
+			keys.push_back(keyr);
+		}
+	}
+
+	// 2. the trie roots. The look-up entries were requested in step 1.
+	for (size_t i = 0; i < keys.size(); i += 2)
+	{
+		if (index.lookup_tbl[keys[i]].trie_F != NO_TRIE)
+			PREFETCH(index.trie_F(keys[i]));
+		if (index.lookup_tbl[keys[i + 1]].trie_R != NO_TRIE)
+			PREFETCH(index.trie_R(keys[i + 1]));
+	}
+} // ~prefetchSeeds
+
 // called from main
 void align(Runopts & opts, Readstats & readstats, Output & output, Index &index, KeyValueDatabase &kvdb)
 {
@@ -387,11 +483,13 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 		<< std::endl;
 	std::cout << ss.str();
 
+	PerfCounters perf; // has to be created before the threads to count them
 	ThreadPool tpool(numThreads);
 	ReadsQueue readQueue("read_queue", opts.queue_size_max, opts.num_read_thread); // shared: Processor pops, Reader pushes
 	ReadsQueue writeQueue("write_queue", opts.queue_size_max, numProcThread); // shared: Processor pushes, Writer pops
 	Refstats refstats(opts, readstats);
 	References refs;
+	DedupCache dedup(opts); // alignments of the distinct reads on the current index part
 
 	int loopCount = 0; // counter of total number of processing iterations
 
@@ -424,6 +522,7 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 			starts = std::chrono::high_resolution_clock::now();
 
 			refs.load(index_num, idx_part, opts, refstats);
+			dedup.set_part(opts, index, refstats);
 
 //			std::chrono::duration<double> elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t);
 			elapsed = std::chrono::high_resolution_clock::now() - starts; // ~20 sec Debug/Win
@@ -433,6 +532,7 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 			std::cout << ss.str();
 
 			starts = std::chrono::high_resolution_clock::now();
+			perf.start();
 			for (int i = 0; i < opts.num_read_thread; i++)
 			{
 				tpool.addJob(ReadControl(opts, readQueue, kvdb));
@@ -446,7 +546,7 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 			// add processor jobs
 			for (int i = 0; i < numProcThread; i++)
 			{
-				tpool.addJob(Processor("proc_" + std::to_string(i), readQueue, writeQueue, opts, index, refs, output, readstats, refstats, alignmentCb));
+				tpool.addJob(Processor("proc_" + std::to_string(i), readQueue, writeQueue, opts, index, refs, output, readstats, refstats, dedup, alignmentCb));
 			}
 			++loopCount;
 
@@ -461,6 +561,26 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 			ss.str("");
 			ss << STAMP << "Done index " << index_num << " Part: " << idx_part + 1 
 				<< " Time: " << std::setprecision(2) << std::fixed << elapsed.count() << " sec\n";
+			ss << STAMP << perf.to_string() << std::endl;
+			if (refstats.max_occur[index_num] > 0)
+			{
+				ss << STAMP << "Masked seeds (more than " << refstats.max_occur[index_num] << " positions): "
+					<< index.masked_hits << " of " << index.seed_hits << " hits, "
+					<< index.masked_positions << " of " << index.seed_positions << " positions skipped" << std::endl;
+			}
+			if (dedup.is_enabled())
+			{
+				uint64_t num_reads = dedup.num_reads;
+				uint64_t num_stored = dedup.num_stored;
+				uint64_t num_duplicates = dedup.num_duplicates - num_stored;
+				ss << STAMP << "Duplicate reads (took the alignment of an identical read): " << num_duplicates << " of "
+					<< num_reads << " (" << std::setprecision(2) << std::fixed
+					<< (num_reads > 0 ? 100.0 * num_duplicates / num_reads : 0.0) << "%)" << std::endl;
+				if (!opts.align_cache.empty())
+					ss << STAMP << "Reads found in the alignment cache: " << num_stored << " of " << num_reads
+						<< " (" << (num_reads > 0 ? 100.0 * num_stored / num_reads : 0.0) << "%)" << std::endl;
+				dedup.clear();
+			}
 			std::cout << ss.str();
 		} // ~for(idx_part)
 	} // ~for(index_num)
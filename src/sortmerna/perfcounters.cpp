@@ -0,0 +1,80 @@
+/**
+ * FILE: perfcounters.cpp
+ * Created: Oct 18, 2026 Sun
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <sstream>
+#include <cstring>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include "perfcounters.hpp"
+
+PerfCounters::PerfCounters()
+{
+#if defined(__linux__)
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.inherit = 1; // count the threads created later
+	attr.exclude_kernel = 1; // allowed with perf_event_paranoid 2
+	attr.exclude_hv = 1;
+	// this process, any CPU
+	dtlb_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+} // ~PerfCounters::PerfCounters
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+	if (dtlb_fd != -1)
+		close(dtlb_fd);
+#endif
+}
+
+void PerfCounters::start()
+{
+	dtlb_start = read_dtlb();
+#if !defined(_WIN32)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		minflt_start = usage.ru_minflt;
+		majflt_start = usage.ru_majflt;
+	}
+#endif
+} // ~PerfCounters::start
+
+std::string PerfCounters::to_string()
+{
+	std::stringstream ss;
+	if (dtlb_fd != -1)
+		ss << "dTLB load misses: " << read_dtlb() - dtlb_start;
+	else
+		ss << "dTLB load misses: n/a";
+#if !defined(_WIN32)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		ss << " Page faults: minor " << usage.ru_minflt - minflt_start << " major " << usage.ru_majflt - majflt_start;
+#endif
+	return ss.str();
+} // ~PerfCounters::to_string
+
+/* current value of the dTLB misses counter including the inherited counters of the threads */
+uint64_t PerfCounters::read_dtlb()
+{
+	uint64_t count = 0;
+#if defined(__linux__)
+	if (dtlb_fd != -1 && read(dtlb_fd, &count, sizeof(count)) != sizeof(count))
+		count = 0;
+#endif
+	return count;
+} // ~PerfCounters::read_dtlb
@@ -11,6 +11,8 @@
 #include <sstream>
 #include <chrono>
 #include <iomanip> // std::setprecision
+#include <algorithm>
+#include <unordered_map>
 
 #include "processor.hpp"
 #include "readsqueue.hpp"
@@ -24,17 +26,40 @@
 #include "ThreadPool.hpp"
 #include "read_control.hpp"
 #include "writer.hpp"
+#include "dedup.hpp"
 
 // forward
 void computeStats(Read & read, Readstats & readstats, Refstats & refstats, References & refs, Runopts & opts);
-
-/* Runs in a thread. Pops reads from the Reads Queue */
+void prefetchSeeds(Runopts & opts, Index & index, Refstats & refstats, 
+	std::vector<Read>::iterator first, std::vector<Read>::iterator last, std::vector<uint32_t> & keys); // paralleltraversal.cpp
+
+/* 
+ * Runs in a thread. Pops reads from the Reads Queue in batches of Runopts::seed_batch reads,
+ * whose seed look-ups are prefetched before the reads are searched (see prefetchSeeds).
+ * With Runopts::reorder the batches are of 'reorder' reads, which are searched in the order of their minimizers
+ * (see Read::minimizer), and pushed to the Write Queue in the order they were popped.
+ * With Runopts::dedup_reads the reads already aligned on the index part by any Processor take the cached alignment
+ * (see DedupCache), and the duplicates within a batch take the alignment of the first one, so only the distinct
+ * reads are searched.
+ */
 void Processor::run()
 {
 	int countReads = 0;
 	int countProcessed = 0;
 	std::size_t num_aligned = 0; // count of reads with read.hit = true
 	bool alreadyProcessed = false;
+	std::size_t chunk_size = std::max<uint32_t>(opts.seed_batch, 1); // reads prefetched together
+	std::size_t batch_size = std::max<std::size_t>(opts.reorder, chunk_size);
+	std::vector<Read> batch;
+	std::vector<Read> sorted;
+	std::vector<uint64_t> minimizers;
+	std::vector<uint32_t> order; // batch positions of the reads in the search order
+	std::vector<uint32_t> keys; // seed look-up keys of the prefetched reads
+	std::vector<std::string> dedup_keys; // DedupCache keys of the batch reads
+	std::unordered_map<std::string, uint32_t> dedup_batch; // DedupCache key -> batch position of the read
+	std::vector<std::pair<uint32_t, Read>> duplicates; // duplicates of the batch reads: batch position, duplicate
+	std::vector<DedupEntry> dedup_entries; // alignments of the batch reads
+	DedupEntry dedup_entry;
 	
 	{
 		std::stringstream ss;
@@ -42,18 +67,68 @@ void Processor::run()
 		std::cout << ss.str();
 	}
 
-	for (;;)
+	for (bool isDone = false; !isDone;)
 	{
-		Read read = readQueue.pop(); // returns an empty read if queue is empty
-		if (read.isEmpty && readQueue.getPushers() == 0)
+		batch.clear();
+		dedup_keys.clear();
+		dedup_batch.clear();
+		duplicates.clear();
+		while (batch.size() + duplicates.size() < batch_size)
 		{
-			break;
+			Read read = readQueue.pop(); // returns an empty read if queue is empty
+			if (read.isEmpty && readQueue.getPushers() == 0)
+			{
+				isDone = true;
+				break;
+			}
+			alreadyProcessed = (read.isRestored && read.lastIndex == index.index_num && read.lastPart == index.part);
+
+			if (read.isEmpty || !read.isValid || alreadyProcessed) {
+				if (alreadyProcessed) ++countProcessed;
+				continue;
+			}
+
+			if (dedup.is_enabled())
+			{
+				std::string key = DedupCache::key(read);
+				if (dedup.find(key, dedup_entry))
+				{
+					dedup_entry.apply(read, readstats);
+					if (read.isValid)
+					{
+						if (read.is_hit) ++num_aligned;
+						writeQueue.push(read);
+					}
+					countReads++;
+					continue;
+				}
+				auto rep = dedup_batch.find(key);
+				if (rep != dedup_batch.end())
+				{
+					duplicates.emplace_back(rep->second, std::move(read));
+					continue;
+				}
+				dedup_batch.emplace(key, (uint32_t)batch.size());
+				dedup_keys.push_back(std::move(key));
+				read.stats_delta.clear();
+			}
+			batch.push_back(std::move(read));
 		}
-		alreadyProcessed = (read.isRestored && read.lastIndex == index.index_num && read.lastPart == index.part);
 
-		if (read.isEmpty || !read.isValid || alreadyProcessed) {
-			if (alreadyProcessed) ++countProcessed;
-			continue;
+		order.resize(batch.size());
+		for (uint32_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		if (opts.reorder > 0)
+		{
+			uint32_t k = std::min<uint32_t>(refstats.lnwin[index.index_num], 32);
+			minimizers.resize(batch.size());
+			for (uint32_t i = 0; i < batch.size(); ++i)
+				minimizers[i] = batch[i].minimizer(k);
+			std::stable_sort(order.begin(), order.end(), [&minimizers](uint32_t a, uint32_t b) { return minimizers[a] < minimizers[b]; });
+			sorted.clear();
+			for (auto i : order)
+				sorted.push_back(std::move(batch[i]));
+			batch.swap(sorted);
 		}
 
 		// search the forward and/or reverse strands depending on Run options
@@ -65,26 +140,67 @@ void Processor::run()
 		else 
 			num_strands = 2; // search both strands. The default when neither -F or -R were specified
 
-		for (int32_t count = 0; count < num_strands; ++count)
+		for (std::size_t first = 0; first < batch.size(); first += chunk_size)
 		{
-			if ((search_single_strand && opts.is_reverse) || count == 1)
+			auto chunk_begin = batch.begin() + first;
+			auto chunk_end = batch.begin() + std::min(first + chunk_size, batch.size());
+			for (int32_t count = 0; count < num_strands; ++count)
 			{
-				if (!read.reversed)
-					read.revIntStr();
+				if ((search_single_strand && opts.is_reverse) || count == 1)
+				{
+					for (auto read = chunk_begin; read != chunk_end; ++read)
+					{
+						if (!read->reversed)
+							read->revIntStr();
+					}
+				}
+
+				if (opts.seed_batch > 0)
+					prefetchSeeds(opts, index, refstats, chunk_begin, chunk_end, keys);
+
+				for (auto read = chunk_begin; read != chunk_end; ++read)
+				{
+					// call 'paralleltraversal.cpp::alignmentCb'
+					callback(opts, index, refs, output, readstats, refstats, *read, search_single_strand || count == 1);
+					//opts.forward = false;
+					read->id_win_hits.clear(); // bug 46
+				}
 			}
-			// call 'paralleltraversal.cpp::alignmentCb'
-			callback(opts, index, refs, output, readstats, refstats, read, search_single_strand || count == 1);
-			//opts.forward = false;
-			read.id_win_hits.clear(); // bug 46
 		}
 
-		if (read.isValid && !read.isEmpty) 
+		// restore the order the reads were popped in
+		if (opts.reorder > 0)
 		{
-			if (read.is_hit) ++num_aligned;
-			writeQueue.push(read);
+			sorted.resize(batch.size());
+			for (uint32_t i = 0; i < batch.size(); ++i)
+				sorted[order[i]] = std::move(batch[i]);
+			batch.swap(sorted);
+		}
+
+		if (dedup.is_enabled())
+		{
+			dedup_entries.clear();
+			for (uint32_t i = 0; i < batch.size(); ++i)
+				dedup_entries.emplace_back(std::move(dedup_keys[i]), batch[i]);
+			for (auto & dup : duplicates)
+			{
+				dedup_entries[dup.first].apply(dup.second, readstats);
+				batch.push_back(std::move(dup.second));
+			}
+			dedup.num_duplicates += duplicates.size();
+			for (auto & entry : dedup_entries)
+				dedup.insert(std::move(entry));
 		}
 
-		countReads++;
+		for (auto & read : batch)
+		{
+			if (read.isValid && !read.isEmpty)
+			{
+				if (read.is_hit) ++num_aligned;
+				writeQueue.push(read);
+			}
+			countReads++;
+		}
 	}
 
 	writeQueue.decrPushers(); // signal this processor done adding
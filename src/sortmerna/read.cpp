@@ -4,6 +4,7 @@
  * @copyright 2016-20 Clarity Genomics BVBA
  */
 #include <filesystem>
+#include <algorithm>
 
 // 3rd party
 #include "rapidjson/writer.h"
@@ -12,6 +13,7 @@
 // SMR
 #include "read.hpp"
 #include "references.hpp"
+#include "minimizer.hpp" // kmer_hash
 
 alignment_struct2::alignment_struct2() : max_size(0), min_index(0), max_index(0) 
 {}
@@ -183,6 +185,8 @@ Read & Read::operator=(const Read & that)
 	id_win_hits = that.id_win_hits;
 	hits_align_info = that.hits_align_info;
 	scoring_matrix = that.scoring_matrix;
+	isequence_rc.clear(); // computed on demand (see revIntStr)
+	kmer_keys_len = 0; // computed on demand (see kmerKeys)
 
 	return *this; // by convention always return *this
 } // ~Read::operator=
@@ -234,16 +238,11 @@ void Read::initScoringMatrix(int8_t match, int8_t mismatch, int8_t score_N)
 	}
 }
 
+/*
+ * The read length is not bounded: the reads longer than Runopts::long_read are searched in the long read mode
+ * (see alignmentCb)
+ */
 void Read::validate() {
-	std::stringstream ss;
-	if (sequence.size() > MAX_READ_LEN)
-	{
-		ss << std::endl << RED << "ERROR" << COLOFF << ": [" << __FILE__ << ":" << __LINE__
-			<< "] Read ID: " << id << " Header: " << header << " Sequence length: " << sequence.size() << " > " << MAX_READ_LEN << " nt " << std::endl
-			<< "  Please check your reads or contact the authors." << std::endl;
-		std::cerr << ss.str();
-		exit(EXIT_FAILURE);
-	}
 	isValid = true;
 } // ~Read::validate
 
@@ -259,6 +258,10 @@ void Read::clear()
 	quality.clear();
 	isequence.clear();
 	reversed = false;
+	isequence_rc.clear();
+	kmer_keys[0].clear();
+	kmer_keys[1].clear();
+	kmer_keys_len = 0;
 	ambiguous_nt.clear();
 	isRestored = false;
 	lastIndex = 0;
@@ -278,6 +281,8 @@ void Read::clear()
 // convert char "sequence" to 0..3 alphabet "isequence", and populate "ambiguous_nt"
 void Read::seqToIntStr()
 {
+	isequence_rc.clear(); // the cached strand and keys are of the previous sequence
+	kmer_keys_len = 0;
 	for (std::string::iterator it = sequence.begin(); it != sequence.end(); ++it)
 	{
 		char c = nt_table[(int)*it];
@@ -291,13 +296,24 @@ void Read::seqToIntStr()
 	is03 = true;
 }
 
-/* reverse complement the integer sequence in 03 encoding */
+/*
+ * reverse complement the integer sequence.
+ * The other strand is computed once into 'isequence_rc' and then swapped in and out, so switching the strands
+ * costs no transform or allocation. The ambiguous nucleotides keep their value on both strands i.e. 0 (as 'A')
+ * in 03 encoding and 4 in 04 encoding (see flip34).
+ */
 void Read::revIntStr() 
 {
-	std::reverse(isequence.begin(), isequence.end());
-	for (int i = 0; i < isequence.length(); i++) {
-		isequence[i] = complement[(int)isequence[i]];
+	if (isequence_rc.size() != isequence.size())
+	{
+		isequence_rc.resize(isequence.size());
+		auto rc = isequence_rc.rbegin();
+		for (auto it = isequence.begin(); it != isequence.end(); ++it, ++rc)
+			*rc = complement[(int)*it];
+		for (auto pos : ambiguous_nt)
+			isequence_rc[reversed ? pos : isequence.size() - pos - 1] = is03 ? 0 : 4;
 	}
+	isequence.swap(isequence_rc);
 	reversed = !reversed;
 }
 
@@ -342,6 +358,14 @@ void Read::flip34()
 				isequence[ambiguous_nt[p]] = val;
 			}
 		}
+		// the cached other strand (see revIntStr)
+		if (isequence_rc.size() == isequence.size())
+		{
+			for (uint32_t p = 0; p < ambiguous_nt.size(); p++)
+			{
+				isequence_rc[reversed ? ambiguous_nt[p] : (isequence.length() - ambiguous_nt[p]) - 1] = val;
+			}
+		}
 		is03 = !is03;
 		is04 = !is04;
 	}
@@ -413,9 +437,16 @@ std::string Read::toString()
 /* deserialize matches from string stored in DB */
 bool Read::load_db(KeyValueDatabase & kvdb)
 {
-	int id_win_hits_len = 0;
 	std::string bstr = kvdb.get(id);
 	if (bstr.size() == 0) { isRestored = false; return isRestored; }
+	fromString(bstr);
+	isRestored = true;
+	return isRestored;
+} // ~Read::load_db
+
+/* deserialize matches from the string generated by 'toString' */
+void Read::fromString(const std::string & bstr)
+{
 	size_t offset = 0;
 
 	std::memcpy(static_cast<void*>(&lastIndex), bstr.data() + offset, sizeof(lastIndex));
@@ -469,10 +500,7 @@ bool Read::load_db(KeyValueDatabase & kvdb)
 	alignment_struct2 alignstruct(hits_align_info_str);
 	hits_align_info = alignstruct;
 	offset += hits_align_info_size;
-
-	isRestored = true;
-	return isRestored;
-} // ~Read::load_db
+} // ~Read::fromString
 
 /* deserialize matches from JSON and populate the read */
 void Read::unmarshallJson(KeyValueDatabase & kvdb)
@@ -553,4 +581,97 @@ uint32_t Read::hashKmer(uint32_t pos, uint32_t len)
 		++pKmer;
 	}
 	return hash;
-}
\ No newline at end of file
+}
+
+/*
+ * Calculate the hashes (see Read::hashKmer) of all the kmers of both strands of the read in a single sweep of
+ * 'isequence' in 03 encoding: each forward hash is the previous one shifted by a nucleotide, and each reverse
+ * complement hash is the previous one shifted the other way by the complemented nucleotide. The ambiguous
+ * nucleotides are 'A' on both strands as in 'revIntStr'. The search windows of all the passes, on either half
+ * of the window and either strand, are then looked up by position (see kmerKeys).
+ *
+ * @param len  Kmer Length <= 16
+ */
+void Read::hashKmers(uint32_t len)
+{
+	auto & keys = kmer_keys[reversed ? 1 : 0]; // keys of 'isequence'
+	auto & keys_rc = kmer_keys[reversed ? 0 : 1]; // keys of its reverse complement
+	keys.clear();
+	keys_rc.clear();
+	kmer_keys_len = len;
+	if (len == 0 || isequence.size() < len)
+		return;
+
+	// ambiguous positions on 'isequence' in increasing order
+	std::vector<uint32_t> ambiguous(ambiguous_nt.begin(), ambiguous_nt.end());
+	if (reversed)
+	{
+		std::reverse(ambiguous.begin(), ambiguous.end());
+		for (auto & pos : ambiguous)
+			pos = (uint32_t)isequence.size() - pos - 1;
+	}
+	auto next_ambiguous = ambiguous.begin();
+
+	uint32_t num_keys = (uint32_t)isequence.size() - len + 1;
+	keys.resize(num_keys);
+	keys_rc.resize(num_keys);
+	uint32_t mask = len < 16 ? (1U << (len << 1)) - 1 : ~0U;
+	uint32_t shift_rc = (len - 1) << 1;
+	uint32_t hash = 0;
+	uint32_t hash_rc = 0;
+	for (uint32_t i = 0; i < isequence.size(); ++i)
+	{
+		uint32_t nt = (uint32_t)isequence[i];
+		uint32_t nt_rc = 3 - nt;
+		if (next_ambiguous != ambiguous.end() && *next_ambiguous == i)
+		{
+			nt_rc = 0;
+			++next_ambiguous;
+		}
+		hash = ((hash << 2) | nt) & mask;
+		hash_rc = (hash_rc >> 2) | (nt_rc << shift_rc);
+		if (i + 1 >= len)
+		{
+			keys[i + 1 - len] = hash;
+			keys_rc[num_keys - 1 - (i + 1 - len)] = hash_rc;
+		}
+	}
+} // ~Read::hashKmers
+
+/*
+ * The look-up keys of the kmers of the current strand ('isequence') i.e. keys[pos] = hashKmer(pos, len).
+ * The keys of both strands are computed on the first call (see hashKmers), so the second strand only costs a look-up.
+ * The read must be in 03 encoding.
+ *
+ * @param len  Kmer Length <= 16
+ */
+const std::vector<uint32_t> & Read::kmerKeys(uint32_t len)
+{
+	if (kmer_keys_len != len)
+		hashKmers(len);
+	return kmer_keys[reversed ? 1 : 0];
+} // ~Read::kmerKeys
+
+/*
+ * The smallest hash of the canonical (lesser of the forward and the reverse complement) k-mers of the read.
+ * Reads from the same region of a reference, on either strand, likely have the same minimizer i.e. it serves
+ * as a cheap locality signature of the read (see Runopts::reorder).
+ *
+ * @param k  k-mer length <= 32
+ */
+uint64_t Read::minimizer(uint32_t k)
+{
+	uint64_t mask = k < 32 ? (1ULL << (2 * k)) - 1 : ~0ULL;
+	uint64_t fwd = 0;
+	uint64_t rev = 0;
+	uint64_t min_hash = ~0ULL;
+	for (uint32_t i = 0; i < isequence.size(); ++i)
+	{
+		uint64_t nt = (uint64_t)isequence[i] & 3; // ambiguous nt (4 in 04 encoding) as 'A'
+		fwd = ((fwd << 2) | nt) & mask;
+		rev = (rev >> 2) | ((3 - nt) << (2 * (k - 1)));
+		if (i + 1 < k) continue;
+		min_hash = std::min(min_hash, kmer_hash(std::min(fwd, rev)));
+	}
+	return min_hash;
+} // ~Read::minimizer
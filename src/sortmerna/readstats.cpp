@@ -33,7 +33,7 @@ std::string to_lower(std::string& val); // util.cpp
 
 Readstats::Readstats(Runopts &opts, KeyValueDatabase &kvdb)
 	:
-	min_read_len(MAX_READ_LEN),
+	min_read_len(UINT32_MAX),
 	max_read_len(0),
 	total_reads_aligned(0),
 	total_reads_mapped_cov(0),
@@ -310,6 +310,28 @@ void Readstats::set_is_total_reads_mapped_cov()
 		is_total_reads_mapped_cov = true;
 }
 
+void ReadstatsDelta::add_matched(uint16_t index_num, int32_t count)
+{
+	if (reads_matched_per_db.size() <= index_num)
+		reads_matched_per_db.resize(index_num + 1, 0);
+	reads_matched_per_db[index_num] += count;
+}
+
+void ReadstatsDelta::apply(Readstats & readstats) const
+{
+	readstats.total_reads_aligned += total_reads_aligned;
+	readstats.total_reads_mapped_cov += total_reads_mapped_cov;
+	for (size_t i = 0; i < reads_matched_per_db.size() && i < readstats.reads_matched_per_db.size(); ++i)
+		readstats.reads_matched_per_db[i] += reads_matched_per_db[i];
+}
+
+void ReadstatsDelta::clear()
+{
+	total_reads_aligned = 0;
+	total_reads_mapped_cov = 0;
+	reads_matched_per_db.clear();
+}
+
 /**
  * restore Readstats object using values stored in Key-value database 
  */
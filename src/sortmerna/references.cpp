@@ -27,6 +27,8 @@ void References::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refst
 	num = idx_num;
 	part = idx_part;
 	uint32_t numseq_part = refstats.index_parts_stats_vec[idx_num][idx_part].numseq_part;
+	if (members_num != (int)idx_num)
+		load_members(idx_num, opts);
 
 	std::ifstream ifs(opts.indexfiles[idx_num].first, std::ios_base::in | std::ios_base::binary); // open reference file
 
@@ -174,6 +176,44 @@ int References::findref(std::string id)
 	return retpos;
 }
 
+/**
+ * load the '.members' file of the index (see 'find_members' in indexdb.cpp) if it exists:
+ *   representative id \t member id \t offset \t length
+ */
+void References::load_members(uint32_t idx_num, Runopts & opts)
+{
+	members.clear();
+	members_num = idx_num;
+
+	std::ifstream ifs(opts.indexfiles[idx_num].second + ".members");
+	std::string rep;
+	Member member;
+	while (ifs >> rep >> member.id >> member.offset >> member.len)
+		members[rep].push_back(member);
+} // ~References::load_members
+
+/**
+ * The alignment is reported for the reference itself, and for each of its members containing the alignment,
+ * at the position of the alignment on the member.
+ */
+std::vector<std::pair<std::string, uint32_t>> References::report_ids(uint32_t ref, uint32_t begin, uint32_t end)
+{
+	std::vector<std::pair<std::string, uint32_t>> ids(1, std::make_pair(buffer[ref].id, 0));
+	if (members.empty())
+		return ids;
+
+	auto it = members.find(buffer[ref].id);
+	if (it != members.end())
+	{
+		for (auto const& member : it->second)
+		{
+			if (begin >= member.offset && end < member.offset + member.len)
+				ids.push_back(std::make_pair(member.id, member.offset));
+		}
+	}
+	return ids;
+} // ~References::report_ids
+
 void References::clear()
 {
 	buffer.clear(); // TODO: is this enough?
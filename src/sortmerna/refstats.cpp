@@ -26,7 +26,8 @@ Refstats::Refstats(Runopts & opts, Readstats & readstats)
 	minimal_score(opts.indexfiles.size(), 0),
 	gumbel(opts.indexfiles.size(), std::pair<double, double>(-1.0, -1.0)),
 	numbvs(opts.indexfiles.size(), 0),
-	numseq(opts.indexfiles.size(), 0)
+	numseq(opts.indexfiles.size(), 0),
+	max_occur(opts.indexfiles.size(), 0)
 {
 	std::stringstream ss;
 	ss << STAMP << "Index Statistics calculation Start ...";
@@ -136,6 +137,20 @@ void Refstats::load(Runopts & opts, Readstats & readstats)
 
 		index_parts_stats_vec.push_back(hold);
 
+		// the masking threshold follows the sequence headers and the positions encoding (see build_index)
+		uint32_t num_sq = 0;
+		stats.read(reinterpret_cast<char*>(&num_sq), sizeof(uint32_t));
+		for (uint32_t j = 0; j < num_sq && stats; j++)
+		{
+			uint32_t len_id = 0;
+			stats.read(reinterpret_cast<char*>(&len_id), sizeof(uint32_t));
+			stats.seekg(len_id + sizeof(uint32_t), std::ios::cur);
+		}
+		uint32_t packed_pos = 0;
+		stats.read(reinterpret_cast<char*>(&packed_pos), sizeof(uint32_t));
+		if (!stats.read(reinterpret_cast<char*>(&max_occur[index_num]), sizeof(uint32_t)))
+			max_occur[index_num] = 0; // index built before the option 'mask_frac'
+
 		// Gumbel parameters
 		long **substitutionScoreMatrix = scoring_matrix;
 		long gapOpen1 = opts.gap_open;
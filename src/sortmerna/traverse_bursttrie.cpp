@@ -33,6 +33,12 @@
 
 #include <vector>
 #include <cstdint>
+#include <algorithm> // std::max
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BUCKET_SCAN_X86 // SIMD bucket scan kernels with runtime dispatch
+#include <immintrin.h>
+#endif
 
 #include "options.hpp"
 #include "traverse_bursttrie.hpp"
@@ -93,9 +99,437 @@ uint32_t table[4][16][14] = {
 	{{10, 14, 14, 14, 14, 14, 14, 14, 14, 10, 14, 14, 14, 14},
 	{10, 10, 14, 10, 14, 10, 14, 10, 14, 10, 14, 14, 10, 14}} };
 
-/*! @fn traversetrie_align() */
-void traversetrie_align(
-	NodeElement *trie_t,
+/*
+ * The automaton 'table' as bytes, each row padded with the failure state 14 up to 16 states, so that a row
+ * is a 16 byte shuffle table of the next states, indexed by the current state. The failure state is absorbing.
+ */
+struct LevRows
+{
+	alignas(16) uint8_t rows[4][16][16];
+
+	LevRows()
+	{
+		for (int t = 0; t < 4; ++t)
+			for (int bv = 0; bv < 16; ++bv)
+				for (int lev = 0; lev < 16; ++lev)
+					rows[t][bv][lev] = lev < 14 ? (uint8_t)table[t][bv][lev] : 14;
+	}
+};
+static const LevRows lev_rows;
+
+/*
+ * Scalar scan of the bucket entries [start_bucket, end_bucket) of a terminal trie node at 'depth'. The reference
+ * implementation of the bucket scan: the SIMD kernels must produce the same hits in the same order.
+ *
+ * @return true if a 0-error match was found and the search of the window stops (see accept_zero_kmer)
+ */
+template<uint32_t PARTIALWIN>
+static bool scan_bucket_scalar(
+	unsigned char *start_bucket,
+	unsigned char *end_bucket,
+	uint32_t depth,
+	uint32_t lev_t_bucket_pivot,
+	UCHAR *win_k1_ptr,
+	UCHAR *win_k1_full,
+	bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits,
+	uint32_t win_num,
+	uint32_t partialwin,
+	Runopts & opts
+)
+{
+	if (PARTIALWIN > 0) partialwin = PARTIALWIN;
+
+	// number of characters per entry
+	uint32_t s = partialwin - depth;
+
+	while (start_bucket != end_bucket)
+	{
+		uint32_t depth_b = depth;
+		uint32_t lev_t = lev_t_bucket_pivot;
+		bool local_accept_kmer = false;
+		uint32_t entry_str = *((uint32_t*)start_bucket);
+
+		// for each nt in the string
+		for (uint32_t j = 0; j < s; j++)
+		{
+			uint32_t nt = entry_str & 3;
+
+			depth_b++;
+
+			// get bitvector for letter
+			if (depth_b < partialwin - 2)
+			{
+				// send bv to LEV(_k)
+				lev_t = table[0][(int)*(win_k1_ptr + (depth_b << 2) + nt)][(int)(lev_t)];
+			}
+			else
+			{
+				lev_t = table[3 - partialwin + depth_b][(int)(*(win_k1_full + nt) & ((2 << (partialwin - depth_b)) - 1))][(int)(lev_t)];
+			}
+
+			// if the target lev_t state is a failure state, go to the next bucket element (tail)
+			if (lev_t == 14) break;
+
+			// approaching end of tail
+			if (depth_b >= partialwin - 2)
+			{
+				// 1-error match
+				if (lev_t >= 8)
+				{
+					local_accept_kmer = true;
+				}
+				// 0-error match
+				if (depth_b == partialwin - 1)
+				{
+					if (lev_t == 9)
+					{
+						accept_zero_kmer = true;
+
+						// turn off heuristic to stop search after finding 0-error match
+						if (opts.is_full_search) accept_zero_kmer = false;
+					}
+				}
+			}//~last 3 characters in entry
+
+			if (local_accept_kmer)
+			{
+				id_win entry = { 0,0 };
+				entry.id = *((uint32_t*)start_bucket + 1);
+				entry.win = win_num;
+
+				// empty id_hits array, add 0-error id and exit
+				if (accept_zero_kmer)
+				{
+					id_hits.clear();
+					id_hits.push_back(entry);
+
+					return true;
+				}
+
+				// exact match not found, do not include duplicates of 1-error match (for the same window on read)
+				if (!id_hits.empty())
+				{
+					bool found = false;
+					for (uint32_t f = 0; f < id_hits.size(); f++)
+					{
+						if (id_hits[f].id == entry.id)
+						{
+							found = true;
+							break;
+						}
+					}
+					if (found) break;
+				}
+
+				id_hits.push_back(entry);
+
+			}
+			entry_str >>= 2;
+		}//~for each 2 bits
+
+		// next entry
+		start_bucket += ENTRYSIZE;
+	}//~for each entry
+
+
+	return false;
+} // ~scan_bucket_scalar
+
+static const uint32_t MAX_PARTIALWIN = 13; // L <= 26 (see Runopts::opt_L)
+
+static const uint8_t BUCKET_ACCEPT = 1; // the entry is a 1-error match
+static const uint8_t BUCKET_ZERO = 2; // the entry is a 0-error match
+
+/*
+ * Add the id of a bucket entry to the window hits given the flags computed by a SIMD kernel for the entry,
+ * in the same way as the scalar scan.
+ *
+ * @return true if a 0-error match was found and the search of the window stops
+ */
+static bool add_bucket_hit(unsigned char *entry_ptr, uint8_t flags, bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits, uint32_t win_num, Runopts & opts)
+{
+	if (!(flags & BUCKET_ACCEPT))
+		return false;
+
+	id_win entry(*((uint32_t*)entry_ptr + 1), win_num);
+
+	// empty id_hits array, add 0-error id and exit
+	if ((flags & BUCKET_ZERO) && !opts.is_full_search)
+	{
+		accept_zero_kmer = true;
+		id_hits.clear();
+		id_hits.push_back(entry);
+		return true;
+	}
+
+	// do not include duplicates of 1-error match (for the same window on read)
+	for (auto const& hit : id_hits)
+	{
+		if (hit.id == entry.id)
+			return false;
+	}
+	id_hits.push_back(entry);
+	return false;
+} // ~add_bucket_hit
+
+/*
+ * SIMD bucket scan kernels. A kernel advances the automaton states of a group of 16 (SSE4.1) or 32 (AVX2) bucket
+ * entries at once: the next states of all the entries at a step are looked up with byte shuffles in the 4 table
+ * rows of the step (one per nucleotide), and selected by the entry nucleotide.
+ *
+ * @param bucket       first entry of the groups
+ * @param num_groups   number of groups of entries to scan
+ * @param rows         rows[j][nt] - table row of the nucleotide 'nt' at the step 'j' i.e. at depth + 1 + j
+ * @param s            number of characters per entry
+ * @param step_accept  first step an accepting state is a 1-error match
+ * @param step_zero    step an accepting state 9 is a 0-error match, or -1
+ * @param lev0         initial automaton state
+ * @param flags        BUCKET_ACCEPT | BUCKET_ZERO for each entry of the groups
+ */
+typedef void(*bucket_scan_fn)(const unsigned char *bucket, uint32_t num_groups, const uint8_t *(*rows)[4],
+	int32_t s, int32_t step_accept, int32_t step_zero, uint8_t lev0, uint8_t *flags);
+
+#if defined(BUCKET_SCAN_X86)
+__attribute__((target("sse4.1")))
+static void scan_groups_sse41(const unsigned char *bucket, uint32_t num_groups, const uint8_t *(*rows)[4],
+	int32_t s, int32_t step_accept, int32_t step_zero, uint8_t lev0, uint8_t *flags)
+{
+	const __m128i three = _mm_set1_epi32(3);
+	const __m128i one8 = _mm_set1_epi8(1);
+	const __m128i two8 = _mm_set1_epi8(2);
+	const __m128i seven8 = _mm_set1_epi8(7);
+	const __m128i nine8 = _mm_set1_epi8(9);
+	const __m128i fail8 = _mm_set1_epi8(14);
+
+	for (uint32_t g = 0; g < num_groups; ++g, bucket += 16 * ENTRYSIZE, flags += 16)
+	{
+		// the entry strings i.e. the first word of each entry
+		__m128i w[4];
+		for (int q = 0; q < 4; ++q)
+		{
+			__m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(bucket + q * 4 * ENTRYSIZE)));
+			__m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(bucket + q * 4 * ENTRYSIZE + 16)));
+			w[q] = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+
+		__m128i lev = _mm_set1_epi8((char)lev0);
+		__m128i accept = _mm_setzero_si128();
+		__m128i zero = _mm_setzero_si128();
+		for (int32_t j = 0; j < s; ++j)
+		{
+			__m128i nt = _mm_packus_epi16(
+				_mm_packus_epi32(_mm_and_si128(w[0], three), _mm_and_si128(w[1], three)),
+				_mm_packus_epi32(_mm_and_si128(w[2], three), _mm_and_si128(w[3], three)));
+			for (int q = 0; q < 4; ++q)
+				w[q] = _mm_srli_epi32(w[q], 2);
+
+			__m128i is_odd = _mm_cmpeq_epi8(_mm_and_si128(nt, one8), one8);
+			__m128i is_hi = _mm_cmpeq_epi8(_mm_and_si128(nt, two8), two8);
+			__m128i lev_lo = _mm_blendv_epi8(
+				_mm_shuffle_epi8(_mm_load_si128((const __m128i*)rows[j][0]), lev),
+				_mm_shuffle_epi8(_mm_load_si128((const __m128i*)rows[j][1]), lev), is_odd);
+			__m128i lev_hi = _mm_blendv_epi8(
+				_mm_shuffle_epi8(_mm_load_si128((const __m128i*)rows[j][2]), lev),
+				_mm_shuffle_epi8(_mm_load_si128((const __m128i*)rows[j][3]), lev), is_odd);
+			lev = _mm_blendv_epi8(lev_lo, lev_hi, is_hi);
+
+			__m128i is_fail = _mm_cmpeq_epi8(lev, fail8);
+			if (j >= step_accept)
+				accept = _mm_or_si128(accept, _mm_andnot_si128(is_fail, _mm_cmpgt_epi8(lev, seven8)));
+			if (j == step_zero)
+				zero = _mm_cmpeq_epi8(lev, nine8);
+			if (_mm_movemask_epi8(is_fail) == 0xFFFF)
+				break; // all the entries failed
+		}
+		_mm_storeu_si128((__m128i*)flags, _mm_or_si128(_mm_and_si128(accept, one8), _mm_and_si128(zero, two8)));
+	}
+} // ~scan_groups_sse41
+
+__attribute__((target("avx2")))
+static void scan_groups_avx2(const unsigned char *bucket, uint32_t num_groups, const uint8_t *(*rows)[4],
+	int32_t s, int32_t step_accept, int32_t step_zero, uint8_t lev0, uint8_t *flags)
+{
+	const __m256i three = _mm256_set1_epi32(3);
+	const __m256i one8 = _mm256_set1_epi8(1);
+	const __m256i two8 = _mm256_set1_epi8(2);
+	const __m256i seven8 = _mm256_set1_epi8(7);
+	const __m256i nine8 = _mm256_set1_epi8(9);
+	const __m256i fail8 = _mm256_set1_epi8(14);
+	// the packs work within the 128 bit lanes: the words of the entries are put in order before the packs,
+	// and the resulting groups of 4 entries after them
+	const __m256i words_order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+	const __m256i quads_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (uint32_t g = 0; g < num_groups; ++g, bucket += 32 * ENTRYSIZE, flags += 32)
+	{
+		__m256i w[4];
+		for (int q = 0; q < 4; ++q)
+		{
+			__m256 a = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(bucket + q * 8 * ENTRYSIZE)));
+			__m256 b = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(bucket + q * 8 * ENTRYSIZE + 32)));
+			w[q] = _mm256_permutevar8x32_epi32(_mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), words_order);
+		}
+
+		__m256i lev = _mm256_set1_epi8((char)lev0);
+		__m256i accept = _mm256_setzero_si256();
+		__m256i zero = _mm256_setzero_si256();
+		for (int32_t j = 0; j < s; ++j)
+		{
+			__m256i nt = _mm256_packus_epi16(
+				_mm256_packus_epi32(_mm256_and_si256(w[0], three), _mm256_and_si256(w[1], three)),
+				_mm256_packus_epi32(_mm256_and_si256(w[2], three), _mm256_and_si256(w[3], three)));
+			for (int q = 0; q < 4; ++q)
+				w[q] = _mm256_srli_epi32(w[q], 2);
+
+			__m256i is_odd = _mm256_cmpeq_epi8(_mm256_and_si256(nt, one8), one8);
+			__m256i is_hi = _mm256_cmpeq_epi8(_mm256_and_si256(nt, two8), two8);
+			__m256i lev_lo = _mm256_blendv_epi8(
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)rows[j][0])), lev),
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)rows[j][1])), lev), is_odd);
+			__m256i lev_hi = _mm256_blendv_epi8(
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)rows[j][2])), lev),
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)rows[j][3])), lev), is_odd);
+			lev = _mm256_blendv_epi8(lev_lo, lev_hi, is_hi);
+
+			__m256i is_fail = _mm256_cmpeq_epi8(lev, fail8);
+			if (j >= step_accept)
+				accept = _mm256_or_si256(accept, _mm256_andnot_si256(is_fail, _mm256_cmpgt_epi8(lev, seven8)));
+			if (j == step_zero)
+				zero = _mm256_cmpeq_epi8(lev, nine8);
+			if (_mm256_movemask_epi8(is_fail) == -1)
+				break; // all the entries failed
+		}
+		__m256i res = _mm256_or_si256(_mm256_and_si256(accept, one8), _mm256_and_si256(zero, two8));
+		_mm256_storeu_si256((__m256i*)flags, _mm256_permutevar8x32_epi32(res, quads_order));
+	}
+} // ~scan_groups_avx2
+#endif // BUCKET_SCAN_X86
+
+static BucketScan best_bucket_scan()
+{
+#if defined(BUCKET_SCAN_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return BucketScan::AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return BucketScan::SSE41;
+#endif
+	return BucketScan::SCALAR;
+}
+
+static BucketScan bucket_scan_isa = best_bucket_scan();
+
+BucketScan get_bucket_scan()
+{
+	return bucket_scan_isa;
+}
+
+bool set_bucket_scan(BucketScan isa)
+{
+	if (isa > best_bucket_scan())
+		return false;
+	bucket_scan_isa = isa;
+	return true;
+}
+
+std::string bucket_scan_name(BucketScan isa)
+{
+	switch (isa)
+	{
+	case BucketScan::SSE41: return "sse4.1";
+	case BucketScan::AVX2: return "avx2";
+	default: return "scalar";
+	}
+}
+
+/*
+ * Scan the bucket entries [start_bucket, end_bucket) of a terminal trie node at 'depth' with the selected kernel
+ * (see set_bucket_scan). The buckets smaller than a group of entries, and the tails of the larger ones, are scanned
+ * with the scalar reference.
+ *
+ * @return true if a 0-error match was found and the search of the window stops (see accept_zero_kmer)
+ */
+template<uint32_t PARTIALWIN>
+static bool scan_bucket(
+	unsigned char *start_bucket,
+	unsigned char *end_bucket,
+	uint32_t depth,
+	uint32_t lev_t_bucket_pivot,
+	UCHAR *win_k1_ptr,
+	UCHAR *win_k1_full,
+	bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits,
+	uint32_t win_num,
+	uint32_t partialwin,
+	Runopts & opts
+)
+{
+	if (PARTIALWIN > 0) partialwin = PARTIALWIN;
+
+	bucket_scan_fn scan_groups = nullptr;
+	uint32_t group_size = 0;
+#if defined(BUCKET_SCAN_X86)
+	if (bucket_scan_isa == BucketScan::AVX2)
+	{
+		scan_groups = scan_groups_avx2;
+		group_size = 32;
+	}
+	else if (bucket_scan_isa == BucketScan::SSE41)
+	{
+		scan_groups = scan_groups_sse41;
+		group_size = 16;
+	}
+#endif
+	uint32_t num_entries = (uint32_t)((end_bucket - start_bucket) / ENTRYSIZE);
+
+	if (scan_groups && num_entries >= group_size)
+	{
+		// the table rows of each step of the entries
+		const int32_t s = partialwin - depth;
+		const uint8_t *rows[16][4];
+		for (int32_t j = 0; j < s; ++j)
+		{
+			uint32_t depth_b = depth + 1 + j;
+			for (uint32_t nt = 0; nt < 4; ++nt)
+			{
+				if (depth_b < partialwin - 2)
+					rows[j][nt] = lev_rows.rows[0][*(win_k1_ptr + (depth_b << 2) + nt)];
+				else
+					rows[j][nt] = lev_rows.rows[3 - partialwin + depth_b][*(win_k1_full + nt) & ((2 << (partialwin - depth_b)) - 1)];
+			}
+		}
+		int32_t step_accept = std::max<int32_t>((int32_t)partialwin - 2 - (int32_t)(depth + 1), 0);
+		int32_t step_zero = (int32_t)partialwin - 1 - (int32_t)(depth + 1);
+
+		const uint32_t MAX_GROUPS = 8; // entries scanned before their hits are added
+		uint8_t flags[32 * MAX_GROUPS];
+		while (num_entries >= group_size)
+		{
+			uint32_t num_groups = std::min(num_entries / group_size, MAX_GROUPS);
+			scan_groups(start_bucket, num_groups, rows, s, step_accept, step_zero, (uint8_t)lev_t_bucket_pivot, flags);
+			for (uint32_t i = 0; i < num_groups * group_size; ++i, start_bucket += ENTRYSIZE)
+			{
+				if (flags[i] && add_bucket_hit(start_bucket, flags[i], accept_zero_kmer, id_hits, win_num, opts))
+					return true;
+			}
+			num_entries -= num_groups * group_size;
+		}
+	}
+
+	return scan_bucket_scalar<PARTIALWIN>(start_bucket, end_bucket, depth, lev_t_bucket_pivot, win_k1_ptr, win_k1_full,
+		accept_zero_kmer, id_hits, win_num, partialwin, opts);
+} // ~scan_bucket
+
+/*
+ * traversetrie_align with the half window length PARTIALWIN known at compile time, or given by 'partialwin'
+ * if PARTIALWIN = 0 (see search_window)
+ */
+template<uint32_t PARTIALWIN>
+static void traversetrie_align(
+	TrieNode *trie_t,
+	TrieNode *root,
 	uint32_t lev_t,
 	unsigned char depth,
 	UCHAR *win_k1_ptr,
@@ -108,6 +542,8 @@ void traversetrie_align(
 	Runopts & opts
 )
 {
+	if (PARTIALWIN > 0) partialwin = PARTIALWIN;
+
 	uint16_t lev_t_trie_pivot = lev_t;
 	unsigned char value = 0;
 
@@ -149,7 +585,8 @@ void traversetrie_align(
 				// (1) the node element holds a pointer to another trie node
 				if (value == 1)
 				{
-					traversetrie_align(trie_t->nodetype.trie,
+					traversetrie_align<PARTIALWIN>(trie_t->trie(root),
+						root,
 						lev_t,
 						++depth,
 						win_k1_ptr,
@@ -179,10 +616,7 @@ void traversetrie_align(
 					//  initial input state
 					uint32_t lev_t_bucket_pivot = lev_t;
 
-					// number of characters per entry
-					uint32_t s = partialwin - depth;
-
-					unsigned char* start_bucket = (unsigned char*)trie_t->nodetype.bucket;
+					unsigned char* start_bucket = trie_t->bucket(root);
 					if (start_bucket == NULL)
 					{
 						fprintf(stderr, "  ERROR: pointer start_bucket == NULL (paralleltraversal.cpp)\n");
@@ -196,94 +630,9 @@ void traversetrie_align(
 					}
 
 					// traverse the bucket
-					while (start_bucket != end_bucket)
-					{
-						uint32_t depth_b = depth;
-						lev_t = lev_t_bucket_pivot;
-						bool local_accept_kmer = false;
-						uint32_t entry_str = *((uint32_t*)start_bucket);
-
-						// for each nt in the string
-						for (uint32_t j = 0; j < s; j++)
-						{
-							uint32_t nt = entry_str & 3;
-
-							depth_b++;
-
-							// get bitvector for letter
-							if (depth_b < partialwin - 2)
-							{
-								// send bv to LEV(_k)
-								lev_t = table[0][(int)*(win_k1_ptr + (depth_b << 2) + nt)][(int)(lev_t)];
-							}
-							else
-							{
-								lev_t = table[3 - partialwin + depth_b][(int)(*(win_k1_full + nt) & ((2 << (partialwin - depth_b)) - 1))][(int)(lev_t)];
-							}
-
-							// if the target lev_t state is a failure state, go to the next bucket element (tail)
-							if (lev_t == 14) break;
-
-							// approaching end of tail
-							if (depth_b >= partialwin - 2)
-							{
-								// 1-error match
-								if (lev_t >= 8)
-								{
-									local_accept_kmer = true;
-								}
-								// 0-error match
-								if (depth_b == partialwin - 1)
-								{
-									if (lev_t == 9)
-									{
-										accept_zero_kmer = true;
-
-										// turn off heuristic to stop search after finding 0-error match
-										if (opts.is_full_search) accept_zero_kmer = false;
-									}
-								}
-							}//~last 3 characters in entry
-
-							if (local_accept_kmer)
-							{
-								id_win entry = { 0,0 };
-								entry.id = *((uint32_t*)start_bucket + 1);
-								entry.win = win_num;
-
-								// empty id_hits array, add 0-error id and exit
-								if (accept_zero_kmer)
-								{
-									id_hits.clear();
-									id_hits.push_back(entry);
-
-									return;
-								}
-
-								// exact match not found, do not include duplicates of 1-error match (for the same window on read)
-								if (!id_hits.empty())
-								{
-									bool found = false;
-									for (uint32_t f = 0; f < id_hits.size(); f++)
-									{
-										if (id_hits[f].id == entry.id)
-										{
-											found = true;
-											break;
-										}
-									}
-									if (found) break;
-								}
-
-								id_hits.push_back(entry);
-
-							}
-							entry_str >>= 2;
-						}//~for each 2 bits
-
-						// next entry
-						start_bucket += ENTRYSIZE;
-					}//~for each entry
+					if (scan_bucket<PARTIALWIN>(start_bucket, end_bucket, depth, lev_t_bucket_pivot, win_k1_ptr, win_k1_full,
+						accept_zero_kmer, id_hits, win_num, partialwin, opts))
+						return;
 
 					lev_t = lev_t_trie_pivot;
 					trie_t++;
@@ -296,18 +645,124 @@ void traversetrie_align(
 	return;
 }//~traversetrie_align()
 
+/*! @fn traversetrie_align() */
+void traversetrie_align(
+	TrieNode *trie_t,
+	TrieNode *root,
+	uint32_t lev_t,
+	unsigned char depth,
+	UCHAR *win_k1_ptr,
+	UCHAR *win_k1_full,
+	bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits,
+	uint32_t win_num,
+	uint32_t partialwin,
+	Runopts & opts
+)
+{
+	if (partialwin == 9)
+		traversetrie_align<9>(trie_t, root, lev_t, depth, win_k1_ptr, win_k1_full, accept_zero_kmer, id_hits, win_num, partialwin, opts);
+	else
+		traversetrie_align<0>(trie_t, root, lev_t, depth, win_k1_ptr, win_k1_full, accept_zero_kmer, id_hits, win_num, partialwin, opts);
+} // ~traversetrie_align
+
+/*
+ * search_window with the half window length PARTIALWIN known at compile time: the bitvectors are a fixed size
+ * array on the stack, and the bitvector and automaton loops are specialised for it. PARTIALWIN = 0 is the
+ * generic version for any 'partialwin'.
+ */
+template<uint32_t PARTIALWIN>
+static void search_window(
+	Index &index,
+	char *iseq,
+	uint32_t win_pos,
+	uint32_t keyf,
+	uint32_t keyr,
+	uint32_t partialwin,
+	bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits,
+	Runopts &opts
+)
+{
+	if (PARTIALWIN > 0) partialwin = PARTIALWIN;
+
+	const int NUMBVS = PARTIALWIN > 0 ? 4 * ((int)PARTIALWIN - 3) : 0;
+	int numbvs = 4 * ((int)partialwin - 3);
+	uint32_t bitvec_size = (partialwin - 2) << 2; // e.g. 9 - 2 = 0000 0111 << 2 = 0001 1100 = 28
+	uint32_t offset = (partialwin - 3) << 2; // e.g. 9 - 3 = 0000 0110 << 2 = 0001 1000 = 24
+	UCHAR bitvec[(MAX_PARTIALWIN - 2) << 2]; // window (prefix/suffix) bitvector
+
+	// do traversal if the exact half window exists in the burst trie
+	if (index.lookup_tbl[keyf].count > opts.minoccur && index.lookup_tbl[keyf].trie_F != NO_TRIE)
+	{
+		/* subsearch (1)(a) d([p_1],[w_1]) = 0 and d([p_2],[w_2]) <= 1;
+		*
+		*  w = |------ [w_1] ------|------ [w_2] ------|
+		*  p = |------ [p_1] ------|------ [p_2] ----| (0/1 deletion in [p_2])
+		*              or
+		*    = |------ [p_1] ------|------ [p_2] ------| (0/1 match/substitution in [p_2])
+		*        or
+		*    = |------ [p_1] ------|------ [p_2] --------| (0/1 insertion in [p_2])
+		*
+		*/
+		std::fill_n(bitvec, bitvec_size, 0);
+		init_win<NUMBVS, 1>(iseq + win_pos + partialwin, &bitvec[0], &bitvec[4], numbvs);
+		traversetrie_align<PARTIALWIN>(index.trie_F(keyf), index.trie_F(keyf), 0, 0, &bitvec[0], &bitvec[offset],
+			accept_zero_kmer, id_hits, win_pos, partialwin, opts);
+	}
+
+	// only search reversed kmer if an exact match has not been found for the forward
+	if (!accept_zero_kmer && index.lookup_tbl[keyr].count > opts.minoccur && index.lookup_tbl[keyr].trie_R != NO_TRIE)
+	{
+		/* subsearch (1)(b) d([p_1],[w_1]) = 1 and d([p_2],[w_2]) = 0;
+		*
+		*  w =    |------ [w_1] ------|------ [w_2] -------|
+		*  p =      |------- [p_1] ---|--------- [p_2] ----| (1 deletion in [p_1])
+		*              or
+		*    =    |------ [p_1] ------|------ [p_2] -------| (1 match/substitution in [p_1])
+		*        or
+		*    = |------- [p_1] --------|---- [p_2] ---------| (1 insertion in [p_1])
+		*
+		*/
+		std::fill_n(bitvec, bitvec_size, 0);
+		init_win<NUMBVS, -1>(iseq + win_pos + partialwin - 1, &bitvec[0], &bitvec[4], numbvs);
+		traversetrie_align<PARTIALWIN>(index.trie_R(keyr), index.trie_R(keyr), 0, 0, &bitvec[0], &bitvec[offset],
+			accept_zero_kmer, id_hits, win_pos, partialwin, opts);
+	}
+} // ~search_window
+
+void search_window(
+	Index &index,
+	char *iseq,
+	uint32_t win_pos,
+	uint32_t keyf,
+	uint32_t keyr,
+	uint32_t partialwin,
+	bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits,
+	Runopts &opts
+)
+{
+	// the default L = 18 is specialised
+	if (partialwin == 9)
+		search_window<9>(index, iseq, win_pos, keyf, keyr, partialwin, accept_zero_kmer, id_hits, opts);
+	else
+		search_window<0>(index, iseq, win_pos, keyf, keyr, partialwin, accept_zero_kmer, id_hits, opts);
+} // ~search_window
+
 
 #ifdef see_binary_output
 /*
  *
  * @function traversetrie: collect statistics on the mini-burst trie,
  * its size, number of trie nodes vs. buckets
- * @param NodeElement* trie_node
+ * @param TrieNode* trie_node
+ * @param TrieNode* root: root node of the trie
  * @return void
  * @version 1.0 Jan 14, 2013
  *
  *******************************************************************/
-void traversetrie_debug(NodeElement* trie_node, uint32_t depth, uint32_t &total_entries, string &kmer_keep, uint32_t partialwin)
+void traversetrie_debug(TrieNode* trie_node, TrieNode* root, uint32_t depth, uint32_t &total_entries, string &kmer_keep, uint32_t partialwin)
 {
 	char get_char[4] = { 'A','C','G','T' };
 
@@ -320,7 +775,7 @@ void traversetrie_debug(NodeElement* trie_node, uint32_t depth, uint32_t &total_
 		if (value == 1)
 		{
 			kmer_keep.push_back((char)get_char[i]); //TESTING
-			traversetrie_debug(trie_node->nodetype.trie, ++depth, total_entries, kmer_keep, partialwin);
+			traversetrie_debug(trie_node->trie(root), root, ++depth, total_entries, kmer_keep, partialwin);
 			kmer_keep.pop_back();
 			--depth;
 		}
@@ -330,7 +785,7 @@ void traversetrie_debug(NodeElement* trie_node, uint32_t depth, uint32_t &total_
 		{
 			kmer_keep.push_back((char)get_char[i]); //TESTING
 
-			unsigned char* start_bucket = (unsigned char*)trie_node->nodetype.bucket;
+			unsigned char* start_bucket = trie_node->bucket(root);
 			if (start_bucket == NULL)
 			{
 				fprintf(stderr, "  ERROR: pointer start_bucket == NULL (paralleltraversal.cpp)\n");
@@ -31,6 +31,17 @@ int clear_dir(std::string dpath);
 bool dirExists(std::string dpath);
 std::string get_user_home();
 std::streampos filesize(const std::string &file);
+/* FNV-1a. The same in all the processes and the builds, unlike std::hash i.e. can be stored in the files. */
+uint64_t fnv1a(const char* data, size_t len, uint64_t hash)
+{
+	for (size_t i = 0; i < len; ++i)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+} // ~fnv1a
+
 std::string to_lower(std::string& val);
 
 unsigned int check_dir(std::string dpath)
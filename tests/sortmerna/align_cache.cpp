@@ -0,0 +1,77 @@
+/*
+ * FILE: align_cache.cpp
+ * Created: Oct 18, 2026 Sun
+ */
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+#include "align_cache.hpp"
+
+/**
+ * Case 5
+ * A record torn by a crash is cut off by the next insert: the entries inserted after it are found by a new
+ * AlignmentCache, and so are the entries inserted before it.
+ */
+void align_cache_torn()
+{
+	auto dir = std::filesystem::temp_directory_path() / "sortmerna_test_align_cache";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	std::string ref = (dir / "ref.fasta").string();
+	{
+		std::ofstream ofs(ref, std::ios::binary);
+		ofs << ">a\nACGTACGTACGTACGTACGTACGT\n";
+	}
+	auto cache_dir = dir / "cache";
+
+	std::vector<std::string> args = { "tests", "--ref", ref, "--workdir", dir.string(), "--align_cache", cache_dir.string() };
+	std::vector<char*> argv;
+	for (auto &arg : args)
+		argv.push_back(&arg[0]);
+	Runopts opts((int)argv.size(), argv.data(), false);
+
+	const int NUM_KEYS = 1000; // i.e. in all the shards
+	{
+		AlignmentCache cache(opts);
+		for (int i = 0; i < NUM_KEYS; ++i)
+			cache.insert("before" + std::to_string(i), "val" + std::to_string(i));
+	}
+
+	// a crash while appending: the header of a record, and a part of its key
+	for (uint32_t shard_num = 0; shard_num < AlignmentCache::NUM_SHARDS; ++shard_num)
+	{
+		std::ofstream ofs(cache_dir / ("shard_" + std::to_string(shard_num) + ".dat"), std::ios::binary | std::ios::app);
+		uint32_t key_len = 100, val_len = 10;
+		uint64_t check = 0;
+		ofs.write(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
+		ofs.write(reinterpret_cast<const char*>(&val_len), sizeof(val_len));
+		ofs.write(reinterpret_cast<const char*>(&check), sizeof(check));
+		ofs << "torn";
+	}
+
+	{
+		AlignmentCache cache(opts);
+		for (int i = 0; i < NUM_KEYS; ++i)
+			cache.insert("after" + std::to_string(i), "val" + std::to_string(i));
+	}
+
+	AlignmentCache cache(opts);
+	for (auto prefix : { "before", "after" })
+	{
+		for (int i = 0; i < NUM_KEYS; ++i)
+		{
+			std::string val;
+			if (!cache.find(prefix + std::to_string(i), val) || val != "val" + std::to_string(i))
+			{
+				std::cerr << "The entry '" << prefix << i << "' is not found in the alignment cache" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	std::filesystem::remove_all(dir);
+} // ~align_cache_torn
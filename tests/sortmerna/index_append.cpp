@@ -0,0 +1,101 @@
+/*
+ * FILE: index_append.cpp
+ * Created: Oct 18, 2026 Sun
+ */
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "options.hpp"
+#include "index.hpp"
+
+/* build, or append to, the index of the reference in 'dir' the same way as 'sortmerna --ref REF --workdir DIR --index_append' */
+static void index_ref(const std::string &ref, const std::string &dir)
+{
+	std::vector<std::string> args = { "tests", "--ref", ref, "--workdir", dir, "--index_append" };
+	std::vector<char*> argv;
+	for (auto &arg : args)
+		argv.push_back(&arg[0]);
+	Runopts opts((int)argv.size(), argv.data(), false);
+	Index index(opts);
+}
+
+/* pseudo-random reference sequences, the same on each run */
+static void write_ref(std::ofstream &ofs, int first, int num, uint32_t &seed)
+{
+	for (int i = first; i < first + num; ++i)
+	{
+		ofs << ">seq" << i << "\n";
+		for (int j = 0; j < 300; ++j)
+		{
+			seed = seed * 1103515245 + 12345;
+			ofs << "ACGT"[(seed >> 16) & 3];
+		}
+		ofs << "\n";
+	}
+}
+
+/**
+ * Case 3
+ * Indexing the sequences appended to the reference file fails if the indexed sequences were modified.
+ */
+void index_append_modified()
+{
+	auto dir = std::filesystem::temp_directory_path() / "sortmerna_test_index_append";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	std::string ref = (dir / "ref.fasta").string();
+	uint32_t seed = 1;
+
+	{
+		std::ofstream ofs(ref, std::ios::binary);
+		write_ref(ofs, 0, 5, seed);
+	}
+	index_ref(ref, dir.string());
+
+	// appended sequences are indexed
+	{
+		std::ofstream ofs(ref, std::ios::binary | std::ios::app);
+		write_ref(ofs, 5, 5, seed);
+	}
+	index_ref(ref, dir.string());
+
+	// one nucleotide of an indexed sequence is changed, and more sequences appended
+	{
+		std::fstream fs(ref, std::ios::binary | std::ios::in | std::ios::out);
+		fs.seekg(std::string(">seq0\n").size());
+		char nt = (char)fs.get();
+		fs.seekp(std::string(">seq0\n").size());
+		fs.put(nt == 'A' ? 'C' : 'A');
+	}
+	{
+		std::ofstream ofs(ref, std::ios::binary | std::ios::app);
+		write_ref(ofs, 10, 5, seed);
+	}
+
+#if !defined(_WIN32)
+	// the append exits with failure
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		index_ref(ref, dir.string());
+		_exit(EXIT_SUCCESS);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_FAILURE)
+	{
+		std::cerr << "Appending to the index of the modified reference did not fail" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+#endif
+
+	std::filesystem::remove_all(dir);
+} // ~index_append_modified
@@ -4,14 +4,41 @@
  */
 #include <iostream>
 #include <cassert>
+#include <filesystem>
 
 #include "kvdb.hpp"
 #include "options.hpp"
 
+/**
+ * Case 0
+ * Clearing a run removes only the records of that run. Records of the other runs sharing the DB are kept.
+ */
 void kvdb_clear()
 {
-	std::string dbpath = "C:/a01_projects/clarity_genomics/data/kvdb";
-	KeyValueDatabase kvdb(dbpath);
-	int ret = kvdb.clear(dbpath);
-	assert(ret == 0);
-}
\ No newline at end of file
+	std::string dbpath = (std::filesystem::temp_directory_path() / "sortmerna_test_kvdb").string();
+	std::filesystem::remove_all(dbpath); // left by an earlier run
+	{
+		KeyValueDatabase kvdb_a(dbpath, "run_a");
+		kvdb_a.put("0_1", "aaa");
+	}
+	{
+		KeyValueDatabase kvdb_b(dbpath, "run_b");
+		kvdb_b.put("0_1", "bbb");
+		assert(kvdb_b.get("0_1") == "bbb"); // same key, different run
+	}
+
+	{
+		KeyValueDatabase kvdb(dbpath, "run_a");
+		assert(kvdb.get("0_1") == "aaa");
+		int ret = kvdb.clear(dbpath);
+		assert(ret == 0);
+		assert(kvdb.get("0_1").empty());
+
+		ret = kvdb.drop("run_b");
+		assert(ret == 0);
+		auto runs = kvdb.list_runs();
+		assert(runs.size() == 1 && runs[0] == "run_a");
+	}
+	std::filesystem::remove_all(dbpath);
+} // ~kvdb_clear
+
@@ -10,6 +10,11 @@
 
 // forward
 void kvdb_clear();
+void index_seed_search(int argc, char** argv);
+void index_append_modified();
+void minimizer_ids();
+void align_cache_torn();
+void read_kmer_keys();
 
 /**
  * Case 1
@@ -53,7 +58,7 @@ int main(int argc, char** argv)
 {
 	std::cout << STAMP << "Running with " << argc << " options" << std::endl;
 	//Runopts opts(argc, argv, false);
-	if (argc > 2)
+	if (argc > 1)
 	{
 		std::cout << "argv[0]: " << argv[0] << std::endl;
 		std::cout << "Case: " << argv[1] << std::endl;
@@ -74,6 +79,21 @@ int main(int argc, char** argv)
 				reader_nextread(filev);
 			}
 			break;
+		case 2:
+			index_seed_search(argc - 1, argv + 1); // skip the case
+			break;
+		case 3:
+			index_append_modified();
+			break;
+		case 4:
+			minimizer_ids();
+			break;
+		case 5:
+			align_cache_torn();
+			break;
+		case 6:
+			read_kmer_keys();
+			break;
 		default:
 			std::cout << "Unknown arg: " << scase << std::endl;
 		}
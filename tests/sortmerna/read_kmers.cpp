@@ -0,0 +1,125 @@
+/*
+ * FILE: read_kmers.cpp
+ * Created: Oct 18, 2026 Sun
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "common.hpp"
+#include "read.hpp"
+
+/* 'isequence' of the read on the given strand and in the given encoding, computed from the sequence */
+static std::string expected_iseq(Read &read, bool reversed, bool is03)
+{
+	std::string iseq(read.sequence.size(), 0);
+	for (size_t i = 0; i < iseq.size(); ++i)
+	{
+		char c = nt_table[(int)read.sequence[reversed ? iseq.size() - i - 1 : i]];
+		if (c == 4)
+			iseq[i] = is03 ? 0 : 4;
+		else
+			iseq[i] = reversed ? complement[(int)c] : c;
+	}
+	return iseq;
+}
+
+/* fail if the strands of the read are not those of its sequence */
+static void check_strands(Read &read, const std::string &step)
+{
+	if (read.isequence != expected_iseq(read, read.reversed, read.is03))
+	{
+		std::cerr << "Read: " << read.sequence << " after " << step << ": wrong sequence of the "
+			<< (read.reversed ? "reverse" : "forward") << " strand in " << (read.is03 ? "03" : "04") << " encoding" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (read.isequence_rc.size() == read.isequence.size()
+		&& read.isequence_rc != expected_iseq(read, !read.reversed, read.is03))
+	{
+		std::cerr << "Read: " << read.sequence << " after " << step << ": wrong cached sequence of the "
+			<< (read.reversed ? "forward" : "reverse") << " strand in " << (read.is03 ? "03" : "04") << " encoding" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * Case 6
+ * The strands and the look-up keys of the reads with ambiguous nucleotides stay consistent whatever the order
+ * of the strand switches (see Read::revIntStr), the encoding switches (see Read::flip34), and the key look-ups
+ * (see Read::kmerKeys): 'isequence' and its cached other strand are the reverse complement of each other, and the
+ * keys are the hashes of the kmers of the current strand (see Read::hashKmer).
+ * The reads start on the forward strand, or on the reverse strand without the cached forward one as the copies do.
+ */
+void read_kmer_keys()
+{
+	const char NT[5] = { 'A', 'C', 'G', 'T', 'N' };
+	std::mt19937 rng(1);
+
+	for (int n = 0; n < 10000; ++n)
+	{
+		Read read;
+		uint32_t len = 1 + rng() % 60;
+		for (uint32_t i = 0; i < len; ++i)
+			read.sequence.push_back(NT[rng() % 8 == 0 ? 4 : rng() % 4]);
+		read.isEmpty = false;
+		read.seqToIntStr();
+		check_strands(read, "seqToIntStr");
+
+		if (n % 2 == 1)
+		{
+			read.revIntStr();
+			if (rng() % 2) read.flip34();
+			read = Read(read); // the copy has no cached strand nor keys
+			check_strands(read, "copy");
+		}
+
+		for (int step = 0; step < 20; ++step)
+		{
+			switch (rng() % 3)
+			{
+			case 0:
+				read.revIntStr();
+				check_strands(read, "revIntStr");
+				break;
+			case 1:
+			{
+				bool is03 = read.is03;
+				read.flip34();
+				check_strands(read, "flip34");
+				if (read.is03 == is03 && !read.ambiguous_nt.empty())
+				{
+					std::cerr << "Read: " << read.sequence << " flip34 did not switch the encoding" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				break;
+			}
+			case 2:
+			{
+				if (read.is04) read.flip34(); // the keys are computed on 03 encoding
+				uint32_t klen = rng() % 2 ? 9 : 1 + rng() % 16;
+				auto const& keys = read.kmerKeys(klen);
+				check_strands(read, "kmerKeys");
+				size_t num_keys = read.isequence.size() < klen ? 0 : read.isequence.size() - klen + 1;
+				if (keys.size() != num_keys)
+				{
+					std::cerr << "Read: " << read.sequence << " has " << keys.size() << " keys of length " << klen
+						<< " instead of " << num_keys << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				for (uint32_t pos = 0; pos < num_keys; ++pos)
+				{
+					if (keys[pos] != read.hashKmer(pos, klen))
+					{
+						std::cerr << "Read: " << read.sequence << " on the " << (read.reversed ? "reverse" : "forward")
+							<< " strand: key of length " << klen << " at " << pos << ": " << keys[pos]
+							<< " differs from the kmer hash: " << read.hashKmer(pos, klen) << std::endl;
+						exit(EXIT_FAILURE);
+					}
+				}
+				break;
+			}
+			}
+		}
+	}
+} // ~read_kmer_keys
@@ -0,0 +1,334 @@
+/*
+ * FILE: seed_search.cpp
+ * Created: Oct 18, 2026 Sun
+ */
+#include <iostream>
+#include <fstream>
+#include <iomanip> // setprecision
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+#include "options.hpp"
+#include "kvdb.hpp"
+#include "readstats.hpp"
+#include "refstats.hpp"
+#include "index.hpp"
+#include "reader.hpp"
+#include "read.hpp"
+#include "bitvector.hpp"
+#include "traverse_bursttrie.hpp"
+#include "minimizer.hpp"
+
+// forward
+void prefetchSeeds(Runopts & opts, Index & index, Refstats & refstats,
+	std::vector<Read>::iterator first, std::vector<Read>::iterator last, std::vector<uint32_t> & keys); // paralleltraversal.cpp
+
+/* the hits of the searched windows in the search order: the hits of the window 'n' are hits[ends[n - 1], ends[n]) */
+struct WindowHits
+{
+	std::vector<id_win> hits;
+	std::vector<uint64_t> ends;
+
+	void clear() { hits.clear(); ends.clear(); }
+};
+
+/**
+ * Search all the seed windows of the reads in the loaded index part in the same way as 'paralleltraversal'
+ * (see search_window).
+ * The hits of the masked (L+1)-mers are dropped and counted in the index (see Refstats::max_occur).
+ * The reads are searched in batches of 'opts.seed_batch' reads, whose look-up table entries and trie roots
+ * of the first pass windows are prefetched first (see prefetchSeeds).
+ *
+ * @param reads   reads in 03 encoding, with their look-up keys computed (see Read::kmerKeys)
+ * @param windows number of searched windows
+ * @param window_hits  the hits of each searched window, before the masked ones are dropped
+ * @return        number of seed hits
+ */
+uint64_t seed_search(Runopts &opts, Refstats &refstats, Index &index, std::vector<Read> &reads, uint64_t &windows,
+	WindowHits &window_hits)
+{
+	uint32_t max_occur = refstats.max_occur[index.index_num];
+	uint32_t lnwin = refstats.lnwin[index.index_num];
+	uint32_t partialwin = refstats.partialwin[index.index_num];
+	size_t batch_size = std::max<uint32_t>(opts.seed_batch, 1);
+	std::vector<id_win> id_hits;
+	std::vector<uint32_t> keys;
+	uint64_t hits = 0;
+
+	for (auto first = reads.begin(); first != reads.end();)
+	{
+		auto last = first + std::min<size_t>(batch_size, reads.end() - first);
+		if (opts.seed_batch > 0)
+			prefetchSeeds(opts, index, refstats, first, last, keys);
+
+		for (; first != last; ++first)
+		{
+			Read &read = *first;
+			if (read.isequence.size() < lnwin) continue;
+			auto const& kmer_keys = read.kmerKeys(partialwin);
+
+			for (uint32_t win_pos = 0; win_pos + lnwin <= read.isequence.size(); ++win_pos)
+			{
+				bool accept_zero_kmer = false;
+				id_hits.clear();
+				search_window(index, &read.isequence[0], win_pos, kmer_keys[win_pos], kmer_keys[win_pos + partialwin], partialwin,
+					accept_zero_kmer, id_hits, opts);
+				window_hits.hits.insert(window_hits.hits.end(), id_hits.begin(), id_hits.end());
+				window_hits.ends.push_back(window_hits.hits.size());
+
+				for (auto const& hit : id_hits)
+				{
+					if (max_occur > 0)
+					{
+						uint32_t num_pos = index.num_positions(hit.id);
+						++index.seed_hits;
+						index.seed_positions += num_pos;
+						if (num_pos > max_occur)
+						{
+							++index.masked_hits;
+							index.masked_positions += num_pos;
+							continue;
+						}
+					}
+					++hits;
+				}
+				++windows;
+			}
+		}
+	}
+	return hits;
+} // ~seed_search
+
+/**
+ * Search the minimizers of the reads in the minimizer index of the loaded part in the same way as 'paralleltraversal'
+ * (see MinimizerIndex). The masked (L+1)-mers are dropped as in 'seed_search'.
+ *
+ * @param reads           reads in 03 encoding
+ * @param num_minimizers  number of searched minimizers
+ * @return                number of seed hits
+ */
+uint64_t minimizer_search(Refstats &refstats, Index &index, std::vector<Read> &reads, uint64_t &num_minimizers)
+{
+	uint32_t max_occur = refstats.max_occur[index.index_num];
+	uint64_t hits = 0;
+
+	for (auto &read : reads)
+	{
+		for_each_minimizer(read.isequence.data(), (uint32_t)read.isequence.size(), index.minimizers.k, index.minimizers.w,
+			[&](uint32_t, uint64_t code) {
+				++num_minimizers;
+				auto ids = index.minimizers.find(code);
+				for (auto id = ids.first; id != ids.second; ++id)
+				{
+					if (max_occur == 0 || index.num_positions(*id) <= max_occur)
+						++hits;
+				}
+			});
+	}
+	return hits;
+} // ~minimizer_search
+
+/**
+ * Case 2
+ * Seed search throughput: search all the seed windows of the reads in each part of the first index,
+ * and print the number of windows searched per second.
+ *
+ * tests 2 --ref REF --reads READS --workdir DIR [--seed_batch N] [--seed_engine minimizer]
+ *
+ * The reads are loaded into memory beforehand, so only the index look-ups and the burst trie traversals are timed.
+ * The search is run with each bucket scan kernel supported by the CPU (see BucketScan), and fails on the first
+ * window whose hits (ids and windows, in their order) of a SIMD kernel differ from the hits of the scalar one.
+ * With '--seed_engine minimizer' the minimizers of the reads are searched as well, and the reads searched per second
+ * of both engines are printed.
+ */
+void index_seed_search(int argc, char** argv)
+{
+	Runopts opts(argc, argv, false);
+	Index index(opts); // names the index files as in 'main'
+	KeyValueDatabase kvdb(opts.kvdbdir.string(), opts.run_fingerprint);
+	Readstats readstats(opts, kvdb);
+	Refstats refstats(opts, readstats);
+
+	std::vector<Read> reads;
+	for (auto const& rfile : opts.readfiles)
+	{
+		std::ifstream ifs(rfile, std::ios_base::in | std::ios_base::binary);
+		Reader reader("0", opts.is_gz);
+		std::string seq;
+		while (reader.nextread(ifs, rfile, seq))
+		{
+			Read read;
+			read.id = std::to_string(reads.size());
+			read.sequence = seq;
+			read.isEmpty = false;
+			read.init(opts); // 03 encoding. Ambiguous nucleotides are searched as 'A' (see Read::seqToIntStr)
+			reads.push_back(std::move(read));
+		}
+	}
+	std::cout << "Number of reads: " << reads.size() << std::endl;
+
+	// the look-up keys are computed before the search is timed, and are the hashes of the kmers at each position
+	uint32_t partialwin = refstats.partialwin[0];
+	for (auto &read : reads)
+	{
+		auto const& kmer_keys = read.kmerKeys(partialwin);
+		for (uint32_t pos = 0; pos + partialwin <= read.isequence.size(); ++pos)
+		{
+			if (kmer_keys[pos] != read.hashKmer(pos, partialwin))
+			{
+				std::cerr << "Read: " << read.id << " look-up key at " << pos << ": " << kmer_keys[pos]
+					<< " differs from the kmer hash: " << read.hashKmer(pos, partialwin) << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	for (uint16_t idx_part = 0; idx_part < refstats.num_index_parts[0]; ++idx_part)
+	{
+		index.load(0, idx_part, opts, refstats);
+
+		WindowHits ref_hits; // of the scalar scan
+		WindowHits isa_hits;
+		for (auto isa : { BucketScan::SCALAR, BucketScan::SSE41, BucketScan::AVX2 })
+		{
+			if (!set_bucket_scan(isa))
+				continue;
+			index.seed_hits = index.masked_hits = index.seed_positions = index.masked_positions = 0;
+			auto &window_hits = isa == BucketScan::SCALAR ? ref_hits : isa_hits;
+			window_hits.clear();
+
+			uint64_t windows = 0;
+			auto starts = std::chrono::high_resolution_clock::now();
+			uint64_t hits = seed_search(opts, refstats, index, reads, windows, window_hits);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - starts;
+
+			std::cout << "Index part: " << idx_part << " bucket scan: " << bucket_scan_name(isa)
+				<< " windows: " << windows << " hits: " << hits
+				<< " time: [" << std::setprecision(2) << std::fixed << elapsed.count() << "] sec"
+				<< " windows/sec: " << std::setprecision(0) << windows / elapsed.count() << std::endl;
+			if (refstats.max_occur[0] > 0)
+				std::cout << "Masked: " << index.masked_hits << " of " << index.seed_hits << " hits, "
+					<< index.masked_positions << " of " << index.seed_positions << " positions" << std::endl;
+
+			if (isa == BucketScan::SCALAR)
+			{
+				std::cout << "Reads/sec: " << std::setprecision(0) << reads.size() / elapsed.count() << std::endl;
+				continue;
+			}
+
+			// the scalar scan is the reference: the same hits in the same order in each window
+			for (uint64_t n = 0; n < ref_hits.ends.size(); ++n)
+			{
+				uint64_t ref_begin = n > 0 ? ref_hits.ends[n - 1] : 0;
+				uint64_t begin = n > 0 && n <= isa_hits.ends.size() ? isa_hits.ends[n - 1] : 0;
+				bool is_same = n < isa_hits.ends.size() && isa_hits.ends[n] - begin == ref_hits.ends[n] - ref_begin;
+				for (uint64_t i = 0; is_same && i < ref_hits.ends[n] - ref_begin; ++i)
+				{
+					auto const& hit = isa_hits.hits[begin + i];
+					auto const& ref_hit = ref_hits.hits[ref_begin + i];
+					is_same = hit.id == ref_hit.id && hit.win == ref_hit.win;
+				}
+				if (!is_same)
+				{
+					std::cerr << "Bucket scan: " << bucket_scan_name(isa) << " hits of the window " << n
+						<< " differ from the scalar hits:";
+					for (uint64_t i = ref_begin; i < ref_hits.ends[n]; ++i)
+						std::cerr << " " << ref_hits.hits[i].id << "/" << ref_hits.hits[i].win;
+					std::cerr << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+			if (isa_hits.ends.size() != ref_hits.ends.size())
+			{
+				std::cerr << "Bucket scan: " << bucket_scan_name(isa) << " windows: " << isa_hits.ends.size()
+					<< " differ from the scalar windows: " << ref_hits.ends.size() << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		if (index.minimizers.is_loaded())
+		{
+			uint64_t num_minimizers = 0;
+			auto starts = std::chrono::high_resolution_clock::now();
+			uint64_t hits = minimizer_search(refstats, index, reads, num_minimizers);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - starts;
+
+			std::cout << "Index part: " << idx_part << " minimizers (w=" << index.minimizers.w << "): " << num_minimizers
+				<< " hits: " << hits
+				<< " time: [" << std::setprecision(2) << std::fixed << elapsed.count() << "] sec"
+				<< " reads/sec: " << std::setprecision(0) << reads.size() / elapsed.count() << std::endl;
+		}
+		index.clear();
+	}
+} // ~index_seed_search
+
+/**
+ * Case 4
+ * The minimizer index gives the positions of all the (L+1)-mers starting with the minimizer: the reference is made
+ * of an L-mer followed by 'A', and of the same L-mer followed by 'C', and both are found. Each sequence has a single
+ * (L+1)-mer, and the L-mer is chosen so that it is the minimizer of both.
+ */
+void minimizer_ids()
+{
+	const char NT[4] = { 'A', 'C', 'G', 'T' };
+	const uint32_t lnwin = 18;
+	uint64_t mask = (1ULL << (2 * lnwin)) - 1;
+
+	// the L-mer whose hash is smaller than the hash of the other L-mer of both (L+1)-mers
+	uint64_t code = 0;
+	for (uint64_t seed = 1; ; ++seed)
+	{
+		code = kmer_hash(seed) & mask;
+		if (kmer_hash(code) < kmer_hash(((code << 2) | 0) & mask) && kmer_hash(code) < kmer_hash(((code << 2) | 1) & mask))
+			break;
+	}
+	std::string lmer;
+	for (int i = lnwin - 1; i >= 0; --i)
+		lmer.push_back(NT[(code >> (2 * i)) & 3]);
+
+	auto dir = std::filesystem::temp_directory_path() / "sortmerna_test_minimizer_ids";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	std::string ref = (dir / "ref.fasta").string();
+	{
+		std::ofstream ofs(ref, std::ios::binary);
+		ofs << ">a\n" << lmer << "A\n>c\n" << lmer << "C\n";
+	}
+
+	std::vector<std::string> args = { "tests", "--ref", ref, "--workdir", dir.string(), "--minimizer_w", "10", "--seed_engine", "minimizer" };
+	std::vector<char*> argv;
+	for (auto &arg : args)
+		argv.push_back(&arg[0]);
+	Runopts opts((int)argv.size(), argv.data(), false);
+	Index index(opts);
+	index.load(0, 0, opts, lnwin);
+	if (!index.minimizers.load(MinimizerIndex::file_name(opts.indexfiles[0].second, 0), lnwin))
+	{
+		std::cerr << "The minimizer index was not built" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	std::vector<uint32_t> seqs;
+	auto ids = index.minimizers.find(code);
+	for (auto id = ids.first; id != ids.second; ++id)
+	{
+		for (auto pos = index.positions(*id), end = index.positions_end(*id); pos != end; ++pos)
+		{
+			if (pos->pos == 0)
+				seqs.push_back(pos->seq);
+		}
+	}
+	std::sort(seqs.begin(), seqs.end());
+	seqs.erase(std::unique(seqs.begin(), seqs.end()), seqs.end());
+	if (seqs.size() != 2)
+	{
+		std::cerr << "The minimizer " << lmer << " is found at the start of " << seqs.size() << " sequences instead of 2" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	index.clear();
+	std::filesystem::remove_all(dir);
+} // ~minimizer_ids